@@ -0,0 +1,378 @@
+#ifndef O_WISDOM_ALLOC_H
+#define O_WISDOM_ALLOC_H
+
+/*
+ * O_wisdom - space complexity via allocation tracking
+ *
+ * Allocations are counted in one of two ways:
+ *   - Pluggable: workloads allocate through wisdom_tracked_malloc/calloc/
+ *     realloc/free, which record exact requested sizes. Objects that take
+ *     an Allocator (allocator.h) are tracked the same way by handing them
+ *     wisdom_alloc_allocator().
+ *   - Interposed: define WISDOM_INTERPOSE_MALLOC before including this header
+ *     in exactly one translation unit of the program. malloc, calloc, realloc,
+ *     free and the aligned entry points (posix_memalign, aligned_alloc,
+ *     memalign, valloc, pvalloc) are then wrapped around glibc's __libc_*
+ *     entry points and record malloc_usable_size() bytes for every
+ *     allocation in the process, so every block free() subtracts was added.
+ *
+ * Use one mode per program: with interposition active the tracked
+ * functions are counted twice.
+ *
+ * While tracking is enabled the counters record peak live bytes, allocation
+ * count and total bytes allocated. wisdom_measure_space runs a workload over
+ * a size sweep and fits space models exactly as time is fitted.
+ *
+ * The counters are process-wide (one weak definition shared by every
+ * translation unit) and updated atomically, so all threads are counted.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "allocator.h"
+#include "O_wisdom_fit.h"
+
+typedef struct {
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t bytes_allocated;
+    int64_t current_bytes;      // Relative to when tracking was reset
+    int64_t peak_bytes;
+    int enabled;
+} WisdomAllocStats;
+
+__attribute__((weak)) WisdomAllocStats wisdom_alloc_stats;
+
+static inline void wisdom_alloc_note(size_t bytes) {
+    if (!__atomic_load_n(&wisdom_alloc_stats.enabled, __ATOMIC_RELAXED)) return;
+
+    __atomic_fetch_add(&wisdom_alloc_stats.allocations, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&wisdom_alloc_stats.bytes_allocated, (uint64_t)bytes, __ATOMIC_RELAXED);
+    int64_t current = __atomic_add_fetch(&wisdom_alloc_stats.current_bytes, (int64_t)bytes, __ATOMIC_RELAXED);
+
+    int64_t peak = __atomic_load_n(&wisdom_alloc_stats.peak_bytes, __ATOMIC_RELAXED);
+    while (current > peak &&
+           !__atomic_compare_exchange_n(&wisdom_alloc_stats.peak_bytes, &peak, current, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static inline void wisdom_free_note(size_t bytes) {
+    if (!__atomic_load_n(&wisdom_alloc_stats.enabled, __ATOMIC_RELAXED)) return;
+
+    __atomic_fetch_add(&wisdom_alloc_stats.frees, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&wisdom_alloc_stats.current_bytes, (int64_t)bytes, __ATOMIC_RELAXED);
+}
+
+// Zero the counters and start (or stop) recording
+static inline void wisdom_alloc_tracking(int enabled) {
+    if (enabled) {
+        __atomic_store_n(&wisdom_alloc_stats.allocations, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&wisdom_alloc_stats.frees, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&wisdom_alloc_stats.bytes_allocated, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&wisdom_alloc_stats.current_bytes, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&wisdom_alloc_stats.peak_bytes, 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&wisdom_alloc_stats.enabled, enabled, __ATOMIC_SEQ_CST);
+}
+
+static inline WisdomAllocStats wisdom_alloc_snapshot(void) {
+    WisdomAllocStats stats;
+    stats.allocations = __atomic_load_n(&wisdom_alloc_stats.allocations, __ATOMIC_RELAXED);
+    stats.frees = __atomic_load_n(&wisdom_alloc_stats.frees, __ATOMIC_RELAXED);
+    stats.bytes_allocated = __atomic_load_n(&wisdom_alloc_stats.bytes_allocated, __ATOMIC_RELAXED);
+    stats.current_bytes = __atomic_load_n(&wisdom_alloc_stats.current_bytes, __ATOMIC_RELAXED);
+    stats.peak_bytes = __atomic_load_n(&wisdom_alloc_stats.peak_bytes, __ATOMIC_RELAXED);
+    stats.enabled = __atomic_load_n(&wisdom_alloc_stats.enabled, __ATOMIC_RELAXED);
+    return stats;
+}
+
+/* ---------------------------------------------------------------------------
+ * Pluggable tracked allocator
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Every tracked block carries a 16-byte header just below the returned
+ * pointer: the malloc'd block and the requested size. Plain blocks start at
+ * the malloc'd block, which keeps max_align_t alignment; aligned ones are
+ * placed inside a larger one.
+ */
+#define WISDOM_ALLOC_HEADER 16
+
+static inline void* wisdom_tracked_place(unsigned char* block, unsigned char* user, size_t size) {
+    memcpy(user - WISDOM_ALLOC_HEADER, &block, sizeof(block));
+    memcpy(user - WISDOM_ALLOC_HEADER + 8, &size, sizeof(size));
+    wisdom_alloc_note(size);
+    return user;
+}
+
+static inline void wisdom_tracked_header(const void* p, unsigned char** block, size_t* size) {
+    const unsigned char* user = (const unsigned char*)p;
+    memcpy(block, user - WISDOM_ALLOC_HEADER, sizeof(*block));
+    memcpy(size, user - WISDOM_ALLOC_HEADER + 8, sizeof(*size));
+}
+
+static inline void* wisdom_tracked_malloc(size_t size) {
+    if (size > SIZE_MAX - WISDOM_ALLOC_HEADER) return NULL;
+    unsigned char* block = (unsigned char*)malloc(WISDOM_ALLOC_HEADER + size);
+    if (!block) return NULL;
+    return wisdom_tracked_place(block, block + WISDOM_ALLOC_HEADER, size);
+}
+
+static inline void* wisdom_tracked_calloc(size_t count, size_t size) {
+    if (size && count > (SIZE_MAX - WISDOM_ALLOC_HEADER) / size) return NULL;
+    void* p = wisdom_tracked_malloc(count * size);
+    if (p) memset(p, 0, count * size);
+    return p;
+}
+
+// alignment is a power of two
+static inline void* wisdom_tracked_aligned_alloc(size_t alignment, size_t size) {
+    if (alignment <= WISDOM_ALLOC_HEADER) return wisdom_tracked_malloc(size);
+    if (size > SIZE_MAX - WISDOM_ALLOC_HEADER - alignment) return NULL;
+
+    unsigned char* block = (unsigned char*)malloc(WISDOM_ALLOC_HEADER + alignment + size);
+    if (!block) return NULL;
+    uintptr_t user = ((uintptr_t)block + WISDOM_ALLOC_HEADER + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    return wisdom_tracked_place(block, (unsigned char*)user, size);
+}
+
+static inline void wisdom_tracked_free(void* p) {
+    if (!p) return;
+    unsigned char* block;
+    size_t size;
+    wisdom_tracked_header(p, &block, &size);
+    wisdom_free_note(size);
+    free(block);
+}
+
+static inline void* wisdom_tracked_realloc(void* p, size_t size) {
+    if (!p) return wisdom_tracked_malloc(size);
+
+    unsigned char* block;
+    size_t old_size;
+    wisdom_tracked_header(p, &block, &old_size);
+
+    // Aligned blocks cannot move with realloc without losing their offset
+    if (block + WISDOM_ALLOC_HEADER != (unsigned char*)p) {
+        void* grown = wisdom_tracked_malloc(size);
+        if (!grown) return NULL;
+        memcpy(grown, p, old_size < size ? old_size : size);
+        wisdom_tracked_free(p);
+        return grown;
+    }
+
+    if (size > SIZE_MAX - WISDOM_ALLOC_HEADER) return NULL;
+    unsigned char* grown = (unsigned char*)realloc(block, WISDOM_ALLOC_HEADER + size);
+    if (!grown) return NULL;
+    wisdom_free_note(old_size);
+    return wisdom_tracked_place(grown, grown + WISDOM_ALLOC_HEADER, size);
+}
+
+static inline void* wisdom_allocator_alloc(void* ctx, size_t size) {
+    (void)ctx;
+    return wisdom_tracked_malloc(size);
+}
+
+static inline void* wisdom_allocator_realloc(void* ctx, void* p, size_t size) {
+    (void)ctx;
+    return wisdom_tracked_realloc(p, size);
+}
+
+static inline void wisdom_allocator_free(void* ctx, void* p) {
+    (void)ctx;
+    wisdom_tracked_free(p);
+}
+
+static inline void* wisdom_allocator_aligned_alloc(void* ctx, size_t alignment, size_t size) {
+    (void)ctx;
+    return wisdom_tracked_aligned_alloc(alignment, size);
+}
+
+static const Allocator wisdom_alloc_allocator_instance = {
+    wisdom_allocator_alloc, wisdom_allocator_realloc, wisdom_allocator_free, wisdom_allocator_aligned_alloc, NULL
+};
+
+// The tracked functions as an Allocator, for objects that take one (allocator.h)
+static inline const Allocator* wisdom_alloc_allocator(void) {
+    return &wisdom_alloc_allocator_instance;
+}
+
+/* ---------------------------------------------------------------------------
+ * Process-wide interposition (one translation unit only)
+ * ------------------------------------------------------------------------- */
+
+#ifdef WISDOM_INTERPOSE_MALLOC
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* p, size_t size);
+extern void __libc_free(void* p);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void* __libc_valloc(size_t size);
+extern void* __libc_pvalloc(size_t size);
+
+static inline void* wisdom_alloc_noted(void* p) {
+    if (p) wisdom_alloc_note(malloc_usable_size(p));
+    return p;
+}
+
+void* malloc(size_t size) {
+    void* p = __libc_malloc(size);
+    if (p) wisdom_alloc_note(malloc_usable_size(p));
+    return p;
+}
+
+void* calloc(size_t count, size_t size) {
+    void* p = __libc_calloc(count, size);
+    if (p) wisdom_alloc_note(malloc_usable_size(p));
+    return p;
+}
+
+void* realloc(void* p, size_t size) {
+    size_t old_size = p ? malloc_usable_size(p) : 0;
+    void* q = __libc_realloc(p, size);
+    if (q || size == 0) {
+        if (p) wisdom_free_note(old_size);
+        if (q) wisdom_alloc_note(malloc_usable_size(q));
+    }
+    return q;
+}
+
+void free(void* p) {
+    if (p) wisdom_free_note(malloc_usable_size(p));
+    __libc_free(p);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) return EINVAL;
+    void* p = wisdom_alloc_noted(__libc_memalign(alignment, size));
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    return wisdom_alloc_noted(__libc_memalign(alignment, size));
+}
+
+void* memalign(size_t alignment, size_t size) {
+    return wisdom_alloc_noted(__libc_memalign(alignment, size));
+}
+
+void* valloc(size_t size) {
+    return wisdom_alloc_noted(__libc_valloc(size));
+}
+
+void* pvalloc(size_t size) {
+    return wisdom_alloc_noted(__libc_pvalloc(size));
+}
+#endif
+
+/* ---------------------------------------------------------------------------
+ * Space complexity sweep
+ * ------------------------------------------------------------------------- */
+
+typedef struct {
+    size_t point_count;
+    double n[WISDOM_FIT_MAX_POINTS];
+    double peak_bytes[WISDOM_FIT_MAX_POINTS];       // Per run
+    double bytes_allocated[WISDOM_FIT_MAX_POINTS];  // Per run
+    double allocations[WISDOM_FIT_MAX_POINTS];      // Per run
+
+    // Fits are only valid when the corresponding flag is set; a workload
+    // that never allocates is reported as O(1) with zero bytes instead
+    int peak_fitted;
+    int allocated_fitted;
+    WisdomComplexityReport peak_fit;
+    WisdomComplexityReport allocated_fit;
+} WisdomSpaceReport;
+
+/*
+ * Allocation counters for one run() at size n; prepare/release are not
+ * tracked. Returns 0 on success, -1 if prepare() returns NULL.
+ */
+static inline int wisdom_measure_allocations(const WisdomWorkload* workload, size_t n, WisdomAllocStats* stats) {
+    void* state = workload->prepare ? workload->prepare(n, workload->user_data) : NULL;
+    if (workload->prepare && !state) return -1;
+
+    wisdom_alloc_tracking(1);
+    workload->run(state, n, workload->user_data);
+    wisdom_alloc_tracking(0);
+    *stats = wisdom_alloc_snapshot();
+
+    if (workload->release) workload->release(state, workload->user_data);
+    return 0;
+}
+
+/*
+ * Measure allocations over the sweep in config (repetitions is ignored:
+ * allocation counts are deterministic for deterministic workloads) and fit
+ * space models to peak and total allocated bytes. Returns 0 on success, -1
+ * on invalid config or a failed prepare().
+ */
+static inline int wisdom_measure_space(const WisdomSweepConfig* config, const WisdomWorkload* workload,
+                                       WisdomSpaceReport* report) {
+    memset(report, 0, sizeof(*report));
+    if (!workload->run || config->min_n == 0 || config->max_n < config->min_n || !(config->growth > 1.0)) {
+        return -1;
+    }
+
+    double size = (double)config->min_n;
+    size_t previous = 0;
+    size_t count = 0;
+    while (size <= (double)config->max_n && count < WISDOM_FIT_MAX_POINTS) {
+        size_t current = (size_t)(size + 0.5);
+        if (current != previous) {
+            WisdomAllocStats stats;
+            if (wisdom_measure_allocations(workload, current, &stats) != 0) return -1;
+            report->n[count] = (double)current;
+            report->peak_bytes[count] = stats.peak_bytes > 0 ? (double)stats.peak_bytes : 0.0;
+            report->bytes_allocated[count] = (double)stats.bytes_allocated;
+            report->allocations[count] = (double)stats.allocations;
+            count++;
+            previous = current;
+        }
+        size *= config->growth;
+    }
+    report->point_count = count;
+
+    // Fitting needs positive values; all-zero series are trivially O(1)
+    double peak[WISDOM_FIT_MAX_POINTS];
+    double allocated[WISDOM_FIT_MAX_POINTS];
+    int any_peak = 0, any_allocated = 0;
+    for (size_t i = 0; i < count; i++) {
+        any_peak |= report->peak_bytes[i] > 0;
+        any_allocated |= report->bytes_allocated[i] > 0;
+        peak[i] = report->peak_bytes[i] > 1.0 ? report->peak_bytes[i] : 1.0;
+        allocated[i] = report->bytes_allocated[i] > 1.0 ? report->bytes_allocated[i] : 1.0;
+    }
+
+    if (any_peak) report->peak_fitted = wisdom_fit_complexity(report->n, peak, count, &report->peak_fit) == 0;
+    if (any_allocated) {
+        report->allocated_fitted = wisdom_fit_complexity(report->n, allocated, count, &report->allocated_fit) == 0;
+    }
+    return 0;
+}
+
+static inline void wisdom_print_space(const WisdomSpaceReport* report, FILE* out) {
+    fprintf(out, "%12s %16s %16s %12s\n", "n", "peak bytes", "bytes allocated", "allocations");
+    for (size_t i = 0; i < report->point_count; i++) {
+        fprintf(out, "%12.0f %16.0f %16.0f %12.0f\n",
+                report->n[i], report->peak_bytes[i], report->bytes_allocated[i], report->allocations[i]);
+    }
+
+    fprintf(out, "peak space:      %s\n",
+            report->peak_fitted ? wisdom_model_name(report->peak_fit.best) : "O(1) (no live allocations)");
+    fprintf(out, "allocated bytes: %s\n",
+            report->allocated_fitted ? wisdom_model_name(report->allocated_fit.best) : "O(1) (no allocations)");
+}
+
+#endif // O_WISDOM_ALLOC_H
@@ -0,0 +1,604 @@
+#ifndef O_WISDOM_BASELINE_H
+#define O_WISDOM_BASELINE_H
+
+/*
+ * O_wisdom - baseline storage and regression detection
+ *
+ * Robust timing results are stored per (benchmark, n) in a versioned JSON
+ * baseline together with their raw samples:
+ *
+ *   { "format": "o_wisdom-baseline", "version": 1, "label": "...",
+ *     "environment": "...", "created": 1760000000,
+ *     "results": [ { "benchmark": "sort", "n": 1024, "median": 1.2e-05,
+ *                    "mad": 3e-08, "ci_low": ..., "ci_high": ...,
+ *                    "iterations": 64, "samples": [ ... ] } ] }
+ *
+ * A compare run matches current results against the baseline and flags a
+ * slowdown when it is both statistically significant (one-sided Mann-Whitney
+ * U test, or non-overlapping confidence intervals) and larger than a minimum
+ * effect size. wisdom_baseline_compare_files returns a process exit code.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "O_wisdom_timing.h"
+
+#define WISDOM_BASELINE_FORMAT      "o_wisdom-baseline"
+#define WISDOM_BASELINE_VERSION     1
+#define WISDOM_BASELINE_NAME_MAX    128
+#define WISDOM_BASELINE_ENV_MAX     512
+#define WISDOM_BASELINE_TEMP_TRIES  16      // Attempts to create a unique temporary file
+
+// Exit codes of a compare run
+#define WISDOM_COMPARE_OK           0
+#define WISDOM_COMPARE_REGRESSION   1
+#define WISDOM_COMPARE_ERROR        2
+
+typedef struct {
+    char benchmark[WISDOM_BASELINE_NAME_MAX];
+    size_t n;
+    double median;
+    double mad;
+    double ci_low;
+    double ci_high;
+    size_t iterations;
+    size_t sample_count;
+    double samples[WISDOM_TIMING_MAX_SAMPLES];
+} WisdomBaselineEntry;
+
+typedef struct {
+    int version;
+    char label[WISDOM_BASELINE_NAME_MAX];
+    char environment[WISDOM_BASELINE_ENV_MAX];  // Optional fingerprint, see O_wisdom_env.h
+    long long created;
+    WisdomBaselineEntry* entries;
+    size_t count;
+    size_t capacity;
+} WisdomBaseline;
+
+typedef enum {
+    WISDOM_COMPARE_MANN_WHITNEY,
+    WISDOM_COMPARE_CI_OVERLAP
+} WisdomCompareMethod;
+
+typedef struct {
+    WisdomCompareMethod method;
+    double alpha;               // Significance level for Mann-Whitney
+    double min_slowdown;        // Minimum relative median increase, e.g. 0.05
+} WisdomCompareConfig;
+
+static inline void wisdom_compare_defaults(WisdomCompareConfig* config) {
+    config->method = WISDOM_COMPARE_MANN_WHITNEY;
+    config->alpha = 0.01;
+    config->min_slowdown = 0.05;
+}
+
+static inline void init_wisdom_baseline(WisdomBaseline* baseline, const char* label) {
+    memset(baseline, 0, sizeof(*baseline));
+    baseline->version = WISDOM_BASELINE_VERSION;
+    baseline->created = (long long)time(NULL);
+    if (label) {
+        strncpy(baseline->label, label, WISDOM_BASELINE_NAME_MAX - 1);
+    }
+}
+
+static inline void cleanup_wisdom_baseline(WisdomBaseline* baseline) {
+    free(baseline->entries);
+    memset(baseline, 0, sizeof(*baseline));
+}
+
+static inline WisdomBaselineEntry* wisdom_baseline_append(WisdomBaseline* baseline) {
+    if (baseline->count == baseline->capacity) {
+        size_t capacity = baseline->capacity ? baseline->capacity * 2 : 16;
+        WisdomBaselineEntry* entries =
+            (WisdomBaselineEntry*)realloc(baseline->entries, capacity * sizeof(WisdomBaselineEntry));
+        if (!entries) return NULL;
+        baseline->entries = entries;
+        baseline->capacity = capacity;
+    }
+
+    WisdomBaselineEntry* entry = &baseline->entries[baseline->count++];
+    memset(entry, 0, sizeof(*entry));
+    return entry;
+}
+
+// Record one measurement. Returns 0 on success, -1 on allocation failure
+static inline int wisdom_baseline_record(WisdomBaseline* baseline, const char* benchmark, size_t n,
+                                         const WisdomTimingResult* result) {
+    WisdomBaselineEntry* entry = wisdom_baseline_append(baseline);
+    if (!entry) return -1;
+
+    strncpy(entry->benchmark, benchmark, WISDOM_BASELINE_NAME_MAX - 1);
+    entry->n = n;
+    entry->median = result->median;
+    entry->mad = result->mad;
+    entry->ci_low = result->ci_low;
+    entry->ci_high = result->ci_high;
+    entry->iterations = result->iterations;
+    entry->sample_count = result->sample_count;
+    memcpy(entry->samples, result->samples, result->sample_count * sizeof(double));
+    return 0;
+}
+
+static inline const WisdomBaselineEntry* wisdom_baseline_find(const WisdomBaseline* baseline,
+                                                              const char* benchmark, size_t n) {
+    for (size_t i = 0; i < baseline->count; i++) {
+        const WisdomBaselineEntry* entry = &baseline->entries[i];
+        if (entry->n == n && strcmp(entry->benchmark, benchmark) == 0) return entry;
+    }
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * JSON serialisation
+ * ------------------------------------------------------------------------- */
+
+static inline void wisdom_json_write_string(FILE* out, const char* text) {
+    fputc('"', out);
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        if (*p == '"' || *p == '\\') fprintf(out, "\\%c", *p);
+        else if (*p < 0x20) fprintf(out, "\\u%04x", *p);
+        else fputc(*p, out);
+    }
+    fputc('"', out);
+}
+
+static inline void wisdom_baseline_write(const WisdomBaseline* baseline, FILE* out) {
+    fprintf(out, "{\n  \"format\": \"%s\",\n  \"version\": %d,\n  \"label\": ",
+            WISDOM_BASELINE_FORMAT, WISDOM_BASELINE_VERSION);
+    wisdom_json_write_string(out, baseline->label);
+    if (baseline->environment[0]) {
+        fprintf(out, ",\n  \"environment\": ");
+        wisdom_json_write_string(out, baseline->environment);
+    }
+    fprintf(out, ",\n  \"created\": %lld,\n  \"results\": [", baseline->created);
+
+    for (size_t i = 0; i < baseline->count; i++) {
+        const WisdomBaselineEntry* entry = &baseline->entries[i];
+        fprintf(out, "%s\n    {\"benchmark\": ", i ? "," : "");
+        wisdom_json_write_string(out, entry->benchmark);
+        fprintf(out, ", \"n\": %zu, \"median\": %.17g, \"mad\": %.17g, \"ci_low\": %.17g, \"ci_high\": %.17g, "
+                     "\"iterations\": %zu,\n     \"samples\": [",
+                entry->n, entry->median, entry->mad, entry->ci_low, entry->ci_high, entry->iterations);
+        for (size_t s = 0; s < entry->sample_count; s++) {
+            fprintf(out, "%s%.17g", s ? ", " : "", entry->samples[s]);
+        }
+        fprintf(out, "]}");
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+}
+
+__attribute__((weak)) unsigned wisdom_baseline_temp_counter;
+
+// fsync the directory holding path so a rename into it is durable
+static inline int wisdom_baseline_sync_directory(const char* path) {
+    const char* slash = strrchr(path, '/');
+    char* directory = slash ? strndup(path, slash == path ? 1 : (size_t)(slash - path)) : strdup(".");
+    if (!directory) return -1;
+    int fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    free(directory);
+    if (fd < 0) return -1;
+    // Some filesystems cannot sync a directory; the rename is as durable as they allow
+    int result = fsync(fd) == 0 || errno == EINVAL ? 0 : -1;
+    close(fd);
+    return result;
+}
+
+/*
+ * Write the baseline to a temporary file next to path, fsync it and rename
+ * it over path, so an interrupted save never leaves a truncated baseline.
+ * Returns 0 on success, -1 on I/O failure (path is then untouched).
+ */
+static inline int wisdom_baseline_save(const WisdomBaseline* baseline, const char* path) {
+    size_t length = strlen(path);
+    char* temp_path = (char*)malloc(length + 48);
+    if (!temp_path) return -1;
+
+    // O_EXCL so a concurrent save of the same target never shares the temporary
+    int fd = -1;
+    for (int attempt = 0; fd < 0 && attempt < WISDOM_BASELINE_TEMP_TRIES; attempt++) {
+        snprintf(temp_path, length + 48, "%s.tmp.%ld.%u", path, (long)getpid(),
+                 __atomic_fetch_add(&wisdom_baseline_temp_counter, 1, __ATOMIC_RELAXED));
+        fd = open(temp_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (fd < 0 && errno != EEXIST) break;
+    }
+    if (fd < 0) {
+        free(temp_path);
+        return -1;
+    }
+    FILE* out = fdopen(fd, "w");
+    if (!out) {
+        close(fd);
+        unlink(temp_path);
+        free(temp_path);
+        return -1;
+    }
+
+    wisdom_baseline_write(baseline, out);
+    int failed = ferror(out) || fflush(out) != 0 || fsync(fileno(out)) != 0;
+    if (fclose(out) != 0) failed = 1;
+    if (!failed && rename(temp_path, path) != 0) failed = 1;
+    if (failed) unlink(temp_path);
+    free(temp_path);
+    if (failed) return -1;
+    return wisdom_baseline_sync_directory(path);
+}
+
+typedef struct {
+    const char* p;
+    const char* end;
+    int failed;
+} WisdomJsonCursor;
+
+static inline void wisdom_json_skip_ws(WisdomJsonCursor* json) {
+    while (json->p < json->end && isspace((unsigned char)*json->p)) json->p++;
+}
+
+static inline int wisdom_json_expect(WisdomJsonCursor* json, char c) {
+    wisdom_json_skip_ws(json);
+    if (json->p < json->end && *json->p == c) {
+        json->p++;
+        return 1;
+    }
+    json->failed = 1;
+    return 0;
+}
+
+static inline int wisdom_json_peek(WisdomJsonCursor* json, char c) {
+    wisdom_json_skip_ws(json);
+    return json->p < json->end && *json->p == c;
+}
+
+// Parse a string into buffer (truncating); buffer may be NULL to skip
+static inline void wisdom_json_string(WisdomJsonCursor* json, char* buffer, size_t size) {
+    size_t length = 0;
+    if (!wisdom_json_expect(json, '"')) return;
+
+    while (json->p < json->end && *json->p != '"') {
+        char c = *json->p++;
+        if (c == '\\' && json->p < json->end) {
+            c = *json->p++;
+            if (c == 'n') c = '\n';
+            else if (c == 't') c = '\t';
+            else if (c == 'u') {
+                unsigned code = 0;
+                for (int i = 0; i < 4 && json->p < json->end; i++) {
+                    char h = *json->p++;
+                    code = code * 16 + (unsigned)(isdigit((unsigned char)h) ? h - '0' : (tolower((unsigned char)h) - 'a' + 10));
+                }
+                c = code < 0x80 ? (char)code : '?';
+            }
+        }
+        if (buffer && length + 1 < size) buffer[length++] = c;
+    }
+    if (buffer && size) buffer[length] = '\0';
+    wisdom_json_expect(json, '"');
+}
+
+static inline double wisdom_json_number(WisdomJsonCursor* json) {
+    wisdom_json_skip_ws(json);
+    char* end;
+    double value = strtod(json->p, &end);
+    if (end == json->p || end > json->end) {
+        json->failed = 1;
+        return 0;
+    }
+    json->p = end;
+    return value;
+}
+
+static inline void wisdom_json_skip_value(WisdomJsonCursor* json, int depth) {
+    wisdom_json_skip_ws(json);
+    if (json->p >= json->end || depth > 64) {
+        json->failed = 1;
+        return;
+    }
+
+    char c = *json->p;
+    if (c == '"') {
+        wisdom_json_string(json, NULL, 0);
+    } else if (c == '{' || c == '[') {
+        char close = c == '{' ? '}' : ']';
+        json->p++;
+        if (wisdom_json_peek(json, close)) {
+            json->p++;
+            return;
+        }
+        do {
+            if (c == '{') {
+                wisdom_json_string(json, NULL, 0);
+                wisdom_json_expect(json, ':');
+            }
+            wisdom_json_skip_value(json, depth + 1);
+        } while (!json->failed && wisdom_json_peek(json, ',') && json->p++);
+        wisdom_json_expect(json, close);
+    } else if (isalpha((unsigned char)c)) {
+        while (json->p < json->end && isalpha((unsigned char)*json->p)) json->p++;
+    } else {
+        wisdom_json_number(json);
+    }
+}
+
+static inline void wisdom_json_entry(WisdomJsonCursor* json, WisdomBaselineEntry* entry) {
+    if (!wisdom_json_expect(json, '{')) return;
+    if (wisdom_json_peek(json, '}')) {
+        json->p++;
+        return;
+    }
+
+    do {
+        char key[32];
+        wisdom_json_string(json, key, sizeof(key));
+        wisdom_json_expect(json, ':');
+        if (json->failed) return;
+
+        if (strcmp(key, "benchmark") == 0) wisdom_json_string(json, entry->benchmark, sizeof(entry->benchmark));
+        else if (strcmp(key, "n") == 0) entry->n = (size_t)wisdom_json_number(json);
+        else if (strcmp(key, "median") == 0) entry->median = wisdom_json_number(json);
+        else if (strcmp(key, "mad") == 0) entry->mad = wisdom_json_number(json);
+        else if (strcmp(key, "ci_low") == 0) entry->ci_low = wisdom_json_number(json);
+        else if (strcmp(key, "ci_high") == 0) entry->ci_high = wisdom_json_number(json);
+        else if (strcmp(key, "iterations") == 0) entry->iterations = (size_t)wisdom_json_number(json);
+        else if (strcmp(key, "samples") == 0) {
+            wisdom_json_expect(json, '[');
+            if (wisdom_json_peek(json, ']')) {
+                json->p++;
+                continue;
+            }
+            do {
+                double value = wisdom_json_number(json);
+                if (entry->sample_count < WISDOM_TIMING_MAX_SAMPLES) entry->samples[entry->sample_count++] = value;
+            } while (!json->failed && wisdom_json_peek(json, ',') && json->p++);
+            wisdom_json_expect(json, ']');
+        } else {
+            wisdom_json_skip_value(json, 0);
+        }
+    } while (!json->failed && wisdom_json_peek(json, ',') && json->p++);
+
+    wisdom_json_expect(json, '}');
+}
+
+/*
+ * Load a baseline written by wisdom_baseline_save. Unknown keys are ignored;
+ * newer format versions are rejected. Returns 0 on success, -1 on failure.
+ */
+static inline int wisdom_baseline_load(WisdomBaseline* baseline, const char* path) {
+    init_wisdom_baseline(baseline, NULL);
+    baseline->created = 0;
+
+    FILE* in = fopen(path, "rb");
+    if (!in) return -1;
+
+    size_t capacity = 1 << 16;
+    size_t length = 0;
+    char* text = (char*)malloc(capacity);
+    while (text) {
+        // Keep one byte for the terminator strtod relies on
+        length += fread(text + length, 1, capacity - 1 - length, in);
+        if (length < capacity - 1) break;
+        capacity *= 2;
+        char* grown = (char*)realloc(text, capacity);
+        if (!grown) {
+            free(text);
+            text = NULL;
+        } else {
+            text = grown;
+        }
+    }
+    fclose(in);
+    if (!text) return -1;
+    text[length] = '\0';
+
+    WisdomJsonCursor json;
+    json.p = text;
+    json.end = text + length;
+    json.failed = 0;
+
+    char format[64] = "";
+    if (wisdom_json_expect(&json, '{') && !wisdom_json_peek(&json, '}')) {
+        do {
+            char key[32];
+            wisdom_json_string(&json, key, sizeof(key));
+            wisdom_json_expect(&json, ':');
+            if (json.failed) break;
+
+            if (strcmp(key, "format") == 0) wisdom_json_string(&json, format, sizeof(format));
+            else if (strcmp(key, "version") == 0) baseline->version = (int)wisdom_json_number(&json);
+            else if (strcmp(key, "label") == 0) wisdom_json_string(&json, baseline->label, sizeof(baseline->label));
+            else if (strcmp(key, "environment") == 0) {
+                wisdom_json_string(&json, baseline->environment, sizeof(baseline->environment));
+            }
+            else if (strcmp(key, "created") == 0) baseline->created = (long long)wisdom_json_number(&json);
+            else if (strcmp(key, "results") == 0) {
+                wisdom_json_expect(&json, '[');
+                if (wisdom_json_peek(&json, ']')) {
+                    json.p++;
+                    continue;
+                }
+                do {
+                    WisdomBaselineEntry* entry = wisdom_baseline_append(baseline);
+                    if (!entry) {
+                        json.failed = 1;
+                        break;
+                    }
+                    wisdom_json_entry(&json, entry);
+                } while (!json.failed && wisdom_json_peek(&json, ',') && json.p++);
+                wisdom_json_expect(&json, ']');
+            } else {
+                wisdom_json_skip_value(&json, 0);
+            }
+        } while (!json.failed && wisdom_json_peek(&json, ',') && json.p++);
+    }
+
+    free(text);
+
+    if (json.failed || strcmp(format, WISDOM_BASELINE_FORMAT) != 0 ||
+        baseline->version < 1 || baseline->version > WISDOM_BASELINE_VERSION) {
+        cleanup_wisdom_baseline(baseline);
+        return -1;
+    }
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Regression detection
+ * ------------------------------------------------------------------------- */
+
+typedef struct {
+    double value;
+    int group;
+} WisdomRankedSample;
+
+static inline int wisdom_compare_ranked(const void* a, const void* b) {
+    double x = ((const WisdomRankedSample*)a)->value;
+    double y = ((const WisdomRankedSample*)b)->value;
+    return (x > y) - (x < y);
+}
+
+/*
+ * One-sided Mann-Whitney U test (normal approximation with tie and
+ * continuity correction). Returns the p-value for "current is slower than
+ * baseline", or NAN if either side has fewer than two samples.
+ */
+static inline double wisdom_mann_whitney_slower(const double* baseline, size_t n1, const double* current, size_t n2) {
+    if (n1 < 2 || n2 < 2) return NAN;
+
+    size_t total = n1 + n2;
+    WisdomRankedSample* all = (WisdomRankedSample*)malloc(total * sizeof(WisdomRankedSample));
+    if (!all) return NAN;
+
+    for (size_t i = 0; i < n1; i++) {
+        all[i].value = baseline[i];
+        all[i].group = 0;
+    }
+    for (size_t i = 0; i < n2; i++) {
+        all[n1 + i].value = current[i];
+        all[n1 + i].group = 1;
+    }
+    qsort(all, total, sizeof(WisdomRankedSample), wisdom_compare_ranked);
+
+    double rank_sum = 0;
+    double tie_term = 0;
+    for (size_t i = 0; i < total;) {
+        size_t j = i;
+        while (j + 1 < total && all[j + 1].value == all[i].value) j++;
+
+        double rank = 0.5 * (double)(i + j) + 1.0;
+        double ties = (double)(j - i + 1);
+        tie_term += ties * ties * ties - ties;
+        for (size_t k = i; k <= j; k++) {
+            if (all[k].group == 1) rank_sum += rank;
+        }
+        i = j + 1;
+    }
+    free(all);
+
+    double u = rank_sum - (double)n2 * (double)(n2 + 1) / 2.0;
+    double mean = (double)n1 * (double)n2 / 2.0;
+    double variance = (double)n1 * (double)n2 / 12.0 *
+                      ((double)(total + 1) - tie_term / ((double)total * (double)(total - 1)));
+    if (variance <= 0) return u > mean ? 0.0 : 1.0;
+
+    double z = (u - mean - 0.5) / sqrt(variance);
+    return 0.5 * erfc(z / sqrt(2.0));
+}
+
+/*
+ * Compare current against baseline and write one line per matched
+ * (benchmark, n) to report (may be NULL). Returns the number of regressions.
+ */
+static inline size_t wisdom_baseline_compare(const WisdomBaseline* baseline, const WisdomBaseline* current,
+                                             const WisdomCompareConfig* config, FILE* report) {
+    WisdomCompareConfig defaults;
+    if (!config) {
+        wisdom_compare_defaults(&defaults);
+        config = &defaults;
+    }
+
+    size_t regressions = 0;
+    if (report) {
+        fprintf(report, "%-32s %10s %12s %12s %8s %10s  %s\n",
+                "benchmark", "n", "baseline", "current", "ratio", "p", "verdict");
+    }
+
+    for (size_t i = 0; i < current->count; i++) {
+        const WisdomBaselineEntry* now = &current->entries[i];
+        const WisdomBaselineEntry* then = wisdom_baseline_find(baseline, now->benchmark, now->n);
+        if (!then) {
+            if (report) fprintf(report, "%-32s %10zu %12s %12.4g %8s %10s  new\n",
+                                now->benchmark, now->n, "-", now->median, "-", "-");
+            continue;
+        }
+
+        double ratio = then->median > 0 ? now->median / then->median : INFINITY;
+        double p = NAN;
+        int significant;
+
+        if (config->method == WISDOM_COMPARE_MANN_WHITNEY) {
+            p = wisdom_mann_whitney_slower(then->samples, then->sample_count, now->samples, now->sample_count);
+            // Too few samples for the test: fall back to interval overlap
+            significant = isnan(p) ? now->ci_low > then->ci_high : p < config->alpha;
+        } else {
+            significant = now->ci_low > then->ci_high;
+        }
+
+        int regression = significant && ratio > 1.0 + config->min_slowdown;
+        int improvement = !regression && ratio < 1.0 - config->min_slowdown && now->ci_high < then->ci_low;
+        if (regression) regressions++;
+
+        if (report) {
+            char p_text[16] = "-";
+            if (!isnan(p)) snprintf(p_text, sizeof(p_text), "%.3g", p);
+            fprintf(report, "%-32s %10zu %12.4g %12.4g %8.3f %10s  %s\n",
+                    now->benchmark, now->n, then->median, now->median, ratio, p_text,
+                    regression ? "REGRESSION" : (improvement ? "faster" : "ok"));
+        }
+    }
+
+    return regressions;
+}
+
+// Load both files and compare; returns a WISDOM_COMPARE_* exit code
+static inline int wisdom_baseline_compare_files(const char* baseline_path, const char* current_path,
+                                                const WisdomCompareConfig* config, FILE* report) {
+    WisdomBaseline baseline;
+    WisdomBaseline current;
+
+    if (wisdom_baseline_load(&baseline, baseline_path) != 0) {
+        if (report) fprintf(report, "cannot load baseline %s\n", baseline_path);
+        return WISDOM_COMPARE_ERROR;
+    }
+    if (wisdom_baseline_load(&current, current_path) != 0) {
+        if (report) fprintf(report, "cannot load results %s\n", current_path);
+        cleanup_wisdom_baseline(&baseline);
+        return WISDOM_COMPARE_ERROR;
+    }
+
+    // Fingerprints start with a hash of the fields that affect results
+    if (report && baseline.environment[0] && current.environment[0] &&
+        strncmp(baseline.environment, current.environment, 16) != 0) {
+        fprintf(report, "warning: measured in different environments\n  baseline: %s\n  current:  %s\n",
+                baseline.environment, current.environment);
+    }
+
+    size_t regressions = wisdom_baseline_compare(&baseline, &current, config, report);
+    if (report) fprintf(report, "%zu regression(s)\n", regressions);
+
+    cleanup_wisdom_baseline(&baseline);
+    cleanup_wisdom_baseline(&current);
+    return regressions ? WISDOM_COMPARE_REGRESSION : WISDOM_COMPARE_OK;
+}
+
+#endif // O_WISDOM_BASELINE_H
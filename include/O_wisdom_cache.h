@@ -0,0 +1,359 @@
+#ifndef O_WISDOM_CACHE_H
+#define O_WISDOM_CACHE_H
+
+/*
+ * O_wisdom - working-set sweep across the cache hierarchy
+ *
+ * Cache sizes are read from /sys/devices/system/cpu/cpu0/cache (falling back
+ * to sysconf). A kernel is then timed over working sets growing
+ * geometrically from well inside L1 to several times L3, and each point is
+ * attributed to the level it fits in. The report gives median throughput per
+ * level and lists cliffs: steps where throughput falls by more than
+ * cliff_threshold relative to the previous point.
+ *
+ * Two kernels are built in: a streaming read (bandwidth) and a dependent
+ * pointer chase over a random cyclic permutation (latency). Any other kernel
+ * can be supplied through WisdomWorkingSetKernel.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "O_wisdom_fit.h"
+
+#define WISDOM_CACHE_LEVELS         3
+#define WISDOM_CACHE_MAX_POINTS     128
+#define WISDOM_CACHE_LINE           64
+
+typedef enum {
+    WISDOM_LEVEL_L1,
+    WISDOM_LEVEL_L2,
+    WISDOM_LEVEL_L3,
+    WISDOM_LEVEL_DRAM,
+    WISDOM_LEVEL_COUNT
+} WisdomMemoryLevel;
+
+typedef struct {
+    size_t size[WISDOM_CACHE_LEVELS];   // Data/unified cache bytes for L1..L3, 0 if absent
+    int from_sysfs;
+} WisdomCacheInfo;
+
+// prepare runs once per working-set size (0 on success, -1 on failure), run walks the working set once
+typedef struct {
+    const char* name;
+    int (*prepare)(void* buffer, size_t bytes, void* user_data);
+    void (*run)(void* buffer, size_t bytes, void* user_data);
+    void* user_data;
+} WisdomWorkingSetKernel;
+
+typedef struct {
+    size_t min_bytes;               // 0: L1 / 8
+    size_t max_bytes;               // 0: 4 x largest cache
+    unsigned steps_per_doubling;    // Resolution of the sweep
+    double min_sample_seconds;      // Each sample repeats run() at least this long
+    size_t samples;                 // Median of this many samples per size
+    double cliff_threshold;         // Relative drop that counts as a cliff, e.g. 0.2
+} WisdomWorkingSetConfig;
+
+typedef struct {
+    size_t bytes;
+    double bytes_per_second;
+    double seconds_per_line;        // Time per cache line touched
+    WisdomMemoryLevel level;
+    int cliff;                      // Throughput fell by more than the threshold here
+} WisdomWorkingSetPoint;
+
+typedef struct {
+    WisdomCacheInfo caches;
+    size_t point_count;
+    WisdomWorkingSetPoint points[WISDOM_CACHE_MAX_POINTS];
+    double level_bytes_per_second[WISDOM_LEVEL_COUNT];  // 0 if no point landed there
+} WisdomWorkingSetReport;
+
+static inline const char* wisdom_level_name(WisdomMemoryLevel level) {
+    static const char* names[WISDOM_LEVEL_COUNT] = { "L1", "L2", "L3", "DRAM" };
+    return (unsigned)level < WISDOM_LEVEL_COUNT ? names[level] : "?";
+}
+
+static inline void wisdom_working_set_defaults(WisdomWorkingSetConfig* config) {
+    config->min_bytes = 0;
+    config->max_bytes = 0;
+    config->steps_per_doubling = 2;
+    config->min_sample_seconds = 0.01;
+    config->samples = 5;
+    config->cliff_threshold = 0.2;
+}
+
+// Parse sysfs sizes such as "48K" or "32M"
+static inline size_t wisdom_parse_cache_size(const char* text) {
+    char* end;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (*end == 'K' || *end == 'k') value <<= 10;
+    else if (*end == 'M' || *end == 'm') value <<= 20;
+    else if (*end == 'G' || *end == 'g') value <<= 30;
+    return (size_t)value;
+}
+
+static inline int wisdom_read_sysfs_line(const char* path, char* buffer, size_t size) {
+    FILE* file = fopen(path, "r");
+    if (!file) return -1;
+    int ok = fgets(buffer, (int)size, file) != NULL;
+    fclose(file);
+    if (!ok) return -1;
+    buffer[strcspn(buffer, "\n")] = '\0';
+    return 0;
+}
+
+// Returns the number of cache levels found
+static inline int wisdom_detect_caches(WisdomCacheInfo* info) {
+    memset(info, 0, sizeof(*info));
+
+    for (int index = 0; index < 16; index++) {
+        char path[128], level[16], type[32], size[32];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", index);
+        if (wisdom_read_sysfs_line(path, level, sizeof(level)) != 0) break;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", index);
+        if (wisdom_read_sysfs_line(path, type, sizeof(type)) != 0) continue;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", index);
+        if (wisdom_read_sysfs_line(path, size, sizeof(size)) != 0) continue;
+
+        int l = atoi(level);
+        if (l < 1 || l > WISDOM_CACHE_LEVELS || strcmp(type, "Instruction") == 0) continue;
+        info->size[l - 1] = wisdom_parse_cache_size(size);
+        info->from_sysfs = 1;
+    }
+
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    if (!info->size[0]) info->size[0] = sysconf(_SC_LEVEL1_DCACHE_SIZE) > 0 ? (size_t)sysconf(_SC_LEVEL1_DCACHE_SIZE) : 0;
+    if (!info->size[1]) info->size[1] = sysconf(_SC_LEVEL2_CACHE_SIZE) > 0 ? (size_t)sysconf(_SC_LEVEL2_CACHE_SIZE) : 0;
+    if (!info->size[2]) info->size[2] = sysconf(_SC_LEVEL3_CACHE_SIZE) > 0 ? (size_t)sysconf(_SC_LEVEL3_CACHE_SIZE) : 0;
+#endif
+
+    int levels = 0;
+    for (int i = 0; i < WISDOM_CACHE_LEVELS; i++) levels += info->size[i] > 0;
+    return levels;
+}
+
+static inline WisdomMemoryLevel wisdom_level_of(const WisdomCacheInfo* info, size_t bytes) {
+    for (int i = 0; i < WISDOM_CACHE_LEVELS; i++) {
+        if (info->size[i] && bytes <= info->size[i]) return (WisdomMemoryLevel)i;
+    }
+    return WISDOM_LEVEL_DRAM;
+}
+
+/* ---------------------------------------------------------------------------
+ * Built-in kernels
+ * ------------------------------------------------------------------------- */
+
+static volatile uint64_t wisdom_cache_sink;
+
+static inline int wisdom_kernel_fill(void* buffer, size_t bytes, void* user_data) {
+    (void)user_data;
+    memset(buffer, 1, bytes);
+    return 0;
+}
+
+// Streaming read of every 8-byte word
+static inline void wisdom_kernel_read(void* buffer, size_t bytes, void* user_data) {
+    (void)user_data;
+    const uint64_t* words = (const uint64_t*)buffer;
+    size_t count = bytes / sizeof(uint64_t);
+    uint64_t a = 0, b = 0, c = 0, d = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        a += words[i];
+        b += words[i + 1];
+        c += words[i + 2];
+        d += words[i + 3];
+    }
+    for (; i < count; i++) a += words[i];
+    wisdom_cache_sink = a + b + c + d;
+}
+
+// Link one pointer per cache line into a single random cycle
+static inline int wisdom_kernel_chase_prepare(void* buffer, size_t bytes, void* user_data) {
+    (void)user_data;
+    size_t lines = bytes / WISDOM_CACHE_LINE;
+    if (lines == 0) return 0;
+
+    size_t* order = (size_t*)malloc(lines * sizeof(size_t));
+    if (!order) return -1;
+    for (size_t i = 0; i < lines; i++) order[i] = i;
+
+    uint64_t state = 0x2545f4914f6cdd1dULL ^ lines;
+    for (size_t i = lines - 1; i > 0; i--) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        size_t j = (size_t)(state % (i + 1));
+        size_t t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+
+    char* base = (char*)buffer;
+    for (size_t i = 0; i < lines; i++) {
+        void** slot = (void**)(base + order[i] * WISDOM_CACHE_LINE);
+        *slot = base + order[(i + 1) % lines] * WISDOM_CACHE_LINE;
+    }
+    free(order);
+    return 0;
+}
+
+// One dependent load per cache line
+static inline void wisdom_kernel_chase(void* buffer, size_t bytes, void* user_data) {
+    (void)user_data;
+    size_t lines = bytes / WISDOM_CACHE_LINE;
+    void** p = (void**)buffer;
+    for (size_t i = 0; i < lines; i++) p = (void**)*p;
+    wisdom_cache_sink = (uint64_t)(uintptr_t)p;
+}
+
+static inline WisdomWorkingSetKernel wisdom_read_kernel(void) {
+    WisdomWorkingSetKernel kernel = { "sequential read", wisdom_kernel_fill, wisdom_kernel_read, NULL };
+    return kernel;
+}
+
+static inline WisdomWorkingSetKernel wisdom_chase_kernel(void) {
+    WisdomWorkingSetKernel kernel = { "pointer chase", wisdom_kernel_chase_prepare, wisdom_kernel_chase, NULL };
+    return kernel;
+}
+
+/* ---------------------------------------------------------------------------
+ * Sweep
+ * ------------------------------------------------------------------------- */
+
+// Seconds per run() at this working-set size: median over samples
+static inline double wisdom_working_set_time(const WisdomWorkingSetKernel* kernel, void* buffer, size_t bytes,
+                                             const WisdomWorkingSetConfig* config) {
+    double samples[32];
+    size_t count = config->samples ? config->samples : 1;
+    if (count > 32) count = 32;
+
+    // Warm the working set into the caches it fits in
+    kernel->run(buffer, bytes, kernel->user_data);
+
+    for (size_t s = 0; s < count; s++) {
+        size_t runs = 0;
+        double start = wisdom_now();
+        double elapsed;
+        do {
+            kernel->run(buffer, bytes, kernel->user_data);
+            runs++;
+            elapsed = wisdom_now() - start;
+        } while (elapsed < config->min_sample_seconds);
+        samples[s] = elapsed / (double)runs;
+    }
+
+    qsort(samples, count, sizeof(double), wisdom_compare_double);
+    return samples[count / 2];
+}
+
+/*
+ * Sweep the kernel over working-set sizes. config may be NULL for defaults.
+ * Returns 0 on success, -1 on allocation failure or when the kernel's
+ * prepare fails; the report then holds the sizes measured so far.
+ */
+static inline int wisdom_working_set_sweep(const WisdomWorkingSetConfig* config, const WisdomWorkingSetKernel* kernel,
+                                           WisdomWorkingSetReport* report) {
+    WisdomWorkingSetConfig defaults;
+    if (!config) {
+        wisdom_working_set_defaults(&defaults);
+        config = &defaults;
+    }
+
+    memset(report, 0, sizeof(*report));
+    wisdom_detect_caches(&report->caches);
+
+    size_t l1 = report->caches.size[0] ? report->caches.size[0] : 32 * 1024;
+    size_t largest = l1;
+    for (int i = 0; i < WISDOM_CACHE_LEVELS; i++) {
+        if (report->caches.size[i] > largest) largest = report->caches.size[i];
+    }
+
+    size_t min_bytes = config->min_bytes ? config->min_bytes : l1 / 8;
+    size_t max_bytes = config->max_bytes ? config->max_bytes : 4 * largest;
+    if (min_bytes < 2 * WISDOM_CACHE_LINE) min_bytes = 2 * WISDOM_CACHE_LINE;
+    if (max_bytes < min_bytes) max_bytes = min_bytes;
+
+    void* buffer = NULL;
+    if (posix_memalign(&buffer, 4096, max_bytes) != 0) return -1;
+
+    unsigned steps = config->steps_per_doubling ? config->steps_per_doubling : 1;
+    double factor = exp2(1.0 / (double)steps);
+    double size = (double)min_bytes;
+
+    while (size <= (double)max_bytes * 1.0001 && report->point_count < WISDOM_CACHE_MAX_POINTS) {
+        size_t bytes = ((size_t)size / WISDOM_CACHE_LINE) * WISDOM_CACHE_LINE;
+        size *= factor;
+        if (report->point_count > 0 && bytes == report->points[report->point_count - 1].bytes) continue;
+
+        // An unprepared buffer would have run() walk uninitialised memory
+        if (kernel->prepare && kernel->prepare(buffer, bytes, kernel->user_data) != 0) {
+            free(buffer);
+            return -1;
+        }
+        double seconds = wisdom_working_set_time(kernel, buffer, bytes, config);
+
+        WisdomWorkingSetPoint* point = &report->points[report->point_count++];
+        point->bytes = bytes;
+        point->bytes_per_second = seconds > 0 ? (double)bytes / seconds : 0;
+        point->seconds_per_line = seconds / (double)(bytes / WISDOM_CACHE_LINE);
+        point->level = wisdom_level_of(&report->caches, bytes);
+    }
+    free(buffer);
+
+    // Cliffs: sharp drops between neighbouring sizes
+    for (size_t i = 1; i < report->point_count; i++) {
+        WisdomWorkingSetPoint* point = &report->points[i];
+        double previous = report->points[i - 1].bytes_per_second;
+        point->cliff = previous > 0 && point->bytes_per_second < previous * (1.0 - config->cliff_threshold);
+    }
+
+    // Per-level throughput: median of the points attributed to each level
+    for (int level = 0; level < WISDOM_LEVEL_COUNT; level++) {
+        double values[WISDOM_CACHE_MAX_POINTS];
+        size_t count = 0;
+        for (size_t i = 0; i < report->point_count; i++) {
+            if (report->points[i].level == (WisdomMemoryLevel)level) {
+                values[count++] = report->points[i].bytes_per_second;
+            }
+        }
+        if (count == 0) continue;
+        qsort(values, count, sizeof(double), wisdom_compare_double);
+        report->level_bytes_per_second[level] = values[count / 2];
+    }
+    return 0;
+}
+
+static inline void wisdom_print_working_set(const WisdomWorkingSetReport* report, const char* kernel_name, FILE* out) {
+    fprintf(out, "working-set sweep: %s\n", kernel_name ? kernel_name : "kernel");
+    fprintf(out, "caches (%s):", report->caches.from_sysfs ? "sysfs" : "sysconf");
+    for (int i = 0; i < WISDOM_CACHE_LEVELS; i++) {
+        if (report->caches.size[i]) fprintf(out, " L%d=%zuK", i + 1, report->caches.size[i] / 1024);
+    }
+    fputc('\n', out);
+
+    fprintf(out, "%14s %6s %12s %12s\n", "bytes", "level", "GB/s", "ns/line");
+    for (size_t i = 0; i < report->point_count; i++) {
+        const WisdomWorkingSetPoint* point = &report->points[i];
+        fprintf(out, "%14zu %6s %12.3f %12.3f%s\n", point->bytes, wisdom_level_name(point->level),
+                point->bytes_per_second / 1e9, point->seconds_per_line * 1e9, point->cliff ? "  <- cliff" : "");
+    }
+
+    for (int level = 0; level < WISDOM_LEVEL_COUNT; level++) {
+        if (report->level_bytes_per_second[level] > 0) {
+            fprintf(out, "%-4s %10.3f GB/s\n", wisdom_level_name((WisdomMemoryLevel)level),
+                    report->level_bytes_per_second[level] / 1e9);
+        }
+    }
+}
+
+#endif // O_WISDOM_CACHE_H
@@ -0,0 +1,169 @@
+#ifndef O_WISDOM_CROSSOVER_H
+#define O_WISDOM_CROSSOVER_H
+
+/*
+ * O_wisdom - crossover finder for two implementations
+ *
+ * Times implementations A and B of the same operation with the robust timer
+ * over a coarse geometric scan of n, finds the first interval where the
+ * faster one changes, and bisects it (geometrically) until the bracket is
+ * narrower than the requested resolution. The result is a dispatch
+ * threshold: below crossover_n use the implementation that wins at small n.
+ *
+ * Confidence is taken from one-sided Mann-Whitney tests at both ends of the
+ * final bracket: each end must show its winner faster, so the reported
+ * confidence is 1 - max(p_low, p_high). A low value means the two are
+ * indistinguishable near the crossover, and the exact threshold hardly
+ * matters.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "O_wisdom_timing.h"
+#include "O_wisdom_baseline.h"
+
+typedef struct {
+    size_t min_n;
+    size_t max_n;
+    double growth;                      // Coarse scan ratio, > 1
+    double resolution;                  // Stop when hi / lo <= 1 + resolution
+    const WisdomTimingConfig* timing;   // NULL for defaults
+} WisdomCrossoverConfig;
+
+typedef struct {
+    size_t n;
+    double a_seconds;       // Medians
+    double b_seconds;
+    double ratio;           // a / b; below 1 means A is faster
+    double p_value;         // One-sided test that the winner really is faster
+} WisdomCrossoverPoint;
+
+typedef struct {
+    int found;
+    int multiple;           // The coarse scan saw more than one change of winner
+    int a_wins_small;       // A is faster below the crossover (or everywhere if !found)
+    size_t low_n;           // Final bracket
+    size_t high_n;
+    size_t crossover_n;     // Geometric middle of the bracket
+    double confidence;
+    size_t point_count;
+    WisdomCrossoverPoint points[WISDOM_FIT_MAX_POINTS];   // In measurement order
+} WisdomCrossoverReport;
+
+static inline void wisdom_crossover_defaults(WisdomCrossoverConfig* config) {
+    config->min_n = 16;
+    config->max_n = 1 << 20;
+    config->growth = 4.0;
+    config->resolution = 0.05;
+    config->timing = NULL;
+}
+
+static inline int wisdom_crossover_point(const WisdomCrossoverConfig* config, const WisdomWorkload* a,
+                                         const WisdomWorkload* b, size_t n, WisdomCrossoverReport* report,
+                                         WisdomCrossoverPoint* out) {
+    WisdomTimingResult ta, tb;
+    if (wisdom_time_robust(config->timing, a, n, &ta) != 0) return -1;
+    if (wisdom_time_robust(config->timing, b, n, &tb) != 0) return -1;
+
+    out->n = n;
+    out->a_seconds = ta.median;
+    out->b_seconds = tb.median;
+    out->ratio = tb.median > 0 ? ta.median / tb.median : INFINITY;
+    out->p_value = out->ratio < 1.0 ?
+        wisdom_mann_whitney_slower(ta.samples, ta.sample_count, tb.samples, tb.sample_count) :
+        wisdom_mann_whitney_slower(tb.samples, tb.sample_count, ta.samples, ta.sample_count);
+
+    if (report->point_count < WISDOM_FIT_MAX_POINTS) report->points[report->point_count++] = *out;
+    return 0;
+}
+
+/*
+ * Locate the crossover between a and b. Returns 0 on success (check
+ * report->found), -1 on invalid config or a failed measurement.
+ */
+static inline int wisdom_find_crossover(const WisdomCrossoverConfig* config, const WisdomWorkload* a,
+                                        const WisdomWorkload* b, WisdomCrossoverReport* report) {
+    memset(report, 0, sizeof(*report));
+    if (!a->run || !b->run || config->min_n == 0 || config->max_n < config->min_n || !(config->growth > 1.0)) {
+        return -1;
+    }
+
+    // Coarse scan: remember the first bracket where the winner flips
+    WisdomCrossoverPoint previous, current;
+    WisdomCrossoverPoint low = { 0 }, high = { 0 };
+    if (wisdom_crossover_point(config, a, b, config->min_n, report, &previous) != 0) return -1;
+    report->a_wins_small = previous.ratio < 1.0;
+
+    double size = (double)config->min_n;
+    while (size < (double)config->max_n) {
+        size *= config->growth;
+        size_t n = size < (double)config->max_n ? (size_t)(size + 0.5) : config->max_n;
+        if (n == previous.n) continue;
+        if (wisdom_crossover_point(config, a, b, n, report, &current) != 0) return -1;
+
+        if ((current.ratio < 1.0) != (previous.ratio < 1.0)) {
+            if (report->found) {
+                report->multiple = 1;
+                break;
+            }
+            report->found = 1;
+            low = previous;
+            high = current;
+        }
+        previous = current;
+    }
+
+    if (!report->found) {
+        report->confidence = 1.0 - previous.p_value;
+        return 0;
+    }
+
+    // Bisect in log space
+    double resolution = config->resolution > 0 ? config->resolution : 0.05;
+    while (high.n - low.n > 1 && (double)high.n > (double)low.n * (1.0 + resolution) &&
+           report->point_count < WISDOM_FIT_MAX_POINTS) {
+        size_t middle = (size_t)(sqrt((double)low.n * (double)high.n) + 0.5);
+        if (middle <= low.n) middle = low.n + 1;
+        if (middle >= high.n) middle = high.n - 1;
+
+        if (wisdom_crossover_point(config, a, b, middle, report, &current) != 0) return -1;
+        if ((current.ratio < 1.0) == (low.ratio < 1.0)) low = current;
+        else high = current;
+    }
+
+    report->low_n = low.n;
+    report->high_n = high.n;
+    report->crossover_n = (size_t)(sqrt((double)low.n * (double)high.n) + 0.5);
+
+    double p = fmax(low.p_value, high.p_value);
+    report->confidence = isnan(p) ? 0.0 : 1.0 - p;
+    return 0;
+}
+
+static inline void wisdom_print_crossover(const WisdomCrossoverReport* report, const char* name_a, const char* name_b,
+                                          FILE* out) {
+    fprintf(out, "%12s %14s %14s %8s %10s\n", "n", name_a, name_b, "A/B", "p");
+    for (size_t i = 0; i < report->point_count; i++) {
+        const WisdomCrossoverPoint* point = &report->points[i];
+        fprintf(out, "%12zu %14.6g %14.6g %8.3f %10.3g\n",
+                point->n, point->a_seconds, point->b_seconds, point->ratio, point->p_value);
+    }
+
+    const char* small = report->a_wins_small ? name_a : name_b;
+    const char* large = report->a_wins_small ? name_b : name_a;
+    if (!report->found) {
+        fprintf(out, "no crossover: %s is faster over the whole range (confidence %.3f)\n",
+                small, report->confidence);
+        return;
+    }
+    fprintf(out, "crossover at n ~ %zu (between %zu and %zu): %s below, %s above, confidence %.3f%s\n",
+            report->crossover_n, report->low_n, report->high_n, small, large, report->confidence,
+            report->multiple ? " (winner changes more than once)" : "");
+}
+
+#endif // O_WISDOM_CROSSOVER_H
@@ -0,0 +1,384 @@
+#ifndef O_WISDOM_ENV_H
+#define O_WISDOM_ENV_H
+
+/*
+ * O_wisdom - measurement environment control
+ *
+ * Before measuring:
+ *   - wisdom_env_detect reads the CPU model, isolated CPUs
+ *     (/sys/devices/system/cpu/isolated), frequency governor and driver,
+ *     turbo/boost state, SMT, load average and ASLR from sysfs and procfs.
+ *   - wisdom_env_warn prints what makes numbers unreliable: a governor other
+ *     than "performance", turbo enabled, no isolated CPUs, a busy host.
+ *   - wisdom_env_pin pins the calling thread to an isolated CPU (or to the
+ *     CPU it is on when none is isolated) so it stops migrating;
+ *     wisdom_env_measurement_cpus lists CPUs for measurement threads.
+ *   - wisdom_env_fingerprint condenses the environment into one line with a
+ *     hash, to be stored next to results (see WisdomBaseline.environment);
+ *     comparisons across different fingerprints are flagged.
+ *
+ * wisdom_time_interleaved measures two variants in randomly ordered rounds
+ * so slow drift (thermal, frequency, neighbours) hits both equally instead
+ * of biasing whichever ran second.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include "O_wisdom_timing.h"
+
+#define WISDOM_ENV_MAX_CPUS     1024
+#define WISDOM_ENV_TEXT         128
+
+typedef struct {
+    char hostname[WISDOM_ENV_TEXT];
+    char kernel[WISDOM_ENV_TEXT];
+    char cpu_model[WISDOM_ENV_TEXT];
+    char compiler[WISDOM_ENV_TEXT];
+    long online_cpus;
+
+    char isolated_text[WISDOM_ENV_TEXT];
+    int isolated[WISDOM_ENV_MAX_CPUS];
+    size_t isolated_count;
+
+    char governor[32];          // Of the measured CPU; "mixed" if CPUs differ, "" if unknown
+    char driver[32];
+    int turbo;                  // 1 on, 0 off, -1 unknown
+    int smt;                    // 1 active, 0 inactive, -1 unknown
+    long min_khz;
+    long max_khz;
+    double loadavg;             // 1-minute
+    int aslr;                   // randomize_va_space, -1 unknown
+
+    int pinned_cpu;             // -1 if not pinned
+    uint64_t hash;              // Over the fields that affect results
+} WisdomEnvironment;
+
+static inline int wisdom_env_read(const char* path, char* buffer, size_t size) {
+    FILE* file = fopen(path, "r");
+    if (!file) return -1;
+    int ok = fgets(buffer, (int)size, file) != NULL;
+    fclose(file);
+    if (!ok) return -1;
+    buffer[strcspn(buffer, "\n")] = '\0';
+    return 0;
+}
+
+static inline long wisdom_env_read_long(const char* path, long fallback) {
+    char text[64];
+    return wisdom_env_read(path, text, sizeof(text)) == 0 ? strtol(text, NULL, 10) : fallback;
+}
+
+// Parse a kernel CPU list such as "2-5,8"; returns the number of CPUs stored
+static inline size_t wisdom_env_parse_cpulist(const char* text, int* cpus, size_t max) {
+    size_t count = 0;
+    const char* p = text;
+    while (*p) {
+        char* end;
+        long first = strtol(p, &end, 10);
+        if (end == p) break;
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            p = end;
+        }
+        for (long cpu = first; cpu <= last && count < max; cpu++) cpus[count++] = (int)cpu;
+        if (*p == ',') p++;
+        else break;
+    }
+    return count;
+}
+
+static inline uint64_t wisdom_env_hash_text(uint64_t hash, const char* text) {
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash ^ 0xff;
+}
+
+static inline void wisdom_env_rehash(WisdomEnvironment* env) {
+    char numbers[128];
+    snprintf(numbers, sizeof(numbers), "%ld/%d/%d/%ld/%ld/%d", env->online_cpus, env->turbo, env->smt,
+             env->min_khz, env->max_khz, env->pinned_cpu >= 0);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = wisdom_env_hash_text(hash, env->hostname);
+    hash = wisdom_env_hash_text(hash, env->kernel);
+    hash = wisdom_env_hash_text(hash, env->cpu_model);
+    hash = wisdom_env_hash_text(hash, env->compiler);
+    hash = wisdom_env_hash_text(hash, env->governor);
+    hash = wisdom_env_hash_text(hash, env->driver);
+    hash = wisdom_env_hash_text(hash, numbers);
+    env->hash = hash;
+}
+
+static inline void wisdom_env_read_governor(WisdomEnvironment* env, int cpu) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", cpu);
+    if (wisdom_env_read(path, env->governor, sizeof(env->governor)) != 0) env->governor[0] = '\0';
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_driver", cpu);
+    if (wisdom_env_read(path, env->driver, sizeof(env->driver)) != 0) env->driver[0] = '\0';
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_min_freq", cpu);
+    env->min_khz = wisdom_env_read_long(path, 0);
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_max_freq", cpu);
+    env->max_khz = wisdom_env_read_long(path, 0);
+}
+
+static inline void wisdom_env_detect(WisdomEnvironment* env) {
+    memset(env, 0, sizeof(*env));
+    env->pinned_cpu = -1;
+
+    if (gethostname(env->hostname, sizeof(env->hostname) - 1) != 0) env->hostname[0] = '\0';
+    struct utsname name;
+    if (uname(&name) == 0) snprintf(env->kernel, sizeof(env->kernel), "%.32s %.64s", name.sysname, name.release);
+#ifdef __VERSION__
+    snprintf(env->compiler, sizeof(env->compiler), "%s", __VERSION__);
+#endif
+    env->online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    FILE* cpuinfo = fopen("/proc/cpuinfo", "r");
+    if (cpuinfo) {
+        char line[512];
+        while (fgets(line, sizeof(line), cpuinfo)) {
+            if (strncmp(line, "model name", 10) != 0) continue;
+            const char* value = strchr(line, ':');
+            if (value) {
+                value++;
+                while (*value == ' ' || *value == '\t') value++;
+                snprintf(env->cpu_model, sizeof(env->cpu_model), "%s", value);
+                env->cpu_model[strcspn(env->cpu_model, "\n")] = '\0';
+            }
+            break;
+        }
+        fclose(cpuinfo);
+    }
+
+    if (wisdom_env_read("/sys/devices/system/cpu/isolated", env->isolated_text, sizeof(env->isolated_text)) == 0) {
+        env->isolated_count = wisdom_env_parse_cpulist(env->isolated_text, env->isolated, WISDOM_ENV_MAX_CPUS);
+    }
+
+    // Governor of CPU 0, or "mixed" when any online CPU disagrees
+    wisdom_env_read_governor(env, 0);
+    for (long cpu = 1; cpu < env->online_cpus && env->governor[0]; cpu++) {
+        char path[128], other[32];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%ld/cpufreq/scaling_governor", cpu);
+        if (wisdom_env_read(path, other, sizeof(other)) == 0 && strcmp(other, env->governor) != 0) {
+            snprintf(env->governor, sizeof(env->governor), "mixed");
+        }
+    }
+
+    // intel_pstate reports the inverse (no_turbo); acpi-cpufreq and amd-pstate report boost
+    long no_turbo = wisdom_env_read_long("/sys/devices/system/cpu/intel_pstate/no_turbo", -1);
+    long boost = wisdom_env_read_long("/sys/devices/system/cpu/cpufreq/boost", -1);
+    env->turbo = no_turbo >= 0 ? !no_turbo : (boost >= 0 ? boost != 0 : -1);
+    long smt = wisdom_env_read_long("/sys/devices/system/cpu/smt/active", -1);
+    env->smt = smt >= 0 ? smt != 0 : -1;
+    env->aslr = (int)wisdom_env_read_long("/proc/sys/kernel/randomize_va_space", -1);
+
+    double load[1];
+    env->loadavg = getloadavg(load, 1) == 1 ? load[0] : -1.0;
+
+    wisdom_env_rehash(env);
+}
+
+/*
+ * Pin the calling thread. cpu < 0 picks the first isolated CPU, or the CPU
+ * the thread is running on when none is isolated. Returns the CPU pinned to,
+ * or -1 on failure.
+ */
+static inline int wisdom_env_pin(WisdomEnvironment* env, int cpu) {
+    if (cpu < 0) cpu = env->isolated_count ? env->isolated[0] : sched_getcpu();
+    if (cpu < 0) return -1;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) return -1;
+
+    // Report the governor of the CPU actually used
+    env->pinned_cpu = cpu;
+    wisdom_env_read_governor(env, cpu);
+    wisdom_env_rehash(env);
+    return cpu;
+}
+
+/*
+ * CPUs to run measurement threads on: the isolated CPUs the caller may be
+ * pinned to, then the rest of its affinity mask, so a restricted cpuset is
+ * honoured. Returns the number of CPUs stored, 0 if the mask is unreadable.
+ */
+static inline size_t wisdom_env_measurement_cpus(int* cpus, size_t max) {
+    cpu_set_t allowed;
+    if (pthread_getaffinity_np(pthread_self(), sizeof(allowed), &allowed) != 0) return 0;
+
+    char text[WISDOM_ENV_TEXT];
+    int isolated[WISDOM_ENV_MAX_CPUS];
+    size_t isolated_count = 0;
+    if (wisdom_env_read("/sys/devices/system/cpu/isolated", text, sizeof(text)) == 0) {
+        isolated_count = wisdom_env_parse_cpulist(text, isolated, WISDOM_ENV_MAX_CPUS);
+    }
+
+    // isolcpus= leaves isolated CPUs out of the default mask; only a pinning attempt shows the cpuset allows them
+    cpu_set_t taken;
+    CPU_ZERO(&taken);
+    size_t count = 0;
+    for (size_t i = 0; i < isolated_count && count < max; i++) {
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(isolated[i], &one);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(one), &one) != 0) continue;
+        CPU_SET(isolated[i], &taken);
+        cpus[count++] = isolated[i];
+    }
+    if (isolated_count) pthread_setaffinity_np(pthread_self(), sizeof(allowed), &allowed);
+
+    for (int cpu = 0; cpu < CPU_SETSIZE && count < max; cpu++) {
+        if (CPU_ISSET(cpu, &allowed) && !CPU_ISSET(cpu, &taken)) cpus[count++] = cpu;
+    }
+    return count;
+}
+
+// Print a line per issue that makes measurements noisy; returns the number of warnings
+static inline int wisdom_env_warn(const WisdomEnvironment* env, FILE* out) {
+    int warnings = 0;
+    if (env->governor[0] && strcmp(env->governor, "performance") != 0) {
+        fprintf(out, "warning: CPU frequency governor is \"%s\", not \"performance\"\n", env->governor);
+        warnings++;
+    }
+    if (env->turbo == 1) {
+        fprintf(out, "warning: turbo/boost is enabled; clock speed depends on temperature and load\n");
+        warnings++;
+    }
+    if (env->isolated_count == 0) {
+        fprintf(out, "warning: no isolated CPUs (isolcpus=); the scheduler may run other work on the measured CPU\n");
+        warnings++;
+    } else if (env->pinned_cpu >= 0) {
+        int isolated = 0;
+        for (size_t i = 0; i < env->isolated_count; i++) isolated |= env->isolated[i] == env->pinned_cpu;
+        if (!isolated) {
+            fprintf(out, "warning: pinned to CPU %d, which is not isolated\n", env->pinned_cpu);
+            warnings++;
+        }
+    }
+    if (env->pinned_cpu < 0) {
+        fprintf(out, "warning: measuring thread is not pinned\n");
+        warnings++;
+    }
+    if (env->loadavg > 0.5 * (double)(env->online_cpus > 0 ? env->online_cpus : 1)) {
+        fprintf(out, "warning: load average %.2f on %ld CPUs; the host is busy\n", env->loadavg, env->online_cpus);
+        warnings++;
+    }
+    if (env->aslr > 0) {
+        fprintf(out, "note: ASLR is on; layout-sensitive code may vary between runs\n");
+    }
+    return warnings;
+}
+
+// One-line fingerprint, e.g. for WisdomBaseline.environment
+static inline void wisdom_env_fingerprint(const WisdomEnvironment* env, char* buffer, size_t size) {
+    snprintf(buffer, size, "%016llx host=%s cpu=%s cpus=%ld governor=%s turbo=%s smt=%s pinned=%d kernel=%s cc=%s",
+             (unsigned long long)env->hash, env->hostname, env->cpu_model, env->online_cpus,
+             env->governor[0] ? env->governor : "unknown",
+             env->turbo < 0 ? "unknown" : (env->turbo ? "on" : "off"),
+             env->smt < 0 ? "unknown" : (env->smt ? "on" : "off"),
+             env->pinned_cpu, env->kernel, env->compiler);
+}
+
+static inline void wisdom_env_print(const WisdomEnvironment* env, FILE* out) {
+    fprintf(out, "host       %s (%s)\n", env->hostname, env->kernel);
+    fprintf(out, "cpu        %s, %ld online, isolated [%s]\n", env->cpu_model, env->online_cpus, env->isolated_text);
+    fprintf(out, "frequency  governor %s, driver %s, %ld-%ld MHz, turbo %s, smt %s\n",
+            env->governor[0] ? env->governor : "unknown", env->driver[0] ? env->driver : "unknown",
+            env->min_khz / 1000, env->max_khz / 1000,
+            env->turbo < 0 ? "unknown" : (env->turbo ? "on" : "off"),
+            env->smt < 0 ? "unknown" : (env->smt ? "on" : "off"));
+    fprintf(out, "pinned     %d, load %.2f, fingerprint %016llx\n", env->pinned_cpu, env->loadavg,
+            (unsigned long long)env->hash);
+}
+
+/* ---------------------------------------------------------------------------
+ * Randomly interleaved A/B measurement
+ * ------------------------------------------------------------------------- */
+
+static inline size_t wisdom_interleave_calibrate(const WisdomTimingConfig* config, const WisdomWorkload* workload,
+                                                 void* state, size_t n) {
+    size_t iterations = 1;
+    while (wisdom_timing_sample(workload, state, n, iterations) < config->min_sample_seconds &&
+           iterations < ((size_t)1 << 40)) {
+        iterations *= 2;
+    }
+    return iterations;
+}
+
+/*
+ * Measure a and b at size n in `rounds` rounds; each round takes one sample
+ * of each in random order. config may be NULL for defaults. Results are
+ * summarised exactly like wisdom_time_robust. Returns 0 on success, -1 on
+ * invalid input or when either prepare() returns NULL.
+ */
+static inline int wisdom_time_interleaved(const WisdomTimingConfig* config, const WisdomWorkload* a,
+                                          const WisdomWorkload* b, size_t n, size_t rounds, uint64_t seed,
+                                          WisdomTimingResult* result_a, WisdomTimingResult* result_b) {
+    WisdomTimingConfig defaults;
+    if (!config) {
+        wisdom_timing_defaults(&defaults);
+        config = &defaults;
+    }
+    memset(result_a, 0, sizeof(*result_a));
+    memset(result_b, 0, sizeof(*result_b));
+    if (!a->run || !b->run) return -1;
+    if (rounds == 0 || rounds > WISDOM_TIMING_MAX_SAMPLES) rounds = WISDOM_TIMING_MAX_SAMPLES;
+
+    wisdom_clock_init();
+    result_a->clock = result_b->clock = wisdom_clock.source;
+
+    void* state_a = a->prepare ? a->prepare(n, a->user_data) : NULL;
+    void* state_b = b->prepare ? b->prepare(n, b->user_data) : NULL;
+    if ((a->prepare && !state_a) || (b->prepare && !state_b)) {
+        if (state_a && a->release) a->release(state_a, a->user_data);
+        if (state_b && b->release) b->release(state_b, b->user_data);
+        return -1;
+    }
+    result_a->iterations = wisdom_interleave_calibrate(config, a, state_a, n);
+    result_b->iterations = wisdom_interleave_calibrate(config, b, state_b, n);
+
+    // Short alternating warm-up so neither variant starts cold
+    size_t warmup = config->warmup_window ? config->warmup_window : 1;
+    for (size_t i = 0; i < warmup; i++) {
+        wisdom_timing_sample(a, state_a, n, result_a->iterations);
+        wisdom_timing_sample(b, state_b, n, result_b->iterations);
+    }
+    result_a->warmup_samples = result_b->warmup_samples = warmup;
+    result_a->warmed_up = result_b->warmed_up = 1;
+
+    double raw_a[WISDOM_TIMING_MAX_SAMPLES], raw_b[WISDOM_TIMING_MAX_SAMPLES];
+    uint64_t rng = seed ? seed : 0x9e3779b97f4a7c15ULL;
+    for (size_t r = 0; r < rounds; r++) {
+        if (wisdom_timing_rand(&rng) & 1) {
+            raw_a[r] = wisdom_timing_sample(a, state_a, n, result_a->iterations) / (double)result_a->iterations;
+            raw_b[r] = wisdom_timing_sample(b, state_b, n, result_b->iterations) / (double)result_b->iterations;
+        } else {
+            raw_b[r] = wisdom_timing_sample(b, state_b, n, result_b->iterations) / (double)result_b->iterations;
+            raw_a[r] = wisdom_timing_sample(a, state_a, n, result_a->iterations) / (double)result_a->iterations;
+        }
+    }
+
+    if (a->release) a->release(state_a, a->user_data);
+    if (b->release) b->release(state_b, b->user_data);
+
+    wisdom_timing_summarize(config, raw_a, rounds, result_a);
+    wisdom_timing_summarize(config, raw_b, rounds, result_b);
+    return 0;
+}
+
+#endif // O_WISDOM_ENV_H
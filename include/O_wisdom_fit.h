@@ -0,0 +1,398 @@
+#ifndef O_WISDOM_FIT_H
+#define O_WISDOM_FIT_H
+
+/*
+ * O_wisdom - empirical complexity fitting
+ *
+ * Times a workload at geometrically spaced input sizes and fits
+ *     t(n) = a + b * f(n)
+ * for f in {1, log n, n, n log n, n^2, n^3, 2^n} by weighted least squares.
+ * Weights are 1/t^2, so every size contributes its relative error rather
+ * than letting the largest n dominate the fit.
+ *
+ * Models are tried simplest first and a more complex one only replaces the
+ * current best when all of the following hold:
+ *   - its residual is below WISDOM_FIT_PARSIMONY times the current best's;
+ *   - the current best's residual is not already at rounding level;
+ *   - in the nested model a + b * f_best(n) + c * f(n), the extra term is
+ *     significant by an F-test at WISDOM_FIT_ALPHA (Bonferroni-corrected
+ *     over the candidates) and moves the fit by at least
+ *     WISDOM_FIT_MIN_EFFECT of its value across the sweep.
+ * Noise alone therefore leaves a flat series at O(1) instead of promoting it
+ * to whichever curve happens to follow the jitter.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define WISDOM_FIT_MAX_POINTS   64
+#define WISDOM_FIT_PARSIMONY    0.9
+#define WISDOM_FIT_EXACT        1e-20   // Weighted residuals are relative, so this is absolute
+#define WISDOM_FIT_ALPHA        0.01    // Family-wise false-growth rate
+#define WISDOM_FIT_MIN_EFFECT   0.1     // Smallest growth term worth reporting, relative
+
+typedef enum {
+    WISDOM_MODEL_CONSTANT,
+    WISDOM_MODEL_LOG,
+    WISDOM_MODEL_LINEAR,
+    WISDOM_MODEL_NLOGN,
+    WISDOM_MODEL_QUADRATIC,
+    WISDOM_MODEL_CUBIC,
+    WISDOM_MODEL_EXPONENTIAL,
+    WISDOM_MODEL_COUNT
+} WisdomModel;
+
+// Timed workload: prepare and release run outside the measured region
+typedef struct {
+    void* (*prepare)(size_t n, void* user_data);
+    void (*run)(void* state, size_t n, void* user_data);
+    void (*release)(void* state, void* user_data);
+    void* user_data;
+} WisdomWorkload;
+
+typedef struct {
+    size_t min_n;
+    size_t max_n;
+    double growth;          // Ratio between consecutive sizes, > 1
+    size_t repetitions;     // Runs per size; the median is kept
+} WisdomSweepConfig;
+
+typedef struct {
+    WisdomModel model;
+    int valid;              // 0 if f(n) overflowed or the slope came out negative
+    double a;               // Constant term
+    double b;               // Coefficient of f(n)
+    double rss;             // Weighted residual sum of squares
+    double r_squared;       // Weighted coefficient of determination
+} WisdomModelFit;
+
+typedef struct {
+    size_t point_count;
+    double n[WISDOM_FIT_MAX_POINTS];
+    double value[WISDOM_FIT_MAX_POINTS];    // Seconds, or any other measured cost
+    WisdomModelFit fits[WISDOM_MODEL_COUNT];
+    WisdomModel best;
+    double p_value;         // F-test p of the last accepted growth term; 1 when best is O(1)
+} WisdomComplexityReport;
+
+static inline const char* wisdom_model_name(WisdomModel model) {
+    static const char* names[WISDOM_MODEL_COUNT] = {
+        "O(1)", "O(log n)", "O(n)", "O(n log n)", "O(n^2)", "O(n^3)", "O(2^n)"
+    };
+    return (unsigned)model < WISDOM_MODEL_COUNT ? names[model] : "?";
+}
+
+static inline double wisdom_model_eval(WisdomModel model, double n) {
+    switch (model) {
+        case WISDOM_MODEL_CONSTANT:    return 1.0;
+        case WISDOM_MODEL_LOG:         return log2(n > 1.0 ? n : 1.0);
+        case WISDOM_MODEL_LINEAR:      return n;
+        case WISDOM_MODEL_NLOGN:       return n * log2(n > 1.0 ? n : 1.0);
+        case WISDOM_MODEL_QUADRATIC:   return n * n;
+        case WISDOM_MODEL_CUBIC:       return n * n * n;
+        case WISDOM_MODEL_EXPONENTIAL: return exp2(n);
+        default:                       return NAN;
+    }
+}
+
+// Predicted cost of a fitted model at size n
+static inline double wisdom_model_predict(const WisdomModelFit* fit, double n) {
+    return fit->a + fit->b * wisdom_model_eval(fit->model, n);
+}
+
+static inline void wisdom_fit_model(WisdomModel model, const double* n, const double* y, size_t count,
+                                    WisdomModelFit* fit) {
+    memset(fit, 0, sizeof(*fit));
+    fit->model = model;
+
+    double s = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (size_t i = 0; i < count; i++) {
+        double x = wisdom_model_eval(model, n[i]);
+        if (!isfinite(x) || y[i] <= 0) return;
+
+        double w = 1.0 / (y[i] * y[i]);
+        s += w;
+        sx += w * x;
+        sy += w * y[i];
+        sxx += w * x * x;
+        sxy += w * x * y[i];
+    }
+    if (s == 0) return;
+
+    if (model == WISDOM_MODEL_CONSTANT) {
+        fit->a = sy / s;
+        fit->b = 0;
+    } else {
+        double denominator = s * sxx - sx * sx;
+        if (!(fabs(denominator) > 1e-300) || !isfinite(denominator)) return;
+        fit->b = (s * sxy - sx * sy) / denominator;
+        fit->a = (sy - fit->b * sx) / s;
+        if (!(fit->b > 0) || !isfinite(fit->a)) return;
+    }
+
+    double mean = sy / s;
+    double rss = 0, tss = 0;
+    for (size_t i = 0; i < count; i++) {
+        double w = 1.0 / (y[i] * y[i]);
+        double residual = y[i] - wisdom_model_predict(fit, n[i]);
+        rss += w * residual * residual;
+        tss += w * (y[i] - mean) * (y[i] - mean);
+    }
+
+    fit->rss = rss;
+    fit->r_squared = tss > 0 ? 1.0 - rss / tss : 1.0;
+    fit->valid = isfinite(rss);
+}
+
+// Regularized incomplete beta I_x(a, b), by Lentz's continued fraction
+static inline double wisdom_incomplete_beta(double a, double b, double x) {
+    if (!(x > 0)) return 0.0;
+    if (x >= 1) return 1.0;
+    // The fraction converges quickly only below the mean; reflect above it
+    if (x > (a + 1) / (a + b + 2)) return 1.0 - wisdom_incomplete_beta(b, a, 1.0 - x);
+
+    const double tiny = 1e-300;
+    double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log1p(-x)) / a;
+    double c = 1.0;
+    double d = 1.0 - (a + b) * x / (a + 1);
+    d = 1.0 / (fabs(d) < tiny ? tiny : d);
+    double f = d;
+
+    for (int m = 1; m <= 300; m++) {
+        for (int odd = 0; odd < 2; odd++) {
+            double numerator = odd ? -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1))
+                                   : m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+            d = 1.0 + numerator * d;
+            c = 1.0 + numerator / c;
+            d = 1.0 / (fabs(d) < tiny ? tiny : d);
+            if (fabs(c) < tiny) c = tiny;
+            f *= c * d;
+        }
+        if (fabs(c * d - 1.0) < 1e-12) break;
+    }
+    return front * f;
+}
+
+// Upper tail P(F > f) of the F distribution with (d1, d2) degrees of freedom
+static inline double wisdom_f_upper(double f, double d1, double d2) {
+    if (!(f > 0)) return 1.0;
+    if (isinf(f)) return 0.0;
+    return wisdom_incomplete_beta(d2 / 2, d1 / 2, d2 / (d2 + d1 * f));
+}
+
+/*
+ * Does f_high(n) add real growth on top of the current best model low?
+ * Fits value = a + b * f_low(n) + c * f_high(n) (without the f_low column
+ * when low is O(1)) under the same 1/t^2 weights and F-tests the drop in
+ * residual against low's own fit. Returns the p-value, or 1 when the extra
+ * term is negative, too small to matter, or there are too few points.
+ */
+static inline double wisdom_fit_nested_p(const WisdomComplexityReport* report, WisdomModel low, WisdomModel high) {
+    const double* n = report->n;
+    const double* y = report->value;
+    size_t count = report->point_count;
+    int columns = low == WISDOM_MODEL_CONSTANT ? 2 : 3;
+    if (count <= (size_t)columns) return 1.0;
+
+    // Scale each column to unit maximum so the normal equations stay conditioned
+    double scale[3] = { 1.0, 0.0, 0.0 };
+    for (size_t i = 0; i < count; i++) {
+        if (columns == 3) scale[1] = fmax(scale[1], fabs(wisdom_model_eval(low, n[i])));
+        scale[columns - 1] = fmax(scale[columns - 1], fabs(wisdom_model_eval(high, n[i])));
+    }
+    for (int j = 1; j < columns; j++) {
+        if (!(scale[j] > 0) || !isfinite(scale[j])) return 1.0;
+    }
+
+    double m[3][4] = { { 0 } };
+    for (size_t i = 0; i < count; i++) {
+        double x[3] = { 1.0, 0.0, 0.0 };
+        if (columns == 3) x[1] = wisdom_model_eval(low, n[i]) / scale[1];
+        x[columns - 1] = wisdom_model_eval(high, n[i]) / scale[columns - 1];
+        double w = 1.0 / (y[i] * y[i]);
+        for (int r = 0; r < columns; r++) {
+            for (int c = 0; c < columns; c++) m[r][c] += w * x[r] * x[c];
+            m[r][columns] += w * x[r] * y[i];
+        }
+    }
+
+    // Gaussian elimination with partial pivoting
+    for (int k = 0; k < columns; k++) {
+        int pivot = k;
+        for (int r = k + 1; r < columns; r++) {
+            if (fabs(m[r][k]) > fabs(m[pivot][k])) pivot = r;
+        }
+        if (!(fabs(m[pivot][k]) > 1e-300)) return 1.0;
+        for (int c = 0; c <= columns; c++) {
+            double t = m[k][c];
+            m[k][c] = m[pivot][c];
+            m[pivot][c] = t;
+        }
+        for (int r = k + 1; r < columns; r++) {
+            double factor = m[r][k] / m[k][k];
+            for (int c = k; c <= columns; c++) m[r][c] -= factor * m[k][c];
+        }
+    }
+    double coef[3] = { 0, 0, 0 };
+    for (int k = columns - 1; k >= 0; k--) {
+        double sum = m[k][columns];
+        for (int c = k + 1; c < columns; c++) sum -= m[k][c] * coef[c];
+        coef[k] = sum / m[k][k];
+    }
+    double extra = coef[columns - 1] / scale[columns - 1];
+    if (!(extra > 0)) return 1.0;
+
+    double rss = 0;
+    double n_min = n[0], n_max = n[0];
+    for (size_t i = 0; i < count; i++) {
+        double predicted = coef[0] + extra * wisdom_model_eval(high, n[i]);
+        if (columns == 3) predicted += coef[1] / scale[1] * wisdom_model_eval(low, n[i]);
+        double residual = (y[i] - predicted) / y[i];
+        rss += residual * residual;
+        n_min = fmin(n_min, n[i]);
+        n_max = fmax(n_max, n[i]);
+    }
+
+    // The growth term must move the fit by a meaningful fraction of its value
+    double predicted_max = coef[0] + extra * wisdom_model_eval(high, n_max);
+    if (columns == 3) predicted_max += coef[1] / scale[1] * wisdom_model_eval(low, n_max);
+    double effect = extra * (wisdom_model_eval(high, n_max) - wisdom_model_eval(high, n_min));
+    if (!(predicted_max > 0) || !(effect >= WISDOM_FIT_MIN_EFFECT * predicted_max)) return 1.0;
+
+    double rss_low = report->fits[low].rss;
+    if (!(rss < rss_low)) return 1.0;
+    if (rss <= WISDOM_FIT_EXACT) return 0.0;
+
+    double df = (double)(count - (size_t)columns);
+    return wisdom_f_upper((rss_low - rss) / (rss / df), 1.0, df);
+}
+
+/*
+ * Fit every candidate model to (n, value) pairs. Values must be positive.
+ * Returns 0 on success, -1 if fewer than three points or no model is valid.
+ */
+static inline int wisdom_fit_complexity(const double* n, const double* value, size_t count,
+                                        WisdomComplexityReport* report) {
+    memset(report, 0, sizeof(*report));
+    if (count < 3 || count > WISDOM_FIT_MAX_POINTS) return -1;
+
+    report->point_count = count;
+    memcpy(report->n, n, count * sizeof(double));
+    memcpy(report->value, value, count * sizeof(double));
+
+    report->p_value = 1.0;
+    double alpha = WISDOM_FIT_ALPHA / (WISDOM_MODEL_COUNT - 1);
+
+    int found = 0;
+    for (int m = 0; m < WISDOM_MODEL_COUNT; m++) {
+        WisdomModelFit* fit = &report->fits[m];
+        wisdom_fit_model((WisdomModel)m, n, value, count, fit);
+        if (!fit->valid) continue;
+        if (!found) {
+            report->best = (WisdomModel)m;
+            found = 1;
+            continue;
+        }
+
+        // Models are ordered simplest first
+        const WisdomModelFit* best = &report->fits[report->best];
+        if (best->rss <= WISDOM_FIT_EXACT || !(fit->rss < WISDOM_FIT_PARSIMONY * best->rss)) continue;
+
+        double p = wisdom_fit_nested_p(report, report->best, (WisdomModel)m);
+        if (p < alpha) {
+            report->best = (WisdomModel)m;
+            report->p_value = p;
+        }
+    }
+    return found ? 0 : -1;
+}
+
+static inline double wisdom_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static inline int wisdom_compare_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Median wall time of `repetitions` runs of the workload at size n, or -1 if prepare() fails
+static inline double wisdom_time_workload(const WisdomWorkload* workload, size_t n, size_t repetitions) {
+    double samples[64];
+    if (repetitions == 0) repetitions = 1;
+    if (repetitions > 64) repetitions = 64;
+
+    for (size_t r = 0; r < repetitions; r++) {
+        void* state = workload->prepare ? workload->prepare(n, workload->user_data) : NULL;
+        if (workload->prepare && !state) return -1.0;
+
+        double start = wisdom_now();
+        workload->run(state, n, workload->user_data);
+        samples[r] = wisdom_now() - start;
+        if (workload->release) workload->release(state, workload->user_data);
+    }
+
+    qsort(samples, repetitions, sizeof(double), wisdom_compare_double);
+    return samples[repetitions / 2];
+}
+
+/*
+ * Time the workload at min_n, min_n*growth, ... up to max_n and fit the
+ * candidate models. A workload whose prepare() returns NULL has failed.
+ * Returns 0 on success, -1 on invalid config, failed prepare or failed fit.
+ */
+static inline int wisdom_measure_complexity(const WisdomSweepConfig* config, const WisdomWorkload* workload,
+                                            WisdomComplexityReport* report) {
+    double n[WISDOM_FIT_MAX_POINTS];
+    double seconds[WISDOM_FIT_MAX_POINTS];
+    size_t count = 0;
+
+    memset(report, 0, sizeof(*report));
+    if (!workload->run || config->min_n == 0 || config->max_n < config->min_n || !(config->growth > 1.0)) {
+        return -1;
+    }
+
+    double size = (double)config->min_n;
+    size_t previous = 0;
+    while (size <= (double)config->max_n && count < WISDOM_FIT_MAX_POINTS) {
+        size_t current = (size_t)(size + 0.5);
+        if (current != previous) {
+            n[count] = (double)current;
+            seconds[count] = wisdom_time_workload(workload, current, config->repetitions);
+            if (seconds[count] < 0) return -1;
+            // Clamp below-resolution timings so the 1/t^2 weights stay finite
+            if (seconds[count] < 1e-9) seconds[count] = 1e-9;
+            count++;
+            previous = current;
+        }
+        size *= config->growth;
+    }
+
+    return wisdom_fit_complexity(n, seconds, count, report);
+}
+
+static inline void wisdom_print_complexity(const WisdomComplexityReport* report, FILE* out) {
+    fprintf(out, "%-12s %14s %14s %12s\n", "model", "a", "b", "R^2");
+    for (int m = 0; m < WISDOM_MODEL_COUNT; m++) {
+        const WisdomModelFit* fit = &report->fits[m];
+        if (!fit->valid) {
+            fprintf(out, "%-12s %14s %14s %12s\n", wisdom_model_name(fit->model), "-", "-", "-");
+            continue;
+        }
+        fprintf(out, "%-12s %14.6g %14.6g %12.6f%s\n", wisdom_model_name(fit->model),
+                fit->a, fit->b, fit->r_squared, (WisdomModel)m == report->best ? "  <- best" : "");
+    }
+}
+
+#endif // O_WISDOM_FIT_H
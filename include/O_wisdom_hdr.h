@@ -0,0 +1,469 @@
+#ifndef O_WISDOM_HDR_H
+#define O_WISDOM_HDR_H
+
+/*
+ * O_wisdom - high dynamic range histogram
+ *
+ * Same bucket layout as HdrHistogram: values from lowest to highest are kept
+ * with a fixed number of significant decimal digits (1-5). Each power-of-two
+ * bucket is split into 2^k linear sub-buckets, so the relative error of any
+ * recorded value is below 10^-digits and memory grows only with the log of
+ * the range (3 digits over 1 ns .. 1 hour is 33792 counters).
+ *
+ * Counts are updated with relaxed atomic adds, so any thread may record into
+ * a histogram without locks. For hot paths a WisdomHdrRecorder spreads
+ * threads over several shard histograms so they do not contend on the same
+ * cache lines; wisdom_hdr_recorder_snapshot merges the shards for reading.
+ *
+ * The serialised form stores the layout and the exact min and max followed by
+ * the counts as zig-zag LEB128 varints with runs of empty buckets collapsed
+ * into one negative number, so sparse latency histograms encode to a few
+ * hundred bytes.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WISDOM_HDR_MAGIC            0x52444857u     // "WHDR"
+#define WISDOM_HDR_VERSION          1
+#define WISDOM_HDR_MAX_SHARDS       64
+
+typedef struct {
+    uint64_t lowest;                // Smallest discernible value, >= 1
+    uint64_t highest;               // Largest trackable value
+    int digits;                     // Significant decimal digits, 1..5
+
+    int unit_magnitude;
+    int sub_bucket_half_count_magnitude;
+    int64_t sub_bucket_count;
+    int64_t sub_bucket_half_count;
+    uint64_t sub_bucket_mask;
+    int bucket_count;
+    size_t counts_length;
+    uint64_t* counts;
+
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+} WisdomHdrHistogram;
+
+typedef struct {
+    size_t shard_count;
+    WisdomHdrHistogram shards[WISDOM_HDR_MAX_SHARDS];
+} WisdomHdrRecorder;
+
+/*
+ * Set up an empty histogram tracking lowest..highest with the given number
+ * of significant digits. Returns 0 on success, -1 on invalid arguments or
+ * allocation failure.
+ */
+static inline int init_wisdom_hdr(WisdomHdrHistogram* h, uint64_t lowest, uint64_t highest, int digits) {
+    memset(h, 0, sizeof(*h));
+    if (lowest < 1 || digits < 1 || digits > 5 || highest < 2 * lowest) return -1;
+
+    uint64_t largest_single_unit = 2;
+    for (int i = 0; i < digits; i++) largest_single_unit *= 10;
+
+    int sub_bucket_count_magnitude = (int)ceil(log2((double)largest_single_unit));
+    h->lowest = lowest;
+    h->highest = highest;
+    h->digits = digits;
+    h->sub_bucket_half_count_magnitude = (sub_bucket_count_magnitude > 1 ? sub_bucket_count_magnitude : 1) - 1;
+    h->unit_magnitude = (int)floor(log2((double)lowest));
+    h->sub_bucket_count = (int64_t)1 << (h->sub_bucket_half_count_magnitude + 1);
+    h->sub_bucket_half_count = h->sub_bucket_count / 2;
+    h->sub_bucket_mask = ((uint64_t)h->sub_bucket_count - 1) << h->unit_magnitude;
+    if (h->unit_magnitude + h->sub_bucket_half_count_magnitude + 1 > 62) return -1;
+
+    // Buckets needed so the last one covers highest
+    uint64_t smallest_untrackable = (uint64_t)h->sub_bucket_count << h->unit_magnitude;
+    int buckets = 1;
+    while (smallest_untrackable <= highest) {
+        if (smallest_untrackable > UINT64_MAX / 2) {
+            buckets++;
+            break;
+        }
+        smallest_untrackable <<= 1;
+        buckets++;
+    }
+    h->bucket_count = buckets;
+    h->counts_length = (size_t)(buckets + 1) * (size_t)h->sub_bucket_half_count;
+
+    h->counts = (uint64_t*)calloc(h->counts_length, sizeof(uint64_t));
+    if (!h->counts) return -1;
+    h->min = UINT64_MAX;
+    return 0;
+}
+
+static inline void cleanup_wisdom_hdr(WisdomHdrHistogram* h) {
+    free(h->counts);
+    memset(h, 0, sizeof(*h));
+}
+
+static inline void wisdom_hdr_reset(WisdomHdrHistogram* h) {
+    for (size_t i = 0; i < h->counts_length; i++) __atomic_store_n(&h->counts[i], 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->total, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->min, UINT64_MAX, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->max, 0, __ATOMIC_RELAXED);
+}
+
+/* ---------------------------------------------------------------------------
+ * Bucket arithmetic
+ * ------------------------------------------------------------------------- */
+
+static inline int wisdom_hdr_bucket_index(const WisdomHdrHistogram* h, uint64_t value) {
+    int pow2_ceiling = 64 - __builtin_clzll(value | h->sub_bucket_mask);
+    return pow2_ceiling - h->unit_magnitude - (h->sub_bucket_half_count_magnitude + 1);
+}
+
+static inline int64_t wisdom_hdr_sub_bucket_index(const WisdomHdrHistogram* h, uint64_t value, int bucket) {
+    return (int64_t)(value >> (bucket + h->unit_magnitude));
+}
+
+// Index into counts, or -1 if value is above the trackable range
+static inline int64_t wisdom_hdr_counts_index(const WisdomHdrHistogram* h, uint64_t value) {
+    int bucket = wisdom_hdr_bucket_index(h, value);
+    int64_t sub_bucket = wisdom_hdr_sub_bucket_index(h, value, bucket);
+    int64_t index = ((int64_t)(bucket + 1) << h->sub_bucket_half_count_magnitude) +
+                    (sub_bucket - h->sub_bucket_half_count);
+    return index >= 0 && (size_t)index < h->counts_length ? index : -1;
+}
+
+static inline uint64_t wisdom_hdr_value_at_index(const WisdomHdrHistogram* h, size_t index) {
+    int bucket = (int)(index >> h->sub_bucket_half_count_magnitude) - 1;
+    int64_t sub_bucket = (int64_t)(index & ((uint64_t)h->sub_bucket_half_count - 1)) + h->sub_bucket_half_count;
+    if (bucket < 0) {
+        sub_bucket -= h->sub_bucket_half_count;
+        bucket = 0;
+    }
+    return (uint64_t)sub_bucket << (bucket + h->unit_magnitude);
+}
+
+static inline uint64_t wisdom_hdr_equivalent_range(const WisdomHdrHistogram* h, uint64_t value) {
+    int bucket = wisdom_hdr_bucket_index(h, value);
+    int64_t sub_bucket = wisdom_hdr_sub_bucket_index(h, value, bucket);
+    int adjusted = sub_bucket >= h->sub_bucket_count ? bucket + 1 : bucket;
+    return (uint64_t)1 << (h->unit_magnitude + adjusted);
+}
+
+static inline uint64_t wisdom_hdr_lowest_equivalent(const WisdomHdrHistogram* h, uint64_t value) {
+    int bucket = wisdom_hdr_bucket_index(h, value);
+    int64_t sub_bucket = wisdom_hdr_sub_bucket_index(h, value, bucket);
+    return (uint64_t)sub_bucket << (bucket + h->unit_magnitude);
+}
+
+static inline uint64_t wisdom_hdr_highest_equivalent(const WisdomHdrHistogram* h, uint64_t value) {
+    return wisdom_hdr_lowest_equivalent(h, value) + wisdom_hdr_equivalent_range(h, value) - 1;
+}
+
+/* ---------------------------------------------------------------------------
+ * Recording
+ * ------------------------------------------------------------------------- */
+
+// Record count occurrences of value. Returns 0, or -1 if value is out of range
+static inline int wisdom_hdr_record_n(WisdomHdrHistogram* h, uint64_t value, uint64_t count) {
+    int64_t index = wisdom_hdr_counts_index(h, value);
+    if (index < 0 || value > h->highest) return -1;
+
+    __atomic_fetch_add(&h->counts[index], count, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->total, count, __ATOMIC_RELAXED);
+
+    uint64_t min = __atomic_load_n(&h->min, __ATOMIC_RELAXED);
+    while (value < min && !__atomic_compare_exchange_n(&h->min, &min, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    uint64_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while (value > max && !__atomic_compare_exchange_n(&h->max, &max, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    return 0;
+}
+
+static inline int wisdom_hdr_record(WisdomHdrHistogram* h, uint64_t value) {
+    return wisdom_hdr_record_n(h, value, 1);
+}
+
+/*
+ * Add every count of src into dst. Layouts may differ; values outside dst's
+ * range are dropped. Returns the number of dropped counts.
+ */
+static inline uint64_t wisdom_hdr_merge(WisdomHdrHistogram* dst, const WisdomHdrHistogram* src) {
+    uint64_t dropped = 0;
+    int same_layout = dst->counts_length == src->counts_length && dst->unit_magnitude == src->unit_magnitude &&
+                      dst->sub_bucket_half_count_magnitude == src->sub_bucket_half_count_magnitude;
+
+    for (size_t i = 0; i < src->counts_length; i++) {
+        uint64_t count = __atomic_load_n(&src->counts[i], __ATOMIC_RELAXED);
+        if (count == 0) continue;
+        if (same_layout) {
+            __atomic_fetch_add(&dst->counts[i], count, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&dst->total, count, __ATOMIC_RELAXED);
+        } else if (wisdom_hdr_record_n(dst, wisdom_hdr_value_at_index(src, i), count) != 0) {
+            dropped += count;
+        }
+    }
+
+    if (same_layout && __atomic_load_n(&src->total, __ATOMIC_RELAXED) > 0) {
+        uint64_t value = __atomic_load_n(&src->min, __ATOMIC_RELAXED);
+        uint64_t min = __atomic_load_n(&dst->min, __ATOMIC_RELAXED);
+        while (value < min &&
+               !__atomic_compare_exchange_n(&dst->min, &min, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+        value = __atomic_load_n(&src->max, __ATOMIC_RELAXED);
+        uint64_t max = __atomic_load_n(&dst->max, __ATOMIC_RELAXED);
+        while (value > max &&
+               !__atomic_compare_exchange_n(&dst->max, &max, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+    }
+    return dropped;
+}
+
+/* ---------------------------------------------------------------------------
+ * Queries
+ * ------------------------------------------------------------------------- */
+
+// Highest value such that `percentile` percent of recorded values are <= it
+static inline uint64_t wisdom_hdr_value_at_percentile(const WisdomHdrHistogram* h, double percentile) {
+    uint64_t total = __atomic_load_n(&h->total, __ATOMIC_RELAXED);
+    if (total == 0) return 0;
+    if (percentile > 100.0) percentile = 100.0;
+    if (percentile < 0.0) percentile = 0.0;
+
+    uint64_t wanted = (uint64_t)ceil(percentile / 100.0 * (double)total);
+    if (wanted < 1) wanted = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < h->counts_length; i++) {
+        seen += __atomic_load_n(&h->counts[i], __ATOMIC_RELAXED);
+        if (seen >= wanted) {
+            uint64_t value = wisdom_hdr_highest_equivalent(h, wisdom_hdr_value_at_index(h, i));
+            uint64_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+            return value < max ? value : max;
+        }
+    }
+    return __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+}
+
+static inline double wisdom_hdr_mean(const WisdomHdrHistogram* h) {
+    uint64_t total = __atomic_load_n(&h->total, __ATOMIC_RELAXED);
+    if (total == 0) return 0.0;
+    double sum = 0;
+    for (size_t i = 0; i < h->counts_length; i++) {
+        uint64_t count = __atomic_load_n(&h->counts[i], __ATOMIC_RELAXED);
+        if (!count) continue;
+        uint64_t value = wisdom_hdr_value_at_index(h, i);
+        double middle = (double)wisdom_hdr_lowest_equivalent(h, value) +
+                        (double)(wisdom_hdr_equivalent_range(h, value) >> 1);
+        sum += middle * (double)count;
+    }
+    return sum / (double)total;
+}
+
+static inline double wisdom_hdr_stddev(const WisdomHdrHistogram* h) {
+    uint64_t total = __atomic_load_n(&h->total, __ATOMIC_RELAXED);
+    if (total == 0) return 0.0;
+    double mean = wisdom_hdr_mean(h);
+    double sum = 0;
+    for (size_t i = 0; i < h->counts_length; i++) {
+        uint64_t count = __atomic_load_n(&h->counts[i], __ATOMIC_RELAXED);
+        if (!count) continue;
+        uint64_t value = wisdom_hdr_value_at_index(h, i);
+        double middle = (double)wisdom_hdr_lowest_equivalent(h, value) +
+                        (double)(wisdom_hdr_equivalent_range(h, value) >> 1);
+        sum += (middle - mean) * (middle - mean) * (double)count;
+    }
+    return sqrt(sum / (double)total);
+}
+
+// Summary at the usual SLO percentiles; unit_scale divides values (e.g. 1e3 for ns -> us)
+static inline void wisdom_hdr_print(const WisdomHdrHistogram* h, const char* unit, double unit_scale, FILE* out) {
+    static const double percentiles[] = { 50.0, 90.0, 99.0, 99.9, 99.99, 100.0 };
+    if (unit_scale <= 0) unit_scale = 1.0;
+    uint64_t total = __atomic_load_n(&h->total, __ATOMIC_RELAXED);
+
+    fprintf(out, "count %llu  min %.3f  mean %.3f  stddev %.3f %s\n", (unsigned long long)total,
+            total ? (double)__atomic_load_n(&h->min, __ATOMIC_RELAXED) / unit_scale : 0.0,
+            wisdom_hdr_mean(h) / unit_scale, wisdom_hdr_stddev(h) / unit_scale, unit ? unit : "");
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+        fprintf(out, "  p%-7g %14.3f %s\n", percentiles[i],
+                (double)wisdom_hdr_value_at_percentile(h, percentiles[i]) / unit_scale, unit ? unit : "");
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Per-thread sharded recorder
+ * ------------------------------------------------------------------------- */
+
+__attribute__((weak)) unsigned wisdom_hdr_next_thread;
+__attribute__((weak)) __thread unsigned wisdom_hdr_thread_slot;   // 0 until first use
+
+static inline int init_wisdom_hdr_recorder(WisdomHdrRecorder* recorder, size_t shard_count, uint64_t lowest,
+                                           uint64_t highest, int digits) {
+    memset(recorder, 0, sizeof(*recorder));
+    if (shard_count == 0) shard_count = 1;
+    if (shard_count > WISDOM_HDR_MAX_SHARDS) shard_count = WISDOM_HDR_MAX_SHARDS;
+
+    for (size_t i = 0; i < shard_count; i++) {
+        if (init_wisdom_hdr(&recorder->shards[i], lowest, highest, digits) != 0) {
+            for (size_t j = 0; j < i; j++) cleanup_wisdom_hdr(&recorder->shards[j]);
+            return -1;
+        }
+    }
+    recorder->shard_count = shard_count;
+    return 0;
+}
+
+static inline void cleanup_wisdom_hdr_recorder(WisdomHdrRecorder* recorder) {
+    for (size_t i = 0; i < recorder->shard_count; i++) cleanup_wisdom_hdr(&recorder->shards[i]);
+    recorder->shard_count = 0;
+}
+
+static inline int wisdom_hdr_recorder_record(WisdomHdrRecorder* recorder, uint64_t value) {
+    unsigned slot = wisdom_hdr_thread_slot;
+    if (slot == 0) {
+        slot = __atomic_add_fetch(&wisdom_hdr_next_thread, 1, __ATOMIC_RELAXED);
+        wisdom_hdr_thread_slot = slot;
+    }
+    return wisdom_hdr_record(&recorder->shards[(slot - 1) % recorder->shard_count], value);
+}
+
+// Merge all shards into out, which must have been initialised with the same layout
+static inline void wisdom_hdr_recorder_snapshot(const WisdomHdrRecorder* recorder, WisdomHdrHistogram* out) {
+    wisdom_hdr_reset(out);
+    for (size_t i = 0; i < recorder->shard_count; i++) wisdom_hdr_merge(out, &recorder->shards[i]);
+}
+
+/* ---------------------------------------------------------------------------
+ * Serialisation
+ * ------------------------------------------------------------------------- */
+
+static inline size_t wisdom_hdr_put_varint(unsigned char* buffer, size_t capacity, size_t at, uint64_t value) {
+    do {
+        unsigned char byte = value & 0x7f;
+        value >>= 7;
+        if (value) byte |= 0x80;
+        if (buffer && at < capacity) buffer[at] = byte;
+        at++;
+    } while (value);
+    return at;
+}
+
+static inline int wisdom_hdr_get_varint(const unsigned char* buffer, size_t length, size_t* at, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*at >= length) return -1;
+        unsigned char byte = buffer[(*at)++];
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static inline uint64_t wisdom_hdr_zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t wisdom_hdr_unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/*
+ * Encode h into buffer. Returns the encoded size; if it exceeds capacity
+ * nothing useful was written and the call should be repeated with a larger
+ * buffer (buffer may be NULL to query the size).
+ */
+static inline size_t wisdom_hdr_encode(const WisdomHdrHistogram* h, unsigned char* buffer, size_t capacity) {
+    size_t at = 0;
+    at = wisdom_hdr_put_varint(buffer, capacity, at, WISDOM_HDR_MAGIC);
+    at = wisdom_hdr_put_varint(buffer, capacity, at, WISDOM_HDR_VERSION);
+    at = wisdom_hdr_put_varint(buffer, capacity, at, h->lowest);
+    at = wisdom_hdr_put_varint(buffer, capacity, at, h->highest);
+    at = wisdom_hdr_put_varint(buffer, capacity, at, (uint64_t)h->digits);
+
+    // Buckets only bound a value to within its equivalent range, so keep the extremes exactly
+    uint64_t total = __atomic_load_n(&h->total, __ATOMIC_RELAXED);
+    at = wisdom_hdr_put_varint(buffer, capacity, at, total ? __atomic_load_n(&h->min, __ATOMIC_RELAXED) : 0);
+    at = wisdom_hdr_put_varint(buffer, capacity, at, total ? __atomic_load_n(&h->max, __ATOMIC_RELAXED) : 0);
+
+    // Trailing empty buckets are implied
+    size_t used = h->counts_length;
+    while (used > 0 && __atomic_load_n(&h->counts[used - 1], __ATOMIC_RELAXED) == 0) used--;
+    at = wisdom_hdr_put_varint(buffer, capacity, at, used);
+
+    for (size_t i = 0; i < used;) {
+        uint64_t count = __atomic_load_n(&h->counts[i], __ATOMIC_RELAXED);
+        if (count == 0) {
+            size_t run = 1;
+            while (i + run < used && __atomic_load_n(&h->counts[i + run], __ATOMIC_RELAXED) == 0) run++;
+            at = wisdom_hdr_put_varint(buffer, capacity, at, wisdom_hdr_zigzag(-(int64_t)run));
+            i += run;
+        } else {
+            at = wisdom_hdr_put_varint(buffer, capacity, at, wisdom_hdr_zigzag((int64_t)count));
+            i++;
+        }
+    }
+    return at;
+}
+
+static inline int wisdom_hdr_decode_counts(const unsigned char* buffer, size_t length, size_t at,
+                                           WisdomHdrHistogram* h) {
+    uint64_t used;
+    if (wisdom_hdr_get_varint(buffer, length, &at, &used) != 0 || used > h->counts_length) return -1;
+
+    for (size_t i = 0; i < used;) {
+        uint64_t raw;
+        if (wisdom_hdr_get_varint(buffer, length, &at, &raw) != 0) return -1;
+        int64_t value = wisdom_hdr_unzigzag(raw);
+        if (value < 0) {
+            if ((uint64_t)-value > used - i) return -1;
+            i += (size_t)-value;
+            continue;
+        }
+        h->counts[i] = (uint64_t)value;
+        h->total += (uint64_t)value;
+        if (value > 0) {
+            uint64_t low = wisdom_hdr_value_at_index(h, i);
+            if (low < h->min) h->min = low;
+            h->max = wisdom_hdr_highest_equivalent(h, low);
+        }
+        i++;
+    }
+    return 0;
+}
+
+// Decode into an uninitialised histogram. Returns 0 on success, -1 on malformed input
+static inline int wisdom_hdr_decode(const unsigned char* buffer, size_t length, WisdomHdrHistogram* h) {
+    size_t at = 0;
+    uint64_t magic, version, lowest, highest, digits, min, max;
+    memset(h, 0, sizeof(*h));
+    if (wisdom_hdr_get_varint(buffer, length, &at, &magic) != 0 || magic != WISDOM_HDR_MAGIC) return -1;
+    if (wisdom_hdr_get_varint(buffer, length, &at, &version) != 0 || version != WISDOM_HDR_VERSION) return -1;
+    if (wisdom_hdr_get_varint(buffer, length, &at, &lowest) != 0) return -1;
+    if (wisdom_hdr_get_varint(buffer, length, &at, &highest) != 0) return -1;
+    if (wisdom_hdr_get_varint(buffer, length, &at, &digits) != 0 || digits > 5) return -1;
+    if (wisdom_hdr_get_varint(buffer, length, &at, &min) != 0) return -1;
+    if (wisdom_hdr_get_varint(buffer, length, &at, &max) != 0) return -1;
+    if (init_wisdom_hdr(h, lowest, highest, (int)digits) != 0) return -1;
+
+    if (wisdom_hdr_decode_counts(buffer, length, at, h) != 0) {
+        cleanup_wisdom_hdr(h);
+        return -1;
+    }
+    // An extreme is only trusted inside its occupied bucket: a value recorded
+    // while the source was being encoded can leave them slightly out of step
+    if (h->total > 0) {
+        if (min <= h->highest && wisdom_hdr_lowest_equivalent(h, min) == h->min) h->min = min;
+        if (max <= h->highest && wisdom_hdr_highest_equivalent(h, max) == h->max) h->max = max;
+    }
+    return 0;
+}
+
+#endif // O_WISDOM_HDR_H
@@ -0,0 +1,300 @@
+#ifndef O_WISDOM_LOCK_H
+#define O_WISDOM_LOCK_H
+
+/*
+ * O_wisdom - lock contention profiling shim
+ *
+ * WisdomMutex wraps a pthread mutex. Subsystems lock it through the
+ * wisdom_mutex_lock / wisdom_mutex_unlock / wisdom_cond_wait macros, which
+ * compile to plain pthread calls unless WISDOM_LOCK_PROFILE is defined. With
+ * profiling on, every mutex records:
+ *   - acquisitions, and how many of them found the lock held,
+ *   - total and maximum wait time of contended acquisitions,
+ *   - total and maximum hold time,
+ *   - per call site (file, line, function) contention and wait time.
+ * An uncontended acquisition costs one trylock and one clock read; only
+ * contended ones pay for the site lookup.
+ *
+ * wisdom_lock_report prints the locks with the most total wait time and
+ * their worst call sites, which is where a flattening scaling curve from
+ * wisdom_measure_scaling usually comes from.
+ *
+ * Usage:
+ *   WisdomMutex lock;
+ *   init_wisdom_mutex(&lock, "tick stack");
+ *   wisdom_mutex_lock(&lock);
+ *   while (!ready) wisdom_cond_wait(&cond, &lock);
+ *   wisdom_mutex_unlock(&lock);
+ *   wisdom_lock_report(stdout, 10);
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "O_wisdom_timing.h"
+
+#define WISDOM_LOCK_MAX_SITES   16
+
+// One per call site, created by the locking macros
+typedef struct {
+    const char* file;
+    int line;
+    const char* function;
+} WisdomLockSite;
+
+typedef struct {
+    const WisdomLockSite* site;     // Claimed with CAS from NULL
+    uint64_t contentions;
+    uint64_t wait_ns;
+} WisdomLockSiteStats;
+
+typedef struct WisdomLockStats {
+    struct WisdomLockStats* next;   // Registry list, guarded by wisdom_lock_registry_lock
+    const char* name;
+    uint64_t acquisitions;
+    uint64_t contentions;
+    uint64_t wait_ns;
+    uint64_t max_wait_ns;
+    uint64_t hold_ns;
+    uint64_t max_hold_ns;
+    uint64_t other_site_contentions;    // Sites beyond WISDOM_LOCK_MAX_SITES
+    WisdomLockSiteStats sites[WISDOM_LOCK_MAX_SITES];
+} WisdomLockStats;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    uint64_t acquired_at;           // Written by the owner only
+    WisdomLockStats stats;
+} WisdomMutex;
+
+__attribute__((weak)) pthread_mutex_t wisdom_lock_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+__attribute__((weak)) WisdomLockStats* wisdom_lock_registry;
+
+static inline int init_wisdom_mutex(WisdomMutex* m, const char* name) {
+    memset(m, 0, sizeof(*m));
+    if (pthread_mutex_init(&m->mutex, NULL) != 0) return -1;
+    m->stats.name = name;
+
+    pthread_mutex_lock(&wisdom_lock_registry_lock);
+    m->stats.next = wisdom_lock_registry;
+    wisdom_lock_registry = &m->stats;
+    pthread_mutex_unlock(&wisdom_lock_registry_lock);
+    return 0;
+}
+
+static inline void cleanup_wisdom_mutex(WisdomMutex* m) {
+    pthread_mutex_lock(&wisdom_lock_registry_lock);
+    for (WisdomLockStats** link = &wisdom_lock_registry; *link; link = &(*link)->next) {
+        if (*link == &m->stats) {
+            *link = m->stats.next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&wisdom_lock_registry_lock);
+    pthread_mutex_destroy(&m->mutex);
+}
+
+static inline void wisdom_lock_max(uint64_t* target, uint64_t value) {
+    uint64_t current = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while (value > current &&
+           !__atomic_compare_exchange_n(target, &current, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static inline void wisdom_lock_note_site(WisdomLockStats* stats, const WisdomLockSite* site, uint64_t wait) {
+    for (size_t i = 0; i < WISDOM_LOCK_MAX_SITES; i++) {
+        WisdomLockSiteStats* slot = &stats->sites[i];
+        const WisdomLockSite* owner = __atomic_load_n(&slot->site, __ATOMIC_ACQUIRE);
+        if (owner == NULL) {
+            const WisdomLockSite* expected = NULL;
+            if (__atomic_compare_exchange_n(&slot->site, &expected, site, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                owner = site;
+            } else {
+                owner = expected;
+            }
+        }
+        if (owner == site) {
+            __atomic_fetch_add(&slot->contentions, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&slot->wait_ns, wait, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+    __atomic_fetch_add(&stats->other_site_contentions, 1, __ATOMIC_RELAXED);
+}
+
+// Lock m, accounting the wait to site if the mutex was held
+static inline int wisdom_mutex_lock_at(WisdomMutex* m, const WisdomLockSite* site) {
+    WisdomLockStats* stats = &m->stats;
+    __atomic_fetch_add(&stats->acquisitions, 1, __ATOMIC_RELAXED);
+
+    if (pthread_mutex_trylock(&m->mutex) != 0) {
+        uint64_t start = wisdom_monotonic_ns();
+        int result = pthread_mutex_lock(&m->mutex);
+        if (result != 0) return result;
+        uint64_t now = wisdom_monotonic_ns();
+        uint64_t wait = now - start;
+
+        __atomic_fetch_add(&stats->contentions, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats->wait_ns, wait, __ATOMIC_RELAXED);
+        wisdom_lock_max(&stats->max_wait_ns, wait);
+        wisdom_lock_note_site(stats, site, wait);
+        m->acquired_at = now;
+        return 0;
+    }
+    m->acquired_at = wisdom_monotonic_ns();
+    return 0;
+}
+
+// Account the hold time that ends now; caller holds m
+static inline void wisdom_mutex_note_release(WisdomMutex* m) {
+    uint64_t hold = wisdom_monotonic_ns() - m->acquired_at;
+    __atomic_fetch_add(&m->stats.hold_ns, hold, __ATOMIC_RELAXED);
+    wisdom_lock_max(&m->stats.max_hold_ns, hold);
+}
+
+static inline int wisdom_mutex_unlock_profiled(WisdomMutex* m) {
+    wisdom_mutex_note_release(m);
+    return pthread_mutex_unlock(&m->mutex);
+}
+
+/*
+ * The wait releases the mutex, so the hold ends before it and a new one
+ * starts on wake-up. pthread_cond_wait re-acquires the mutex internally and
+ * that wait cannot be told apart from the sleep itself, so it is not counted
+ * as contention; the wake-up only counts as an acquisition.
+ */
+static inline int wisdom_cond_wait_profiled(pthread_cond_t* cond, WisdomMutex* m) {
+    wisdom_mutex_note_release(m);
+    int result = pthread_cond_wait(cond, &m->mutex);
+    __atomic_fetch_add(&m->stats.acquisitions, 1, __ATOMIC_RELAXED);
+    m->acquired_at = wisdom_monotonic_ns();
+    return result;
+}
+
+static inline int wisdom_cond_timedwait_profiled(pthread_cond_t* cond, WisdomMutex* m,
+                                                 const struct timespec* deadline) {
+    wisdom_mutex_note_release(m);
+    int result = pthread_cond_timedwait(cond, &m->mutex, deadline);
+    __atomic_fetch_add(&m->stats.acquisitions, 1, __ATOMIC_RELAXED);
+    m->acquired_at = wisdom_monotonic_ns();
+    return result;
+}
+
+#ifdef WISDOM_LOCK_PROFILE
+
+#define WISDOM_LOCK_SITE_                                                                          \
+    ({                                                                                             \
+        static const WisdomLockSite wisdom_lock_site_ = { __FILE__, __LINE__, __func__ };          \
+        &wisdom_lock_site_;                                                                        \
+    })
+
+#define wisdom_mutex_lock(m)                    wisdom_mutex_lock_at((m), WISDOM_LOCK_SITE_)
+#define wisdom_mutex_unlock(m)                  wisdom_mutex_unlock_profiled(m)
+#define wisdom_cond_wait(cond, m)               wisdom_cond_wait_profiled((cond), (m))
+#define wisdom_cond_timedwait(cond, m, when)    wisdom_cond_timedwait_profiled((cond), (m), (when))
+
+#else
+
+#define wisdom_mutex_lock(m)                    pthread_mutex_lock(&(m)->mutex)
+#define wisdom_mutex_unlock(m)                  pthread_mutex_unlock(&(m)->mutex)
+#define wisdom_cond_wait(cond, m)               pthread_cond_wait((cond), &(m)->mutex)
+#define wisdom_cond_timedwait(cond, m, when)    pthread_cond_timedwait((cond), &(m)->mutex, (when))
+
+#endif
+
+/* ---------------------------------------------------------------------------
+ * Reporting
+ * ------------------------------------------------------------------------- */
+
+static inline int wisdom_lock_compare_wait(const void* a, const void* b) {
+    uint64_t x = __atomic_load_n(&(*(WisdomLockStats* const*)a)->wait_ns, __ATOMIC_RELAXED);
+    uint64_t y = __atomic_load_n(&(*(WisdomLockStats* const*)b)->wait_ns, __ATOMIC_RELAXED);
+    return (x < y) - (x > y);
+}
+
+static inline int wisdom_lock_compare_site(const void* a, const void* b) {
+    uint64_t x = ((const WisdomLockSiteStats*)a)->wait_ns;
+    uint64_t y = ((const WisdomLockSiteStats*)b)->wait_ns;
+    return (x < y) - (x > y);
+}
+
+// Zero the counters of every registered lock
+static inline void wisdom_lock_reset(void) {
+    pthread_mutex_lock(&wisdom_lock_registry_lock);
+    for (WisdomLockStats* s = wisdom_lock_registry; s; s = s->next) {
+        WisdomLockStats* next = s->next;
+        const char* name = s->name;
+        memset(s, 0, sizeof(*s));
+        s->next = next;
+        s->name = name;
+    }
+    pthread_mutex_unlock(&wisdom_lock_registry_lock);
+}
+
+/*
+ * Print the top_count locks by total wait time (0 for all) with their three
+ * worst call sites. Returns the number of locks that saw contention.
+ */
+static inline size_t wisdom_lock_report(FILE* out, size_t top_count) {
+    pthread_mutex_lock(&wisdom_lock_registry_lock);
+    size_t count = 0;
+    for (WisdomLockStats* s = wisdom_lock_registry; s; s = s->next) count++;
+
+    WisdomLockStats** order = (WisdomLockStats**)malloc((count ? count : 1) * sizeof(WisdomLockStats*));
+    if (!order) {
+        pthread_mutex_unlock(&wisdom_lock_registry_lock);
+        return 0;
+    }
+    size_t i = 0;
+    for (WisdomLockStats* s = wisdom_lock_registry; s; s = s->next) order[i++] = s;
+    qsort(order, count, sizeof(*order), wisdom_lock_compare_wait);
+
+    size_t contended = 0;
+    for (i = 0; i < count; i++) contended += __atomic_load_n(&order[i]->contentions, __ATOMIC_RELAXED) > 0;
+    if (top_count == 0 || top_count > count) top_count = count;
+
+    fprintf(out, "%-24s %12s %9s %12s %10s %10s %12s %10s\n", "lock", "acquired", "contended",
+            "wait ms", "avg us", "max us", "hold ms", "max us");
+    for (i = 0; i < top_count; i++) {
+        const WisdomLockStats* s = order[i];
+        uint64_t acquisitions = __atomic_load_n(&s->acquisitions, __ATOMIC_RELAXED);
+        uint64_t contentions = __atomic_load_n(&s->contentions, __ATOMIC_RELAXED);
+        uint64_t wait = __atomic_load_n(&s->wait_ns, __ATOMIC_RELAXED);
+        fprintf(out, "%-24s %12llu %8.1f%% %12.3f %10.3f %10.3f %12.3f %10.3f\n", s->name ? s->name : "-",
+                (unsigned long long)acquisitions,
+                acquisitions ? 100.0 * (double)contentions / (double)acquisitions : 0.0,
+                (double)wait / 1e6, contentions ? (double)wait / (double)contentions / 1e3 : 0.0,
+                (double)__atomic_load_n(&s->max_wait_ns, __ATOMIC_RELAXED) / 1e3,
+                (double)__atomic_load_n(&s->hold_ns, __ATOMIC_RELAXED) / 1e6,
+                (double)__atomic_load_n(&s->max_hold_ns, __ATOMIC_RELAXED) / 1e3);
+
+        WisdomLockSiteStats sites[WISDOM_LOCK_MAX_SITES];
+        size_t site_count = 0;
+        for (size_t k = 0; k < WISDOM_LOCK_MAX_SITES; k++) {
+            const WisdomLockSite* site = __atomic_load_n(&s->sites[k].site, __ATOMIC_ACQUIRE);
+            if (!site) continue;
+            sites[site_count].site = site;
+            sites[site_count].contentions = __atomic_load_n(&s->sites[k].contentions, __ATOMIC_RELAXED);
+            sites[site_count].wait_ns = __atomic_load_n(&s->sites[k].wait_ns, __ATOMIC_RELAXED);
+            site_count++;
+        }
+        qsort(sites, site_count, sizeof(sites[0]), wisdom_lock_compare_site);
+        for (size_t k = 0; k < site_count && k < 3; k++) {
+            fprintf(out, "    %s:%d %s: %llu contended, %.3f ms waited\n", sites[k].site->file, sites[k].site->line,
+                    sites[k].site->function, (unsigned long long)sites[k].contentions,
+                    (double)sites[k].wait_ns / 1e6);
+        }
+    }
+
+    free(order);
+    pthread_mutex_unlock(&wisdom_lock_registry_lock);
+    return contended;
+}
+
+#endif // O_WISDOM_LOCK_H
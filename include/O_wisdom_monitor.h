@@ -0,0 +1,247 @@
+#ifndef O_WISDOM_MONITOR_H
+#define O_WISDOM_MONITOR_H
+
+/*
+ * O_wisdom - online complexity monitoring for production
+ *
+ * Instrumented calls report (n, latency). Samples land in a two-level
+ * log-binned histogram: one row per power of two of n, and within a row a
+ * latency histogram with four sub-buckets per power of two of nanoseconds
+ * (about 19% resolution). Recording is a handful of relaxed atomic
+ * increments, so any number of threads can record into one monitor.
+ *
+ * Every refit_interval records, the recording thread that crosses the
+ * interval refits the complexity model (if no other thread is already doing
+ * so) from the median latency of each populated row. When the best model is
+ * of higher order than the expected one, the drift callback fires once;
+ * it re-arms after the fit returns to the expected order. Rows are halved
+ * once more than `window` samples have arrived since the last halving, so
+ * old behaviour fades out.
+ *
+ * Usage:
+ *   init_wisdom_monitor(&mon, &config);    // expected = WISDOM_MODEL_NLOGN
+ *   uint64_t start = wisdom_monitor_begin();
+ *   ... call with size n ...
+ *   wisdom_monitor_end(&mon, n, start);
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "O_wisdom_timing.h"
+
+#define WISDOM_MONITOR_ROWS         64      // Powers of two of n
+#define WISDOM_MONITOR_SUB_BUCKETS  4       // Per power of two of latency
+#define WISDOM_MONITOR_OCTAVES      40      // 1 ns .. ~18 minutes
+#define WISDOM_MONITOR_BUCKETS      (WISDOM_MONITOR_OCTAVES * WISDOM_MONITOR_SUB_BUCKETS)
+
+struct WisdomMonitor;
+
+// Called from the recording thread that ran the refit
+typedef void (*WisdomDriftCallback)(const struct WisdomMonitor* monitor, const WisdomComplexityReport* fit,
+                                    void* user_data);
+
+typedef struct {
+    const char* name;
+    WisdomModel expected;           // Highest acceptable order
+    uint64_t refit_interval;        // Records between refits
+    uint64_t window;                // Samples before old data is halved; 0 keeps everything
+    uint64_t min_row_samples;       // Rows with fewer samples are ignored by the fit
+    size_t min_rows;                // Populated rows needed before judging drift
+    WisdomDriftCallback on_drift;
+    void* user_data;
+} WisdomMonitorConfig;
+
+typedef struct {
+    uint64_t count;
+    uint64_t n_sum;
+    uint32_t buckets[WISDOM_MONITOR_BUCKETS];
+} WisdomMonitorRow;
+
+typedef struct WisdomMonitor {
+    WisdomMonitorConfig config;
+    WisdomMonitorRow rows[WISDOM_MONITOR_ROWS];
+    uint64_t records;               // Since init
+    uint64_t since_decay;
+    pthread_mutex_t refit_lock;     // Only ever try-locked by recorders
+
+    // Guarded by refit_lock
+    int drifting;
+    uint64_t refits;
+    uint64_t drift_events;
+    WisdomComplexityReport last_fit;
+    int has_fit;
+} WisdomMonitor;
+
+static inline void wisdom_monitor_defaults(WisdomMonitorConfig* config) {
+    memset(config, 0, sizeof(*config));
+    config->expected = WISDOM_MODEL_NLOGN;
+    config->refit_interval = 4096;
+    config->window = 1 << 20;
+    config->min_row_samples = 16;
+    config->min_rows = 4;
+}
+
+static inline int init_wisdom_monitor(WisdomMonitor* monitor, const WisdomMonitorConfig* config) {
+    memset(monitor, 0, sizeof(*monitor));
+    if (config) monitor->config = *config;
+    else wisdom_monitor_defaults(&monitor->config);
+    if (monitor->config.refit_interval == 0) monitor->config.refit_interval = 4096;
+    if (monitor->config.min_rows < 3) monitor->config.min_rows = 3;
+    return pthread_mutex_init(&monitor->refit_lock, NULL) == 0 ? 0 : -1;
+}
+
+static inline void cleanup_wisdom_monitor(WisdomMonitor* monitor) {
+    pthread_mutex_destroy(&monitor->refit_lock);
+    memset(monitor, 0, sizeof(*monitor));
+}
+
+static inline unsigned wisdom_monitor_log2(uint64_t value) {
+    return value ? 63u - (unsigned)__builtin_clzll(value) : 0;
+}
+
+static inline unsigned wisdom_monitor_bucket(uint64_t nanoseconds) {
+    if (nanoseconds < WISDOM_MONITOR_SUB_BUCKETS) return (unsigned)nanoseconds;
+    unsigned octave = wisdom_monitor_log2(nanoseconds);
+    if (octave >= WISDOM_MONITOR_OCTAVES) return WISDOM_MONITOR_BUCKETS - 1;
+    unsigned sub = (unsigned)(nanoseconds >> (octave - 2)) & (WISDOM_MONITOR_SUB_BUCKETS - 1);
+    return octave * WISDOM_MONITOR_SUB_BUCKETS + sub;
+}
+
+// Midpoint of a bucket in nanoseconds
+static inline double wisdom_monitor_bucket_value(unsigned bucket) {
+    unsigned octave = bucket / WISDOM_MONITOR_SUB_BUCKETS;
+    unsigned sub = bucket % WISDOM_MONITOR_SUB_BUCKETS;
+    if (octave < 2) return (double)bucket;
+    double base = ldexp(1.0, (int)octave);
+    return base * (1.0 + ((double)sub + 0.5) / WISDOM_MONITOR_SUB_BUCKETS);
+}
+
+static inline void wisdom_monitor_decay(WisdomMonitor* monitor) {
+    for (size_t r = 0; r < WISDOM_MONITOR_ROWS; r++) {
+        WisdomMonitorRow* row = &monitor->rows[r];
+        if (__atomic_load_n(&row->count, __ATOMIC_RELAXED) == 0) continue;
+
+        uint64_t removed = 0;
+        for (size_t b = 0; b < WISDOM_MONITOR_BUCKETS; b++) {
+            uint32_t half = __atomic_load_n(&row->buckets[b], __ATOMIC_RELAXED) / 2;
+            if (half) {
+                __atomic_fetch_sub(&row->buckets[b], half, __ATOMIC_RELAXED);
+                removed += half;
+            }
+        }
+        uint64_t count = __atomic_load_n(&row->count, __ATOMIC_RELAXED);
+        uint64_t n_sum = __atomic_load_n(&row->n_sum, __ATOMIC_RELAXED);
+        if (count && removed) {
+            uint64_t n_removed = (uint64_t)((double)n_sum * (double)removed / (double)count);
+            __atomic_fetch_sub(&row->n_sum, n_removed, __ATOMIC_RELAXED);
+            __atomic_fetch_sub(&row->count, removed, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/*
+ * Fit the model to the current histogram. Returns 0 when enough rows are
+ * populated, -1 otherwise. Safe to call concurrently with recording.
+ */
+static inline int wisdom_monitor_fit(const WisdomMonitor* monitor, WisdomComplexityReport* fit) {
+    double n[WISDOM_MONITOR_ROWS], latency[WISDOM_MONITOR_ROWS];
+    size_t points = 0;
+
+    for (size_t r = 0; r < WISDOM_MONITOR_ROWS; r++) {
+        const WisdomMonitorRow* row = &monitor->rows[r];
+        uint32_t counts[WISDOM_MONITOR_BUCKETS];
+        uint64_t total = 0;
+        for (size_t b = 0; b < WISDOM_MONITOR_BUCKETS; b++) {
+            counts[b] = __atomic_load_n(&row->buckets[b], __ATOMIC_RELAXED);
+            total += counts[b];
+        }
+        if (total == 0 || total < monitor->config.min_row_samples) continue;
+
+        uint64_t seen = 0;
+        size_t b = 0;
+        for (; b < WISDOM_MONITOR_BUCKETS; b++) {
+            seen += counts[b];
+            if (2 * seen >= total) break;
+        }
+
+        uint64_t count = __atomic_load_n(&row->count, __ATOMIC_RELAXED);
+        uint64_t n_sum = __atomic_load_n(&row->n_sum, __ATOMIC_RELAXED);
+        n[points] = count ? (double)n_sum / (double)count : ldexp(1.5, (int)r);
+        if (n[points] < 1.0) n[points] = 1.0;
+        latency[points] = wisdom_monitor_bucket_value((unsigned)b) * 1e-9;
+        points++;
+    }
+
+    if (points < monitor->config.min_rows || points > WISDOM_FIT_MAX_POINTS) return -1;
+    return wisdom_fit_complexity(n, latency, points, fit);
+}
+
+// Refit and fire the drift callback on a transition; caller holds refit_lock
+static inline void wisdom_monitor_refit(WisdomMonitor* monitor) {
+    if (monitor->config.window &&
+        __atomic_load_n(&monitor->since_decay, __ATOMIC_RELAXED) > monitor->config.window) {
+        wisdom_monitor_decay(monitor);
+        __atomic_store_n(&monitor->since_decay, 0, __ATOMIC_RELAXED);
+    }
+
+    WisdomComplexityReport fit;
+    if (wisdom_monitor_fit(monitor, &fit) != 0) return;
+    monitor->last_fit = fit;
+    monitor->has_fit = 1;
+    monitor->refits++;
+
+    int drifting = fit.best > monitor->config.expected;
+    if (drifting && !monitor->drifting) {
+        monitor->drift_events++;
+        if (monitor->config.on_drift) monitor->config.on_drift(monitor, &fit, monitor->config.user_data);
+    }
+    monitor->drifting = drifting;
+}
+
+static inline void wisdom_monitor_record(WisdomMonitor* monitor, size_t n, double seconds) {
+    uint64_t nanoseconds = seconds > 0 ? (uint64_t)(seconds * 1e9 + 0.5) : 0;
+    WisdomMonitorRow* row = &monitor->rows[wisdom_monitor_log2((uint64_t)n)];
+
+    __atomic_fetch_add(&row->buckets[wisdom_monitor_bucket(nanoseconds)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&row->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&row->n_sum, (uint64_t)n, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&monitor->since_decay, 1, __ATOMIC_RELAXED);
+
+    uint64_t records = __atomic_add_fetch(&monitor->records, 1, __ATOMIC_RELAXED);
+    if (records % monitor->config.refit_interval == 0 && pthread_mutex_trylock(&monitor->refit_lock) == 0) {
+        wisdom_monitor_refit(monitor);
+        pthread_mutex_unlock(&monitor->refit_lock);
+    }
+}
+
+static inline uint64_t wisdom_monitor_begin(void) {
+    return wisdom_monotonic_ns();
+}
+
+static inline void wisdom_monitor_end(WisdomMonitor* monitor, size_t n, uint64_t start) {
+    wisdom_monitor_record(monitor, n, (double)(wisdom_monotonic_ns() - start) * 1e-9);
+}
+
+static inline void wisdom_print_monitor(WisdomMonitor* monitor, FILE* out) {
+    pthread_mutex_lock(&monitor->refit_lock);
+    fprintf(out, "monitor %s: %llu records, %llu refits, %llu drift events, expected %s\n",
+            monitor->config.name ? monitor->config.name : "-",
+            (unsigned long long)__atomic_load_n(&monitor->records, __ATOMIC_RELAXED),
+            (unsigned long long)monitor->refits, (unsigned long long)monitor->drift_events,
+            wisdom_model_name(monitor->config.expected));
+    if (monitor->has_fit) {
+        fprintf(out, "current fit: %s%s\n", wisdom_model_name(monitor->last_fit.best),
+                monitor->drifting ? "  DRIFTING" : "");
+        wisdom_print_complexity(&monitor->last_fit, out);
+    }
+    pthread_mutex_unlock(&monitor->refit_lock);
+}
+
+#endif // O_WISDOM_MONITOR_H
@@ -0,0 +1,231 @@
+#ifndef O_WISDOM_PERF_H
+#define O_WISDOM_PERF_H
+
+/*
+ * O_wisdom - hardware performance counters
+ *
+ * Opens cycles, instructions, cache misses, branch misses and dTLB misses as
+ * one perf_event_open group, so all counters cover exactly the same interval,
+ * and reads them around measured runs. Counters the kernel or PMU refuses
+ * are marked unavailable and the rest keep working; when none can be opened
+ * (non-Linux, perf_event_paranoid, containers) every call still succeeds
+ * and samples simply carry no valid counters.
+ *
+ * Multiplexed counts are scaled by time_enabled / time_running.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "O_wisdom_fit.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+typedef enum {
+    WISDOM_COUNTER_CYCLES,
+    WISDOM_COUNTER_INSTRUCTIONS,
+    WISDOM_COUNTER_CACHE_MISSES,
+    WISDOM_COUNTER_BRANCH_MISSES,
+    WISDOM_COUNTER_TLB_MISSES,
+    WISDOM_COUNTER_COUNT
+} WisdomCounter;
+
+typedef struct {
+    int fds[WISDOM_COUNTER_COUNT];      // -1 when unavailable
+    int slot[WISDOM_COUNTER_COUNT];     // Position in the group read buffer
+    int leader;                         // fd of the group leader, -1 if none
+    int open_count;
+} WisdomPerfGroup;
+
+typedef struct {
+    uint64_t values[WISDOM_COUNTER_COUNT];
+    int valid[WISDOM_COUNTER_COUNT];
+    double seconds;
+    double multiplex_scale;             // 1.0 when counters were never multiplexed
+    size_t runs;                        // Runs the values are averaged over
+} WisdomPerfSample;
+
+static inline const char* wisdom_counter_name(WisdomCounter counter) {
+    static const char* names[WISDOM_COUNTER_COUNT] = {
+        "cycles", "instructions", "cache-misses", "branch-misses", "dTLB-misses"
+    };
+    return (unsigned)counter < WISDOM_COUNTER_COUNT ? names[counter] : "?";
+}
+
+#ifdef __linux__
+static inline int wisdom_perf_open(uint32_t type, uint64_t config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group_fd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+/*
+ * Open the counter group for the calling thread.
+ * Returns the number of counters available (0 means wall time only).
+ */
+static inline int init_wisdom_perf(WisdomPerfGroup* group) {
+    memset(group, 0, sizeof(*group));
+    group->leader = -1;
+    for (int i = 0; i < WISDOM_COUNTER_COUNT; i++) {
+        group->fds[i] = -1;
+        group->slot[i] = -1;
+    }
+
+#ifdef __linux__
+    static const uint32_t types[WISDOM_COUNTER_COUNT] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE
+    };
+    static const uint64_t configs[WISDOM_COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+    };
+
+    // Cycles lead the group; if the PMU refuses it, try the others as leader
+    for (int i = 0; i < WISDOM_COUNTER_COUNT; i++) {
+        int fd = wisdom_perf_open(types[i], configs[i], group->leader);
+        if (fd < 0) continue;
+        if (group->leader == -1) group->leader = fd;
+        group->fds[i] = fd;
+        group->slot[i] = group->open_count++;
+    }
+#endif
+
+    return group->open_count;
+}
+
+static inline void cleanup_wisdom_perf(WisdomPerfGroup* group) {
+#ifdef __linux__
+    for (int i = 0; i < WISDOM_COUNTER_COUNT; i++) {
+        if (group->fds[i] >= 0) close(group->fds[i]);
+    }
+#endif
+    memset(group, 0, sizeof(*group));
+    group->leader = -1;
+}
+
+static inline void wisdom_perf_start(WisdomPerfGroup* group) {
+#ifdef __linux__
+    if (group->leader < 0) return;
+    ioctl(group->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+    (void)group;
+#endif
+}
+
+// Stop counting and add the interval's counts to sample
+static inline void wisdom_perf_stop(WisdomPerfGroup* group, WisdomPerfSample* sample) {
+#ifdef __linux__
+    if (group->leader < 0) return;
+    ioctl(group->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // nr, time_enabled, time_running, values[nr]
+    uint64_t buffer[3 + WISDOM_COUNTER_COUNT];
+    ssize_t expected = (ssize_t)((3 + group->open_count) * sizeof(uint64_t));
+    if (read(group->leader, buffer, sizeof(buffer)) < expected) return;
+
+    double scale = 1.0;
+    if (buffer[2] > 0 && buffer[2] < buffer[1]) scale = (double)buffer[1] / (double)buffer[2];
+    if (scale > sample->multiplex_scale) sample->multiplex_scale = scale;
+
+    for (int i = 0; i < WISDOM_COUNTER_COUNT; i++) {
+        if (group->slot[i] < 0 || buffer[2] == 0) continue;
+        sample->values[i] += (uint64_t)((double)buffer[3 + group->slot[i]] * scale);
+        sample->valid[i] = 1;
+    }
+#else
+    (void)group;
+    (void)sample;
+#endif
+}
+
+/*
+ * Run the workload `repetitions` times at size n with counters and wall time
+ * collected around each run() only. Values in sample are per-run averages.
+ * Returns 0 on success, -1 if prepare() fails (sample is left empty)
+ */
+static inline int wisdom_perf_measure(WisdomPerfGroup* group, const WisdomWorkload* workload, size_t n,
+                                      size_t repetitions, WisdomPerfSample* sample) {
+    memset(sample, 0, sizeof(*sample));
+    sample->multiplex_scale = 1.0;
+    if (repetitions == 0) repetitions = 1;
+
+    for (size_t r = 0; r < repetitions; r++) {
+        void* state = workload->prepare ? workload->prepare(n, workload->user_data) : NULL;
+        if (workload->prepare && !state) {
+            memset(sample, 0, sizeof(*sample));
+            sample->multiplex_scale = 1.0;
+            return -1;
+        }
+
+        double start = wisdom_now();
+        wisdom_perf_start(group);
+        workload->run(state, n, workload->user_data);
+        wisdom_perf_stop(group, sample);
+        sample->seconds += wisdom_now() - start;
+
+        if (workload->release) workload->release(state, workload->user_data);
+    }
+
+    for (int i = 0; i < WISDOM_COUNTER_COUNT; i++) sample->values[i] /= repetitions;
+    sample->seconds /= (double)repetitions;
+    sample->runs = repetitions;
+    return 0;
+}
+
+// Instructions per cycle, or NAN when either counter is unavailable
+static inline double wisdom_perf_ipc(const WisdomPerfSample* sample) {
+    if (!sample->valid[WISDOM_COUNTER_CYCLES] || !sample->valid[WISDOM_COUNTER_INSTRUCTIONS] ||
+        sample->values[WISDOM_COUNTER_CYCLES] == 0) {
+        return NAN;
+    }
+    return (double)sample->values[WISDOM_COUNTER_INSTRUCTIONS] / (double)sample->values[WISDOM_COUNTER_CYCLES];
+}
+
+// Counter value per processed element, or NAN when unavailable
+static inline double wisdom_perf_per_element(const WisdomPerfSample* sample, WisdomCounter counter, size_t n) {
+    if ((unsigned)counter >= WISDOM_COUNTER_COUNT || !sample->valid[counter] || n == 0) return NAN;
+    return (double)sample->values[counter] / (double)n;
+}
+
+static inline void wisdom_perf_print(const WisdomPerfSample* sample, size_t n, FILE* out) {
+    fprintf(out, "n=%zu  time=%.6gs", n, sample->seconds);
+
+    double ipc = wisdom_perf_ipc(sample);
+    if (!isnan(ipc)) fprintf(out, "  IPC=%.3f", ipc);
+    fputc('\n', out);
+
+    int any = 0;
+    for (int i = 0; i < WISDOM_COUNTER_COUNT; i++) {
+        if (!sample->valid[i]) continue;
+        fprintf(out, "  %-14s %16llu  %10.4f/elem\n", wisdom_counter_name((WisdomCounter)i),
+                (unsigned long long)sample->values[i], wisdom_perf_per_element(sample, (WisdomCounter)i, n));
+        any = 1;
+    }
+    if (!any) fprintf(out, "  (hardware counters unavailable)\n");
+    if (sample->multiplex_scale > 1.0) {
+        fprintf(out, "  (counters multiplexed, scaled by up to %.2fx)\n", sample->multiplex_scale);
+    }
+}
+
+#endif // O_WISDOM_PERF_H
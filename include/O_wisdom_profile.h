@@ -0,0 +1,592 @@
+#ifndef O_WISDOM_PROFILE_H
+#define O_WISDOM_PROFILE_H
+
+/*
+ * O_wisdom - in-process statistical profiler
+ *
+ * Each participating thread arms a timer on its own CPU clock
+ * (timer_create with CLOCK_THREAD_CPUTIME_ID and SIGEV_THREAD_ID) that
+ * delivers SIGPROF to that thread. The handler walks the interrupted stack
+ * into a bounded ring of sample slots; slots are claimed with a ticket CAS
+ * (Vyukov's bounded queue), so recording is lock-free and async-signal-safe.
+ *
+ * A drain thread empties the ring every WISDOM_PROFILE_DRAIN_MS and folds
+ * each sample into a table of unique stacks with a count, so memory grows
+ * with the number of distinct stacks rather than with running time and the
+ * profiler can stay on inside a long-running process. Samples are dropped
+ * (and counted) only if the ring fills between two drains.
+ *
+ * Stacks are walked through frame pointers on x86-64 and AArch64 (build with
+ * -fno-omit-frame-pointer), bounded by the thread's stack so a frame without
+ * one ends the walk instead of faulting. Other targets use backtrace().
+ *
+ * Usage:
+ *   wisdom_profile_start(99, 0);           // Hz, default ring size
+ *   wisdom_profile_thread_start();         // In every thread to sample
+ *   ...
+ *   wisdom_profile_save_folded("app.folded");  // Any time, also while running
+ *   wisdom_profile_clear();                // Optional: start a new window
+ *   ...
+ *   wisdom_profile_thread_stop();          // Before each such thread exits
+ *   wisdom_profile_stop();
+ *   cleanup_wisdom_profile();
+ *
+ * The folded output ("root;caller;leaf count" per line) feeds
+ * flamegraph.pl, speedscope and inferno. Symbols come from dladdr, so link
+ * executables with -rdynamic to name their own functions; unresolved frames
+ * print as module+offset.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#define WISDOM_PROFILE_MAX_DEPTH        64
+#define WISDOM_PROFILE_MAX_THREADS      256
+#define WISDOM_PROFILE_DEFAULT_SAMPLES  (1u << 12)     // Ring slots
+#define WISDOM_PROFILE_DRAIN_MS         100
+
+typedef struct {
+    uint64_t sequence;      // Ticket: slot index when free, index + 1 once written
+    uint32_t depth;
+    uintptr_t pcs[WISDOM_PROFILE_MAX_DEPTH];   // Leaf first
+} WisdomProfileSample;
+
+typedef struct {
+    long tid;
+    uintptr_t stack_low;
+    uintptr_t stack_high;
+} WisdomProfileThread;
+
+// One unique folded stack; its frames live in the state's frame arena
+typedef struct {
+    uint64_t hash;
+    uint64_t count;         // 0 for an empty table slot
+    size_t offset;
+    uint32_t depth;
+} WisdomProfileStack;
+
+typedef struct {
+    int enabled;
+    long interval_ns;
+
+    // Ring written by the signal handler
+    WisdomProfileSample* ring;
+    uint64_t capacity;      // Power of two
+    uint64_t head;          // Next ticket for producers
+    uint64_t tail;          // Next slot to drain; drain lock only
+    uint64_t dropped;
+
+    // Aggregated profile; drain lock only
+    WisdomProfileStack* stacks;
+    size_t stack_capacity;  // Power of two, 0 before the first sample
+    size_t stack_count;
+    uintptr_t* frames;
+    size_t frame_count;
+    size_t frame_capacity;
+    uint64_t total;         // Samples folded into the table
+
+    pthread_t drainer;
+    int draining;
+    int drain_stop;
+
+    uint32_t thread_count;
+    WisdomProfileThread threads[WISDOM_PROFILE_MAX_THREADS];
+    struct sigaction previous;
+    int installed;
+} WisdomProfileState;
+
+// Process-wide: one weak definition shared by every translation unit
+__attribute__((weak)) WisdomProfileState wisdom_profile_state;
+__attribute__((weak)) __thread timer_t wisdom_profile_timer;
+__attribute__((weak)) __thread int wisdom_profile_armed;
+__attribute__((weak)) pthread_mutex_t wisdom_profile_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+__attribute__((weak)) pthread_cond_t wisdom_profile_drain_wake = PTHREAD_COND_INITIALIZER;
+
+static inline const WisdomProfileThread* wisdom_profile_find_thread(long tid, uint32_t* index) {
+    uint32_t count = __atomic_load_n(&wisdom_profile_state.thread_count, __ATOMIC_ACQUIRE);
+    if (count > WISDOM_PROFILE_MAX_THREADS) count = WISDOM_PROFILE_MAX_THREADS;
+    for (uint32_t i = 0; i < count; i++) {
+        if (__atomic_load_n(&wisdom_profile_state.threads[i].tid, __ATOMIC_ACQUIRE) == tid) {
+            *index = i;
+            return &wisdom_profile_state.threads[i];
+        }
+    }
+    return NULL;
+}
+
+static inline uint32_t wisdom_profile_walk(void* context, const WisdomProfileThread* thread, uintptr_t* pcs) {
+    uint32_t depth = 0;
+#if (defined(__x86_64__) || defined(__aarch64__)) && defined(__linux__)
+    ucontext_t* uc = (ucontext_t*)context;
+#if defined(__x86_64__)
+    uintptr_t pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+    uintptr_t fp = (uintptr_t)uc->uc_mcontext.gregs[REG_RBP];
+#else
+    uintptr_t pc = (uintptr_t)uc->uc_mcontext.pc;
+    uintptr_t fp = (uintptr_t)uc->uc_mcontext.regs[29];
+#endif
+    pcs[depth++] = pc;
+
+    // Each frame holds [previous fp, return address]; frames grow towards higher addresses
+    while (depth < WISDOM_PROFILE_MAX_DEPTH && thread &&
+           fp >= thread->stack_low && fp + 2 * sizeof(uintptr_t) <= thread->stack_high &&
+           (fp & (sizeof(uintptr_t) - 1)) == 0) {
+        const uintptr_t* frame = (const uintptr_t*)fp;
+        uintptr_t next = frame[0];
+        uintptr_t ret = frame[1];
+        if (ret == 0) break;
+        pcs[depth++] = ret - 1;     // Point inside the call instruction
+        if (next <= fp) break;
+        fp = next;
+    }
+#else
+    (void)context;
+    (void)thread;
+    void* frames[WISDOM_PROFILE_MAX_DEPTH];
+    int count = backtrace(frames, WISDOM_PROFILE_MAX_DEPTH);
+    // Skip this function and the signal handler
+    for (int i = 2; i < count; i++) pcs[depth++] = (uintptr_t)frames[i];
+#endif
+    return depth;
+}
+
+static inline void wisdom_profile_handler(int signo, siginfo_t* info, void* context) {
+    (void)signo;
+    (void)info;
+    if (!__atomic_load_n(&wisdom_profile_state.enabled, __ATOMIC_ACQUIRE)) return;
+
+    int saved_errno = errno;
+    uint32_t thread_index = 0;
+    const WisdomProfileThread* thread = wisdom_profile_find_thread((long)syscall(SYS_gettid), &thread_index);
+
+    // Claim the slot at head once the drain has released it
+    uint64_t mask = wisdom_profile_state.capacity - 1;
+    uint64_t position = __atomic_load_n(&wisdom_profile_state.head, __ATOMIC_RELAXED);
+    WisdomProfileSample* sample;
+    for (;;) {
+        sample = &wisdom_profile_state.ring[position & mask];
+        uint64_t sequence = __atomic_load_n(&sample->sequence, __ATOMIC_ACQUIRE);
+        int64_t lag = (int64_t)(sequence - position);
+        if (lag == 0) {
+            if (__atomic_compare_exchange_n(&wisdom_profile_state.head, &position, position + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (lag < 0) {
+            __atomic_fetch_add(&wisdom_profile_state.dropped, 1, __ATOMIC_RELAXED);
+            errno = saved_errno;
+            return;
+        } else {
+            position = __atomic_load_n(&wisdom_profile_state.head, __ATOMIC_RELAXED);
+        }
+    }
+
+    uint32_t depth = wisdom_profile_walk(context, thread, sample->pcs);
+    sample->depth = depth ? depth : 1;
+    __atomic_store_n(&sample->sequence, position + 1, __ATOMIC_RELEASE);
+    errno = saved_errno;
+}
+
+/* ---------------------------------------------------------------------------
+ * Drain: fold ring samples into the stack table
+ * ------------------------------------------------------------------------- */
+
+static inline int wisdom_profile_table_grow(void) {
+    WisdomProfileState* state = &wisdom_profile_state;
+    size_t capacity = state->stack_capacity ? state->stack_capacity * 2 : 256;
+    WisdomProfileStack* stacks = (WisdomProfileStack*)calloc(capacity, sizeof(WisdomProfileStack));
+    if (!stacks) return -1;
+
+    for (size_t i = 0; i < state->stack_capacity; i++) {
+        const WisdomProfileStack* stack = &state->stacks[i];
+        if (stack->count == 0) continue;
+        size_t slot = (size_t)stack->hash & (capacity - 1);
+        while (stacks[slot].count != 0) slot = (slot + 1) & (capacity - 1);
+        stacks[slot] = *stack;
+    }
+    free(state->stacks);
+    state->stacks = stacks;
+    state->stack_capacity = capacity;
+    return 0;
+}
+
+// Add one sample to the table. Returns 0 on success, -1 on allocation failure
+static inline int wisdom_profile_fold(const uintptr_t* raw, uint32_t depth) {
+    WisdomProfileState* state = &wisdom_profile_state;
+
+    // Fold every pc onto its function's start so samples at different
+    // offsets within the same functions merge into one line
+    uintptr_t pcs[WISDOM_PROFILE_MAX_DEPTH];
+    uint64_t hash = 1469598103934665603ULL;
+    for (uint32_t d = 0; d < depth; d++) {
+        Dl_info info;
+        pcs[d] = dladdr((void*)raw[d], &info) && info.dli_sname && info.dli_saddr ? (uintptr_t)info.dli_saddr
+                                                                                   : raw[d];
+        hash = (hash ^ (uint64_t)pcs[d]) * 1099511628211ULL;
+    }
+
+    if ((state->stack_count + 1) * 2 > state->stack_capacity && wisdom_profile_table_grow() != 0) return -1;
+
+    size_t mask = state->stack_capacity - 1;
+    size_t slot = (size_t)hash & mask;
+    for (; state->stacks[slot].count != 0; slot = (slot + 1) & mask) {
+        WisdomProfileStack* stack = &state->stacks[slot];
+        if (stack->hash == hash && stack->depth == depth &&
+            memcmp(state->frames + stack->offset, pcs, depth * sizeof(uintptr_t)) == 0) {
+            stack->count++;
+            state->total++;
+            return 0;
+        }
+    }
+
+    if (state->frame_count + depth > state->frame_capacity) {
+        size_t capacity = state->frame_capacity ? state->frame_capacity : 4096;
+        while (capacity < state->frame_count + depth) capacity *= 2;
+        uintptr_t* frames = (uintptr_t*)realloc(state->frames, capacity * sizeof(uintptr_t));
+        if (!frames) return -1;
+        state->frames = frames;
+        state->frame_capacity = capacity;
+    }
+    memcpy(state->frames + state->frame_count, pcs, depth * sizeof(uintptr_t));
+
+    WisdomProfileStack* stack = &state->stacks[slot];
+    stack->hash = hash;
+    stack->count = 1;
+    stack->offset = state->frame_count;
+    stack->depth = depth;
+    state->frame_count += depth;
+    state->stack_count++;
+    state->total++;
+    return 0;
+}
+
+// Empty the ring into the table; caller holds wisdom_profile_drain_lock
+static inline void wisdom_profile_drain_locked(void) {
+    WisdomProfileState* state = &wisdom_profile_state;
+    if (!state->ring) return;
+
+    uint64_t mask = state->capacity - 1;
+    for (;;) {
+        uint64_t position = state->tail;
+        WisdomProfileSample* sample = &state->ring[position & mask];
+        // Stop at an empty slot, or one a handler is still writing
+        if (__atomic_load_n(&sample->sequence, __ATOMIC_ACQUIRE) != position + 1) break;
+
+        if (wisdom_profile_fold(sample->pcs, sample->depth) != 0) {
+            __atomic_fetch_add(&state->dropped, 1, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&sample->sequence, position + state->capacity, __ATOMIC_RELEASE);
+        state->tail = position + 1;
+    }
+}
+
+// Fold everything recorded so far into the table
+static inline void wisdom_profile_drain(void) {
+    pthread_mutex_lock(&wisdom_profile_drain_lock);
+    wisdom_profile_drain_locked();
+    pthread_mutex_unlock(&wisdom_profile_drain_lock);
+}
+
+static inline void* wisdom_profile_drainer(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&wisdom_profile_drain_lock);
+    while (!wisdom_profile_state.drain_stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)WISDOM_PROFILE_DRAIN_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&wisdom_profile_drain_wake, &wisdom_profile_drain_lock, &deadline);
+        wisdom_profile_drain_locked();
+    }
+    pthread_mutex_unlock(&wisdom_profile_drain_lock);
+    return NULL;
+}
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+__attribute__((weak)) pthread_mutex_t wisdom_profile_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Register the calling thread and arm its CPU-time timer. Call after
+ * wisdom_profile_start, once per thread. Returns 0 on success, -1 on failure.
+ */
+static inline int wisdom_profile_thread_start(void) {
+    if (!wisdom_profile_state.installed || wisdom_profile_armed) return -1;
+
+    pthread_attr_t attr;
+    void* stack = NULL;
+    size_t stack_size = 0;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        pthread_attr_getstack(&attr, &stack, &stack_size);
+        pthread_attr_destroy(&attr);
+    }
+    long tid = (long)syscall(SYS_gettid);
+
+    // Reuse a slot freed by an exited thread, else append; publish tid last
+    pthread_mutex_lock(&wisdom_profile_lock);
+    uint32_t count = wisdom_profile_state.thread_count;
+    uint32_t slot = count;
+    for (uint32_t i = 0; i < count; i++) {
+        if (wisdom_profile_state.threads[i].tid == 0) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot == WISDOM_PROFILE_MAX_THREADS) {
+        pthread_mutex_unlock(&wisdom_profile_lock);
+        return -1;
+    }
+    WisdomProfileThread* thread = &wisdom_profile_state.threads[slot];
+    thread->stack_low = (uintptr_t)stack;
+    thread->stack_high = (uintptr_t)stack + stack_size;
+    __atomic_store_n(&thread->tid, tid, __ATOMIC_RELEASE);
+    if (slot == count) __atomic_store_n(&wisdom_profile_state.thread_count, count + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&wisdom_profile_lock);
+
+    struct sigevent event;
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = (pid_t)tid;
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &wisdom_profile_timer) != 0) {
+        __atomic_store_n(&thread->tid, 0, __ATOMIC_RELEASE);
+        return -1;
+    }
+
+    struct itimerspec interval;
+    interval.it_interval.tv_sec = wisdom_profile_state.interval_ns / 1000000000L;
+    interval.it_interval.tv_nsec = wisdom_profile_state.interval_ns % 1000000000L;
+    interval.it_value = interval.it_interval;
+    if (timer_settime(wisdom_profile_timer, 0, &interval, NULL) != 0) {
+        timer_delete(wisdom_profile_timer);
+        __atomic_store_n(&thread->tid, 0, __ATOMIC_RELEASE);
+        return -1;
+    }
+    wisdom_profile_armed = 1;
+    return 0;
+}
+
+// Disarm the calling thread's timer; call before a profiled thread exits
+static inline void wisdom_profile_thread_stop(void) {
+    if (!wisdom_profile_armed) return;
+    timer_delete(wisdom_profile_timer);
+    wisdom_profile_armed = 0;
+
+    uint32_t index;
+    pthread_mutex_lock(&wisdom_profile_lock);
+    WisdomProfileThread* thread =
+        (WisdomProfileThread*)wisdom_profile_find_thread((long)syscall(SYS_gettid), &index);
+    if (thread) __atomic_store_n(&thread->tid, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&wisdom_profile_lock);
+}
+
+static inline void cleanup_wisdom_profile(void);
+
+/*
+ * Install the SIGPROF handler, allocate a ring of capacity sample slots (0
+ * for the default; rounded up to a power of two), start the drain thread
+ * and register the calling thread. hz is the sampling frequency in CPU time
+ * per thread (0 for 99). Returns 0 on success, -1 on failure.
+ */
+static inline int wisdom_profile_start(unsigned hz, size_t capacity) {
+    WisdomProfileState* state = &wisdom_profile_state;
+    if (state->installed) return -1;
+    if (hz == 0) hz = 99;
+    if (capacity == 0) capacity = WISDOM_PROFILE_DEFAULT_SAMPLES;
+
+    size_t slots = 2;
+    while (slots < capacity) slots *= 2;
+    state->ring = (WisdomProfileSample*)calloc(slots, sizeof(WisdomProfileSample));
+    if (!state->ring) return -1;
+    for (size_t i = 0; i < slots; i++) state->ring[i].sequence = i;
+    state->capacity = slots;
+    state->head = state->tail = 0;
+    state->dropped = 0;
+    state->thread_count = 0;
+    state->interval_ns = 1000000000L / (long)hz;
+
+    // backtrace() may allocate on first use; do that here rather than in the handler
+    void* prime[1];
+    backtrace(prime, 1);
+
+    state->drain_stop = 0;
+    if (pthread_create(&state->drainer, NULL, wisdom_profile_drainer, NULL) != 0) {
+        free(state->ring);
+        state->ring = NULL;
+        return -1;
+    }
+    state->draining = 1;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = wisdom_profile_handler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    int failed = sigaction(SIGPROF, &action, &state->previous) != 0;
+    if (!failed) {
+        state->installed = 1;
+        __atomic_store_n(&state->enabled, 1, __ATOMIC_RELEASE);
+        failed = wisdom_profile_thread_start() != 0;
+    }
+    if (failed) {
+        cleanup_wisdom_profile();
+        return -1;
+    }
+    return 0;
+}
+
+// Stop recording and fold what is left in the ring; timers still armed in other threads fire harmlessly
+static inline void wisdom_profile_stop(void) {
+    WisdomProfileState* state = &wisdom_profile_state;
+    __atomic_store_n(&state->enabled, 0, __ATOMIC_RELEASE);
+    wisdom_profile_thread_stop();
+
+    if (state->draining) {
+        pthread_mutex_lock(&wisdom_profile_drain_lock);
+        state->drain_stop = 1;
+        pthread_cond_signal(&wisdom_profile_drain_wake);
+        pthread_mutex_unlock(&wisdom_profile_drain_lock);
+        pthread_join(state->drainer, NULL);
+        state->draining = 0;
+    }
+    wisdom_profile_drain();
+}
+
+// Samples folded into the profile so far (drains the ring first)
+static inline size_t wisdom_profile_sample_count(void) {
+    pthread_mutex_lock(&wisdom_profile_drain_lock);
+    wisdom_profile_drain_locked();
+    size_t total = (size_t)wisdom_profile_state.total;
+    pthread_mutex_unlock(&wisdom_profile_drain_lock);
+    return total;
+}
+
+static inline size_t wisdom_profile_dropped(void) {
+    return (size_t)__atomic_load_n(&wisdom_profile_state.dropped, __ATOMIC_RELAXED);
+}
+
+// Discard the aggregated profile, e.g. to start a new window; recording continues
+static inline void wisdom_profile_clear(void) {
+    WisdomProfileState* state = &wisdom_profile_state;
+    pthread_mutex_lock(&wisdom_profile_drain_lock);
+    wisdom_profile_drain_locked();
+    free(state->stacks);
+    free(state->frames);
+    state->stacks = NULL;
+    state->frames = NULL;
+    state->stack_capacity = state->stack_count = 0;
+    state->frame_count = state->frame_capacity = 0;
+    state->total = 0;
+    pthread_mutex_unlock(&wisdom_profile_drain_lock);
+}
+
+/* ---------------------------------------------------------------------------
+ * Folded-stack output
+ * ------------------------------------------------------------------------- */
+
+static inline int wisdom_profile_compare_stack(const void* a, const void* b) {
+    const WisdomProfileStack* x = *(const WisdomProfileStack* const*)a;
+    const WisdomProfileStack* y = *(const WisdomProfileStack* const*)b;
+    const uintptr_t* xs = wisdom_profile_state.frames + x->offset;
+    const uintptr_t* ys = wisdom_profile_state.frames + y->offset;
+    // Compare root first so stacks sharing callers sort together
+    uint32_t i = x->depth, j = y->depth;
+    while (i > 0 && j > 0) {
+        i--;
+        j--;
+        if (xs[i] != ys[j]) return xs[i] < ys[j] ? -1 : 1;
+    }
+    return i == j ? 0 : (i < j ? -1 : 1);
+}
+
+static inline void wisdom_profile_write_frame(uintptr_t pc, FILE* out) {
+    Dl_info info;
+    if (dladdr((void*)pc, &info) && info.dli_sname) {
+        fputs(info.dli_sname, out);
+        return;
+    }
+    if (dladdr((void*)pc, &info) && info.dli_fname) {
+        const char* module = strrchr(info.dli_fname, '/');
+        module = module ? module + 1 : info.dli_fname;
+        // Folded format separates frames with ';' and the count with a space
+        for (const char* p = module; *p; p++) fputc(*p == ';' || *p == ' ' ? '_' : *p, out);
+        fprintf(out, "+0x%lx", (unsigned long)(pc - (uintptr_t)info.dli_fbase));
+        return;
+    }
+    fprintf(out, "0x%lx", (unsigned long)pc);
+}
+
+/*
+ * Write the profile as folded stacks, one unique stack per line. Safe while
+ * profiling is running: the ring is drained first and the table is only
+ * read. Returns the number of lines written or -1 on failure.
+ */
+static inline long wisdom_profile_write_folded(FILE* out) {
+    WisdomProfileState* state = &wisdom_profile_state;
+    pthread_mutex_lock(&wisdom_profile_drain_lock);
+    wisdom_profile_drain_locked();
+
+    const WisdomProfileStack** order =
+        (const WisdomProfileStack**)malloc((state->stack_count ? state->stack_count : 1) * sizeof(*order));
+    if (!order) {
+        pthread_mutex_unlock(&wisdom_profile_drain_lock);
+        return -1;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < state->stack_capacity; i++) {
+        if (state->stacks[i].count != 0) order[count++] = &state->stacks[i];
+    }
+    qsort(order, count, sizeof(*order), wisdom_profile_compare_stack);
+
+    for (size_t i = 0; i < count; i++) {
+        const uintptr_t* pcs = state->frames + order[i]->offset;
+        for (uint32_t d = order[i]->depth; d > 0; d--) {
+            wisdom_profile_write_frame(pcs[d - 1], out);
+            if (d > 1) fputc(';', out);
+        }
+        fprintf(out, " %llu\n", (unsigned long long)order[i]->count);
+    }
+    free(order);
+    pthread_mutex_unlock(&wisdom_profile_drain_lock);
+    return ferror(out) ? -1 : (long)count;
+}
+
+static inline long wisdom_profile_save_folded(const char* path) {
+    FILE* out = fopen(path, "w");
+    if (!out) return -1;
+    long lines = wisdom_profile_write_folded(out);
+    if (fclose(out) != 0) lines = -1;
+    return lines;
+}
+
+// Restore the previous SIGPROF disposition and free the profile; all threads must have stopped
+static inline void cleanup_wisdom_profile(void) {
+    WisdomProfileState* state = &wisdom_profile_state;
+    wisdom_profile_stop();
+    if (state->installed) sigaction(SIGPROF, &state->previous, NULL);
+    free(state->ring);
+    free(state->stacks);
+    free(state->frames);
+    memset(state, 0, sizeof(*state));
+}
+
+#endif // O_WISDOM_PROFILE_H
@@ -0,0 +1,389 @@
+#ifndef O_WISDOM_ROOFLINE_H
+#define O_WISDOM_ROOFLINE_H
+
+/*
+ * O_wisdom - roofline model
+ *
+ * Two microkernels measure the ceilings of one core as built:
+ *   - Peak FLOP rate: eight independent multiply-add chains on GCC vector
+ *     types, enough to cover FMA latency, with no memory traffic. When the
+ *     target has fast FMA (__FP_FAST_FMA) the chains call fma() explicitly,
+ *     because the strict ISO modes the repo builds with (-std=c99) turn off
+ *     floating-point contraction and a * b + c would never fuse.
+ *   - Memory bandwidth: a STREAM-style triad a[i] = b[i] + s * c[i] over
+ *     arrays several times the size of the last-level cache.
+ * The vector type is sized to the target ISA: 32 bytes with AVX, else 16.
+ * AVX-512 targets stay at 32 bytes because GCC prefers 256-bit vectors
+ * there and splits wider generic vectors through the stack. Build with
+ * -march=native to see the machine's real peak.
+ *
+ * User kernels declare the flops and bytes one run at size n performs; they
+ * are timed with the robust timer and placed on the roofline by arithmetic
+ * intensity (flops per byte). Kernels left of the ridge point are memory
+ * bound, kernels right of it compute bound. The chart is written as JSON
+ * data and as a standalone SVG.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "O_wisdom_timing.h"
+#include "O_wisdom_cache.h"
+
+#define WISDOM_ROOFLINE_MAX_KERNELS 32
+#define WISDOM_ROOFLINE_CHAINS      8
+#define WISDOM_ROOFLINE_MAX_ARRAY   ((size_t)256 << 20)   // Per triad array
+
+#if defined(__AVX__)
+#define WISDOM_ROOFLINE_VECTOR_BYTES 32
+#else
+#define WISDOM_ROOFLINE_VECTOR_BYTES 16     // SSE2, NEON, or two scalars
+#endif
+#define WISDOM_ROOFLINE_LANES ((int)(WISDOM_ROOFLINE_VECTOR_BYTES / sizeof(double)))
+
+typedef double WisdomRooflineVector __attribute__((vector_size(WISDOM_ROOFLINE_VECTOR_BYTES)));
+
+// One multiply-add step of a chain; fused explicitly where FMA is fast
+#ifdef __FP_FAST_FMA
+#define WISDOM_ROOFLINE_MADD(a, mul, add)                                       \
+    do {                                                                        \
+        for (int lane_ = 0; lane_ < WISDOM_ROOFLINE_LANES; lane_++) {           \
+            (a)[lane_] = fma((a)[lane_], (mul)[lane_], (add)[lane_]);           \
+        }                                                                       \
+    } while (0)
+#else
+#define WISDOM_ROOFLINE_MADD(a, mul, add) ((a) = (a) * (mul) + (add))
+#endif
+
+typedef struct {
+    const char* name;
+    WisdomWorkload workload;
+    size_t n;
+    double flops;           // Per run at size n
+    double bytes;           // Per run at size n, to and from memory
+} WisdomRooflineKernel;
+
+typedef struct {
+    const char* name;
+    double intensity;       // Flops per byte
+    double flops_per_second;
+    double roof;            // Attainable at this intensity
+    double efficiency;      // Achieved / roof
+    int memory_bound;
+} WisdomRooflinePoint;
+
+typedef struct {
+    double peak_flops;      // Flops per second
+    double bandwidth;       // Bytes per second
+    double ridge;           // Intensity where the roofs meet
+    size_t point_count;
+    WisdomRooflinePoint points[WISDOM_ROOFLINE_MAX_KERNELS];
+} WisdomRoofline;
+
+static volatile double wisdom_roofline_sink;
+
+/* ---------------------------------------------------------------------------
+ * Ceiling microkernels
+ * ------------------------------------------------------------------------- */
+
+static inline void wisdom_roofline_flops_run(void* state, size_t n, void* user_data) {
+    (void)state;
+    (void)user_data;
+    WisdomRooflineVector mul, add, a0;
+    for (int lane = 0; lane < WISDOM_ROOFLINE_LANES; lane++) {
+        mul[lane] = 0.999999 - 1e-6 * lane;
+        add[lane] = 1e-9 * (lane + 1);
+        a0[lane] = lane + 1;
+    }
+    WisdomRooflineVector a1 = a0 + 1, a2 = a0 + 2, a3 = a0 + 3;
+    WisdomRooflineVector a4 = a0 + 4, a5 = a0 + 5, a6 = a0 + 6, a7 = a0 + 7;
+
+    // Named accumulators stay in registers; an array is spilled on every pass
+    for (size_t i = 0; i < n; i++) {
+        WISDOM_ROOFLINE_MADD(a0, mul, add);
+        WISDOM_ROOFLINE_MADD(a1, mul, add);
+        WISDOM_ROOFLINE_MADD(a2, mul, add);
+        WISDOM_ROOFLINE_MADD(a3, mul, add);
+        WISDOM_ROOFLINE_MADD(a4, mul, add);
+        WISDOM_ROOFLINE_MADD(a5, mul, add);
+        WISDOM_ROOFLINE_MADD(a6, mul, add);
+        WISDOM_ROOFLINE_MADD(a7, mul, add);
+    }
+
+    WisdomRooflineVector sum = a0 + a1 + a2 + a3 + a4 + a5 + a6 + a7;
+    double total = 0;
+    for (int lane = 0; lane < WISDOM_ROOFLINE_LANES; lane++) total += sum[lane];
+    wisdom_roofline_sink = total;
+}
+
+// Two flops (multiply, add) per lane per chain per iteration
+static inline double wisdom_roofline_flops_per_iteration(void) {
+    return 2.0 * WISDOM_ROOFLINE_LANES * WISDOM_ROOFLINE_CHAINS;
+}
+
+typedef struct {
+    double* a;
+    double* b;
+    double* c;
+} WisdomTriad;
+
+static inline void* wisdom_triad_prepare(size_t n, void* user_data) {
+    (void)user_data;
+    WisdomTriad* triad = (WisdomTriad*)calloc(1, sizeof(WisdomTriad));
+    if (!triad) return NULL;
+    if (posix_memalign((void**)&triad->a, 64, n * sizeof(double)) != 0) triad->a = NULL;
+    if (posix_memalign((void**)&triad->b, 64, n * sizeof(double)) != 0) triad->b = NULL;
+    if (posix_memalign((void**)&triad->c, 64, n * sizeof(double)) != 0) triad->c = NULL;
+    if (triad->a && triad->b && triad->c) {
+        for (size_t i = 0; i < n; i++) {
+            triad->a[i] = 0.0;
+            triad->b[i] = 1.0;
+            triad->c[i] = 2.0;
+        }
+    }
+    return triad;
+}
+
+static inline void wisdom_triad_run(void* state, size_t n, void* user_data) {
+    (void)user_data;
+    WisdomTriad* triad = (WisdomTriad*)state;
+    if (!triad || !triad->a || !triad->b || !triad->c) return;
+    double* restrict a = triad->a;
+    const double* restrict b = triad->b;
+    const double* restrict c = triad->c;
+    for (size_t i = 0; i < n; i++) a[i] = b[i] + 3.0 * c[i];
+    wisdom_roofline_sink = a[n / 2];
+}
+
+static inline void wisdom_triad_release(void* state, void* user_data) {
+    (void)user_data;
+    WisdomTriad* triad = (WisdomTriad*)state;
+    if (!triad) return;
+    free(triad->a);
+    free(triad->b);
+    free(triad->c);
+    free(triad);
+}
+
+/*
+ * Measure both ceilings. timing may be NULL for defaults. Returns 0 on
+ * success, -1 if the triad arrays could not be allocated.
+ */
+static inline int init_wisdom_roofline(WisdomRoofline* roofline, const WisdomTimingConfig* timing) {
+    memset(roofline, 0, sizeof(*roofline));
+
+    WisdomWorkload flops = { NULL, wisdom_roofline_flops_run, NULL, NULL };
+    WisdomTimingResult result;
+    size_t iterations = 1 << 16;
+    wisdom_time_robust(timing, &flops, iterations, &result);
+    roofline->peak_flops = result.median > 0 ?
+        wisdom_roofline_flops_per_iteration() * (double)iterations / result.median : 0;
+
+    // Each array four times the largest cache, so the triad streams from DRAM
+    WisdomCacheInfo caches;
+    wisdom_detect_caches(&caches);
+    size_t largest = 8u << 20;
+    for (int i = 0; i < WISDOM_CACHE_LEVELS; i++) {
+        if (caches.size[i] > largest) largest = caches.size[i];
+    }
+    size_t bytes = 4 * largest;
+    if (bytes > WISDOM_ROOFLINE_MAX_ARRAY) bytes = WISDOM_ROOFLINE_MAX_ARRAY;
+    size_t n = bytes / sizeof(double);
+
+    WisdomWorkload triad = { wisdom_triad_prepare, wisdom_triad_run, wisdom_triad_release, NULL };
+    WisdomTriad* probe = (WisdomTriad*)wisdom_triad_prepare(n, NULL);
+    int ok = probe && probe->a && probe->b && probe->c;
+    wisdom_triad_release(probe, NULL);
+    if (!ok) return -1;
+
+    wisdom_time_robust(timing, &triad, n, &result);
+    // Two streams in, one out; write-allocate traffic is not counted, as in STREAM
+    roofline->bandwidth = result.median > 0 ? 3.0 * sizeof(double) * (double)n / result.median : 0;
+    roofline->ridge = roofline->bandwidth > 0 ? roofline->peak_flops / roofline->bandwidth : 0;
+    return 0;
+}
+
+static inline double wisdom_roofline_roof(const WisdomRoofline* roofline, double intensity) {
+    double memory = intensity * roofline->bandwidth;
+    return memory < roofline->peak_flops ? memory : roofline->peak_flops;
+}
+
+/*
+ * Time a kernel and place it on the roofline. Returns the point index, or -1
+ * on invalid input or a full chart.
+ */
+static inline int wisdom_roofline_add(WisdomRoofline* roofline, const WisdomRooflineKernel* kernel,
+                                      const WisdomTimingConfig* timing) {
+    if (roofline->point_count >= WISDOM_ROOFLINE_MAX_KERNELS || !(kernel->flops > 0) || !(kernel->bytes > 0)) {
+        return -1;
+    }
+
+    WisdomTimingResult result;
+    if (wisdom_time_robust(timing, &kernel->workload, kernel->n, &result) != 0 || !(result.median > 0)) return -1;
+
+    WisdomRooflinePoint* point = &roofline->points[roofline->point_count];
+    point->name = kernel->name;
+    point->intensity = kernel->flops / kernel->bytes;
+    point->flops_per_second = kernel->flops / result.median;
+    point->roof = wisdom_roofline_roof(roofline, point->intensity);
+    point->efficiency = point->roof > 0 ? point->flops_per_second / point->roof : 0;
+    point->memory_bound = point->intensity < roofline->ridge;
+    return (int)roofline->point_count++;
+}
+
+/* ---------------------------------------------------------------------------
+ * Output
+ * ------------------------------------------------------------------------- */
+
+static inline void wisdom_roofline_print(const WisdomRoofline* roofline, FILE* out) {
+    fprintf(out, "peak %.2f GFLOP/s, bandwidth %.2f GB/s, ridge %.3f flop/byte\n",
+            roofline->peak_flops / 1e9, roofline->bandwidth / 1e9, roofline->ridge);
+    fprintf(out, "%-28s %10s %12s %12s %8s  %s\n", "kernel", "flop/byte", "GFLOP/s", "roof", "eff", "bound");
+    for (size_t i = 0; i < roofline->point_count; i++) {
+        const WisdomRooflinePoint* point = &roofline->points[i];
+        fprintf(out, "%-28s %10.4f %12.3f %12.3f %7.1f%%  %s\n", point->name ? point->name : "-",
+                point->intensity, point->flops_per_second / 1e9, point->roof / 1e9, 100.0 * point->efficiency,
+                point->memory_bound ? "memory" : "compute");
+    }
+}
+
+static inline void wisdom_roofline_json_string(const char* text, FILE* out) {
+    fputc('"', out);
+    for (const unsigned char* p = (const unsigned char*)(text ? text : "-"); *p; p++) {
+        if (*p == '"' || *p == '\\') fprintf(out, "\\%c", *p);
+        else if (*p < 0x20) fprintf(out, "\\u%04x", *p);
+        else fputc(*p, out);
+    }
+    fputc('"', out);
+}
+
+static inline void wisdom_roofline_xml_text(const char* text, FILE* out) {
+    for (const unsigned char* p = (const unsigned char*)(text ? text : "-"); *p; p++) {
+        if (*p == '<') fputs("&lt;", out);
+        else if (*p == '>') fputs("&gt;", out);
+        else if (*p == '&') fputs("&amp;", out);
+        else if (*p >= 0x20) fputc(*p, out);
+    }
+}
+
+static inline int wisdom_roofline_write_json(const WisdomRoofline* roofline, FILE* out) {
+    fprintf(out, "{\n  \"format\": \"o_wisdom-roofline\",\n  \"version\": 1,\n");
+    fprintf(out, "  \"peak_flops\": %.6g,\n  \"bandwidth\": %.6g,\n  \"ridge\": %.6g,\n  \"kernels\": [",
+            roofline->peak_flops, roofline->bandwidth, roofline->ridge);
+    for (size_t i = 0; i < roofline->point_count; i++) {
+        const WisdomRooflinePoint* point = &roofline->points[i];
+        fprintf(out, "%s\n    {\"name\": ", i ? "," : "");
+        wisdom_roofline_json_string(point->name, out);
+        fprintf(out, ", \"intensity\": %.6g, \"flops_per_second\": %.6g, \"roof\": %.6g, "
+                     "\"efficiency\": %.4f, \"bound\": \"%s\"}",
+                point->intensity, point->flops_per_second, point->roof, point->efficiency,
+                point->memory_bound ? "memory" : "compute");
+    }
+    fprintf(out, "\n  ]\n}\n");
+    return ferror(out) ? -1 : 0;
+}
+
+/*
+ * Log-log chart: intensity on x, GFLOP/s on y, with the bandwidth slope, the
+ * compute ceiling and one labelled dot per kernel.
+ */
+static inline int wisdom_roofline_write_svg(const WisdomRoofline* roofline, FILE* out) {
+    const double width = 720, height = 480, left = 70, right = 20, top = 20, bottom = 50;
+    double plot_w = width - left - right, plot_h = height - top - bottom;
+
+    // Axis ranges in powers of ten around the ridge and every kernel
+    double x_min = roofline->ridge > 0 ? roofline->ridge / 100 : 0.01;
+    double x_max = roofline->ridge > 0 ? roofline->ridge * 100 : 100;
+    double y_max = roofline->peak_flops > 0 ? roofline->peak_flops * 2 : 1e9;
+    double y_min = y_max / 1e4;
+    for (size_t i = 0; i < roofline->point_count; i++) {
+        const WisdomRooflinePoint* point = &roofline->points[i];
+        if (point->intensity < x_min) x_min = point->intensity / 2;
+        if (point->intensity > x_max) x_max = point->intensity * 2;
+        if (point->flops_per_second > 0 && point->flops_per_second < y_min) y_min = point->flops_per_second / 2;
+    }
+    double lx0 = floor(log10(x_min)), lx1 = ceil(log10(x_max));
+    double ly0 = floor(log10(y_min)), ly1 = ceil(log10(y_max));
+#define WISDOM_SVG_X(v) (left + (log10(v) - lx0) / (lx1 - lx0) * plot_w)
+#define WISDOM_SVG_Y(v) (top + plot_h - (log10(v) - ly0) / (ly1 - ly0) * plot_h)
+
+    fprintf(out, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%.0f\" height=\"%.0f\" "
+                 "font-family=\"sans-serif\" font-size=\"11\">\n", width, height);
+    fprintf(out, "<rect width=\"100%%\" height=\"100%%\" fill=\"white\"/>\n");
+    fprintf(out, "<rect x=\"%.1f\" y=\"%.1f\" width=\"%.1f\" height=\"%.1f\" fill=\"none\" stroke=\"#888\"/>\n",
+            left, top, plot_w, plot_h);
+
+    for (double e = lx0; e <= lx1; e++) {
+        double x = WISDOM_SVG_X(pow(10, e));
+        fprintf(out, "<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"#eee\"/>\n",
+                x, top, x, top + plot_h);
+        fprintf(out, "<text x=\"%.1f\" y=\"%.1f\" text-anchor=\"middle\">1e%g</text>\n", x, top + plot_h + 15, e);
+    }
+    for (double e = ly0; e <= ly1; e++) {
+        double y = WISDOM_SVG_Y(pow(10, e));
+        fprintf(out, "<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"#eee\"/>\n",
+                left, y, left + plot_w, y);
+        fprintf(out, "<text x=\"%.1f\" y=\"%.1f\" text-anchor=\"end\">%g</text>\n", left - 5, y + 4, pow(10, e) / 1e9);
+    }
+    fprintf(out, "<text x=\"%.1f\" y=\"%.1f\" text-anchor=\"middle\">arithmetic intensity (flop/byte)</text>\n",
+            left + plot_w / 2, height - 10);
+    fprintf(out, "<text transform=\"translate(15 %.1f) rotate(-90)\" text-anchor=\"middle\">GFLOP/s</text>\n",
+            top + plot_h / 2);
+
+    // Roof: bandwidth slope up to the ridge, then the compute ceiling
+    double start = pow(10, lx0), end = pow(10, lx1);
+    double ridge = roofline->ridge > start ? roofline->ridge : start;
+    double start_roof = wisdom_roofline_roof(roofline, start);
+    if (start_roof < pow(10, ly0)) {
+        start = pow(10, ly0) / roofline->bandwidth;
+        start_roof = pow(10, ly0);
+    }
+    fprintf(out, "<polyline fill=\"none\" stroke=\"#c0392b\" stroke-width=\"2\" "
+                 "points=\"%.1f,%.1f %.1f,%.1f %.1f,%.1f\"/>\n",
+            WISDOM_SVG_X(start), WISDOM_SVG_Y(start_roof), WISDOM_SVG_X(ridge),
+            WISDOM_SVG_Y(wisdom_roofline_roof(roofline, ridge)), WISDOM_SVG_X(end),
+            WISDOM_SVG_Y(roofline->peak_flops));
+    fprintf(out, "<text x=\"%.1f\" y=\"%.1f\" text-anchor=\"end\" fill=\"#c0392b\">%.1f GFLOP/s, %.1f GB/s</text>\n",
+            left + plot_w - 5, WISDOM_SVG_Y(roofline->peak_flops) - 6, roofline->peak_flops / 1e9,
+            roofline->bandwidth / 1e9);
+
+    for (size_t i = 0; i < roofline->point_count; i++) {
+        const WisdomRooflinePoint* point = &roofline->points[i];
+        if (!(point->flops_per_second > 0)) continue;
+        double x = WISDOM_SVG_X(point->intensity), y = WISDOM_SVG_Y(point->flops_per_second);
+        fprintf(out, "<circle cx=\"%.1f\" cy=\"%.1f\" r=\"4\" fill=\"%s\"/>\n",
+                x, y, point->memory_bound ? "#2980b9" : "#27ae60");
+        fprintf(out, "<text x=\"%.1f\" y=\"%.1f\">", x + 6, y - 6);
+        wisdom_roofline_xml_text(point->name, out);
+        fprintf(out, "</text>\n");
+    }
+    fprintf(out, "</svg>\n");
+
+#undef WISDOM_SVG_X
+#undef WISDOM_SVG_Y
+    return ferror(out) ? -1 : 0;
+}
+
+static inline int wisdom_roofline_save(const WisdomRoofline* roofline, const char* json_path, const char* svg_path) {
+    int result = 0;
+    if (json_path) {
+        FILE* out = fopen(json_path, "w");
+        if (!out) return -1;
+        if (wisdom_roofline_write_json(roofline, out) != 0) result = -1;
+        if (fclose(out) != 0) result = -1;
+    }
+    if (svg_path) {
+        FILE* out = fopen(svg_path, "w");
+        if (!out) return -1;
+        if (wisdom_roofline_write_svg(roofline, out) != 0) result = -1;
+        if (fclose(out) != 0) result = -1;
+    }
+    return result;
+}
+
+#endif // O_WISDOM_ROOFLINE_H
@@ -0,0 +1,288 @@
+#ifndef O_WISDOM_SCALE_H
+#define O_WISDOM_SCALE_H
+
+/*
+ * O_wisdom - parallel scalability analysis
+ *
+ * Runs a parallel callback on 1..max_threads pinned threads and derives:
+ *   - Strong scaling (fixed total n): speedup S(p) = T(1) / T(p), fitted to
+ *     Amdahl's law S = 1 / (s + (1 - s) / p).
+ *   - Weak scaling (n per thread): scaled speedup S(p) = p * T(1) / T(p),
+ *     fitted to Gustafson's law S = p - s (p - 1).
+ * Both fits report the serial fraction s; efficiency is S(p) / p. Points
+ * where speedup exceeds p (super-linear) or drops as threads are added
+ * (negative scaling) are flagged.
+ *
+ * Thread creation and pinning happen outside the timed region; all threads
+ * are released together through a gate and timing ends when the last one
+ * finishes. Runs should last milliseconds so wake-up latency is negligible.
+ * By default threads go to the isolated CPUs, then the rest of the allowed
+ * set (wisdom_env_measurement_cpus); a thread that cannot be pinned fails
+ * the measurement rather than silently running unpinned.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "O_wisdom_env.h"
+#include "O_wisdom_fit.h"
+
+#define WISDOM_SCALE_MAX_THREADS 256
+
+/*
+ * Called once per thread per run. n is the total problem size for this run;
+ * the callback is responsible for processing its share of it.
+ */
+typedef void (*WisdomParallelFn)(size_t thread_index, size_t thread_count, size_t n, void* user_data);
+
+typedef enum {
+    WISDOM_SCALE_STRONG = 1,
+    WISDOM_SCALE_WEAK = 2,
+    WISDOM_SCALE_BOTH = 3
+} WisdomScaleMode;
+
+typedef struct {
+    size_t max_threads;     // 0 means the number of CPUs in the pinning order
+    size_t n;               // Total size (strong) or size per thread (weak)
+    size_t repetitions;     // Median of this many runs per thread count
+    WisdomScaleMode mode;
+    const int* cpus;        // Optional pinning order; default from wisdom_env_measurement_cpus
+    size_t cpu_count;
+    double tolerance;       // Relative slack before flagging, e.g. 0.05
+} WisdomScaleConfig;
+
+typedef struct {
+    size_t point_count;                 // Thread counts 1..point_count
+    double seconds[WISDOM_SCALE_MAX_THREADS];
+    double speedup[WISDOM_SCALE_MAX_THREADS];
+    double efficiency[WISDOM_SCALE_MAX_THREADS];
+    int super_linear[WISDOM_SCALE_MAX_THREADS];
+    int negative[WISDOM_SCALE_MAX_THREADS];
+    double serial_fraction;             // Amdahl (strong) or Gustafson (weak)
+    double fit_rms;                     // RMS error of the fitted speedup curve
+} WisdomScaleSeries;
+
+typedef struct {
+    int has_strong;
+    int has_weak;
+    WisdomScaleSeries strong;
+    WisdomScaleSeries weak;
+} WisdomScaleReport;
+
+// Releases all threads of one run together and collects their completion
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    size_t ready;
+    size_t done;
+    size_t unpinned;        // Threads whose pinning failed
+    int go;
+    int abort;
+} WisdomScaleGate;
+
+typedef struct {
+    WisdomScaleGate* gate;
+    WisdomParallelFn fn;
+    void* user_data;
+    size_t thread_index;
+    size_t thread_count;
+    size_t n;
+    int cpu;
+} WisdomScaleThread;
+
+static inline void* wisdom_scale_worker(void* arg) {
+    WisdomScaleThread* thread = (WisdomScaleThread*)arg;
+    WisdomScaleGate* gate = thread->gate;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(thread->cpu, &set);
+    int pinned = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+
+    pthread_mutex_lock(&gate->lock);
+    gate->ready++;
+    if (!pinned) gate->unpinned++;
+    pthread_cond_broadcast(&gate->changed);
+    while (!gate->go) pthread_cond_wait(&gate->changed, &gate->lock);
+    int abort = gate->abort;
+    pthread_mutex_unlock(&gate->lock);
+
+    if (!abort) thread->fn(thread->thread_index, thread->thread_count, thread->n, thread->user_data);
+
+    pthread_mutex_lock(&gate->lock);
+    gate->done++;
+    pthread_cond_broadcast(&gate->changed);
+    pthread_mutex_unlock(&gate->lock);
+    return NULL;
+}
+
+/*
+ * Wall time of one run on thread_count threads pinned round-robin to
+ * config->cpus (never empty here), or a negative value when a thread cannot
+ * be created or pinned.
+ */
+static inline double wisdom_scale_run(const WisdomScaleConfig* config, WisdomParallelFn fn, void* user_data,
+                                      size_t thread_count, size_t n) {
+    pthread_t threads[WISDOM_SCALE_MAX_THREADS];
+    WisdomScaleThread args[WISDOM_SCALE_MAX_THREADS];
+    WisdomScaleGate gate;
+
+    memset(&gate, 0, sizeof(gate));
+    pthread_mutex_init(&gate.lock, NULL);
+    pthread_cond_init(&gate.changed, NULL);
+
+    size_t created = 0;
+    for (; created < thread_count; created++) {
+        WisdomScaleThread* arg = &args[created];
+        arg->gate = &gate;
+        arg->fn = fn;
+        arg->user_data = user_data;
+        arg->thread_index = created;
+        arg->thread_count = thread_count;
+        arg->n = n;
+        arg->cpu = config->cpus[created % config->cpu_count];
+        if (pthread_create(&threads[created], NULL, wisdom_scale_worker, arg) != 0) break;
+    }
+
+    // Wait until every thread is pinned and parked, then release them together
+    pthread_mutex_lock(&gate.lock);
+    while (gate.ready < created) pthread_cond_wait(&gate.changed, &gate.lock);
+    gate.abort = created != thread_count || gate.unpinned > 0;
+    gate.go = 1;
+    double t0 = wisdom_now();
+    pthread_cond_broadcast(&gate.changed);
+    while (gate.done < created) pthread_cond_wait(&gate.changed, &gate.lock);
+    double elapsed = wisdom_now() - t0;
+    pthread_mutex_unlock(&gate.lock);
+
+    for (size_t i = 0; i < created; i++) pthread_join(threads[i], NULL);
+    pthread_mutex_destroy(&gate.lock);
+    pthread_cond_destroy(&gate.changed);
+    return gate.abort ? -1.0 : elapsed;
+}
+
+static inline int wisdom_scale_series(const WisdomScaleConfig* config, WisdomParallelFn fn, void* user_data,
+                                      size_t max_threads, int weak, WisdomScaleSeries* series) {
+    double samples[64];
+    size_t repetitions = config->repetitions ? config->repetitions : 1;
+    if (repetitions > 64) repetitions = 64;
+
+    memset(series, 0, sizeof(*series));
+    for (size_t p = 1; p <= max_threads; p++) {
+        size_t n = weak ? config->n * p : config->n;
+        for (size_t r = 0; r < repetitions; r++) {
+            samples[r] = wisdom_scale_run(config, fn, user_data, p, n);
+            if (samples[r] < 0) return -1;
+        }
+        qsort(samples, repetitions, sizeof(double), wisdom_compare_double);
+        series->seconds[p - 1] = samples[repetitions / 2];
+        series->point_count = p;
+    }
+
+    double t1 = series->seconds[0] > 0 ? series->seconds[0] : 1e-12;
+    double tolerance = config->tolerance;
+    for (size_t i = 0; i < series->point_count; i++) {
+        double p = (double)(i + 1);
+        double tp = series->seconds[i] > 0 ? series->seconds[i] : 1e-12;
+        series->speedup[i] = weak ? p * t1 / tp : t1 / tp;
+        series->efficiency[i] = series->speedup[i] / p;
+        series->super_linear[i] = i > 0 && series->speedup[i] > p * (1.0 + tolerance);
+        series->negative[i] = i > 0 && series->speedup[i] < series->speedup[i - 1] * (1.0 - tolerance);
+    }
+
+    /*
+     * Both laws are linear in s after rearranging:
+     *   Amdahl:    1/S - 1/p = s (1 - 1/p)
+     *   Gustafson: p - S     = s (p - 1)
+     * so s is a one-parameter least-squares slope through the origin.
+     */
+    double sxy = 0, sxx = 0;
+    for (size_t i = 1; i < series->point_count; i++) {
+        double p = (double)(i + 1);
+        double x = weak ? p - 1.0 : 1.0 - 1.0 / p;
+        double y = weak ? p - series->speedup[i] : 1.0 / series->speedup[i] - 1.0 / p;
+        sxy += x * y;
+        sxx += x * x;
+    }
+    double s = sxx > 0 ? sxy / sxx : 0.0;
+    if (s < 0) s = 0;
+    if (s > 1) s = 1;
+    series->serial_fraction = s;
+
+    double error = 0;
+    for (size_t i = 0; i < series->point_count; i++) {
+        double p = (double)(i + 1);
+        double model = weak ? p - s * (p - 1.0) : 1.0 / (s + (1.0 - s) / p);
+        error += (series->speedup[i] - model) * (series->speedup[i] - model);
+    }
+    series->fit_rms = sqrt(error / (double)series->point_count);
+    return 0;
+}
+
+/*
+ * Measure scaling for the modes in config. Returns 0 on success, -1 on
+ * invalid config, no usable CPU, or a thread that cannot be created or
+ * pinned.
+ */
+static inline int wisdom_measure_scaling(const WisdomScaleConfig* config, WisdomParallelFn fn, void* user_data,
+                                         WisdomScaleReport* report) {
+    memset(report, 0, sizeof(*report));
+    if (!fn || config->n == 0) return -1;
+
+    WisdomScaleConfig pinning = *config;
+    int cpus[WISDOM_SCALE_MAX_THREADS];
+    if (!pinning.cpus || pinning.cpu_count == 0) {
+        pinning.cpus = cpus;
+        pinning.cpu_count = wisdom_env_measurement_cpus(cpus, WISDOM_SCALE_MAX_THREADS);
+        if (pinning.cpu_count == 0) return -1;
+    }
+    config = &pinning;
+
+    size_t max_threads = config->max_threads ? config->max_threads : config->cpu_count;
+    if (max_threads > WISDOM_SCALE_MAX_THREADS) max_threads = WISDOM_SCALE_MAX_THREADS;
+
+    if (config->mode & WISDOM_SCALE_STRONG) {
+        if (wisdom_scale_series(config, fn, user_data, max_threads, 0, &report->strong) != 0) return -1;
+        report->has_strong = 1;
+    }
+    if (config->mode & WISDOM_SCALE_WEAK) {
+        if (wisdom_scale_series(config, fn, user_data, max_threads, 1, &report->weak) != 0) return -1;
+        report->has_weak = 1;
+    }
+    return 0;
+}
+
+static inline void wisdom_print_scale_series(const char* title, const WisdomScaleSeries* series, FILE* out) {
+    fprintf(out, "%s\n%8s %14s %10s %10s\n", title, "threads", "seconds", "speedup", "efficiency");
+    for (size_t i = 0; i < series->point_count; i++) {
+        fprintf(out, "%8zu %14.6g %10.3f %9.1f%%%s%s\n", i + 1, series->seconds[i], series->speedup[i],
+                100.0 * series->efficiency[i],
+                series->super_linear[i] ? "  super-linear" : "",
+                series->negative[i] ? "  NEGATIVE SCALING" : "");
+    }
+}
+
+static inline void wisdom_print_scaling(const WisdomScaleReport* report, FILE* out) {
+    if (report->has_strong) {
+        wisdom_print_scale_series("strong scaling (fixed n)", &report->strong, out);
+        fprintf(out, "Amdahl serial fraction: %.4f (max speedup %.1fx, fit RMS %.3f)\n\n",
+                report->strong.serial_fraction,
+                report->strong.serial_fraction > 0 ? 1.0 / report->strong.serial_fraction : INFINITY,
+                report->strong.fit_rms);
+    }
+    if (report->has_weak) {
+        wisdom_print_scale_series("weak scaling (n per thread)", &report->weak, out);
+        fprintf(out, "Gustafson serial fraction: %.4f (fit RMS %.3f)\n\n",
+                report->weak.serial_fraction, report->weak.fit_rms);
+    }
+}
+
+#endif // O_WISDOM_SCALE_H
@@ -0,0 +1,411 @@
+#ifndef O_WISDOM_TIMING_H
+#define O_WISDOM_TIMING_H
+
+/*
+ * O_wisdom - statistically robust timing
+ *
+ * A measurement goes through four phases:
+ *   1. Calibration: the iteration count per sample doubles until one sample
+ *      lasts at least min_sample_seconds, so clock resolution is negligible.
+ *   2. Warm-up: samples are taken until the median of the last window agrees
+ *      with the window before it (caches, branch predictors, frequency ramp).
+ *   3. Sampling: up to max_samples samples within max_seconds.
+ *   4. Statistics: samples further than outlier_mads scaled MADs from the
+ *      median are rejected; median, MAD and a bootstrap confidence interval
+ *      for the median are reported.
+ *
+ * Timestamps come from the TSC when the CPU advertises an invariant one
+ * (calibrated against CLOCK_MONOTONIC), and from clock_gettime otherwise.
+ * The clock is calibrated once per process (one weak definition shared by
+ * every translation unit), whichever thread gets there first.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "O_wisdom_fit.h"
+
+#define WISDOM_TIMING_MAX_SAMPLES 256
+
+typedef enum {
+    WISDOM_CLOCK_MONOTONIC,
+    WISDOM_CLOCK_TSC
+} WisdomClockSource;
+
+typedef struct {
+    int initialized;
+    WisdomClockSource source;
+    double seconds_per_tick;
+} WisdomClock;
+
+typedef struct {
+    double min_sample_seconds;      // Target duration of one sample
+    size_t max_samples;             // At most WISDOM_TIMING_MAX_SAMPLES
+    double max_seconds;             // Budget for the sampling phase
+    size_t warmup_window;           // Samples per warm-up comparison window
+    double warmup_tolerance;        // Relative agreement that ends warm-up
+    double max_warmup_seconds;
+    double outlier_mads;            // Rejection threshold in scaled MADs
+    size_t bootstrap_resamples;
+    double confidence;              // e.g. 0.95
+} WisdomTimingConfig;
+
+typedef struct {
+    // Per-iteration seconds
+    double median;
+    double mad;                     // Scaled by 1.4826 to estimate sigma
+    double mean;
+    double min;
+    double max;
+    double ci_low;
+    double ci_high;
+
+    size_t iterations;              // Iterations per sample
+    size_t warmup_samples;
+    int warmed_up;                  // 0 if warm-up hit its time limit
+    size_t rejected;
+    size_t sample_count;            // Samples kept after outlier rejection
+    double samples[WISDOM_TIMING_MAX_SAMPLES];
+    WisdomClockSource clock;
+} WisdomTimingResult;
+
+__attribute__((weak)) WisdomClock wisdom_clock;
+__attribute__((weak)) pthread_once_t wisdom_clock_once = PTHREAD_ONCE_INIT;
+
+static inline void wisdom_timing_defaults(WisdomTimingConfig* config) {
+    config->min_sample_seconds = 1e-3;
+    config->max_samples = 100;
+    config->max_seconds = 1.0;
+    config->warmup_window = 5;
+    config->warmup_tolerance = 0.02;
+    config->max_warmup_seconds = 0.5;
+    config->outlier_mads = 3.5;
+    config->bootstrap_resamples = 1000;
+    config->confidence = 0.95;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t wisdom_rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("lfence\n\trdtsc" : "=a"(lo), "=d"(hi) : : "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// Only trust the TSC when it runs at a constant rate through idle states
+static inline int wisdom_tsc_invariant(void) {
+    FILE* file = fopen("/proc/cpuinfo", "r");
+    if (!file) return 0;
+
+    char line[4096];
+    int constant = 0, nonstop = 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (strncmp(line, "flags", 5) != 0) continue;
+        constant = strstr(line, " constant_tsc") != NULL;
+        nonstop = strstr(line, " nonstop_tsc") != NULL;
+        break;
+    }
+    fclose(file);
+    return constant && nonstop;
+}
+#endif
+
+static inline uint64_t wisdom_monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline void wisdom_clock_calibrate(void) {
+    wisdom_clock.source = WISDOM_CLOCK_MONOTONIC;
+    wisdom_clock.seconds_per_tick = 1e-9;
+
+#if defined(__x86_64__) || defined(__i386__)
+    if (wisdom_tsc_invariant()) {
+        double rates[3];
+        for (int i = 0; i < 3; i++) {
+            uint64_t t0 = wisdom_monotonic_ns();
+            uint64_t c0 = wisdom_rdtsc();
+            while (wisdom_monotonic_ns() - t0 < 10000000ULL) {
+            }
+            uint64_t t1 = wisdom_monotonic_ns();
+            uint64_t c1 = wisdom_rdtsc();
+            rates[i] = c1 > c0 ? (double)(t1 - t0) * 1e-9 / (double)(c1 - c0) : 0;
+        }
+        qsort(rates, 3, sizeof(double), wisdom_compare_double);
+        if (rates[1] > 0) {
+            wisdom_clock.source = WISDOM_CLOCK_TSC;
+            wisdom_clock.seconds_per_tick = rates[1];
+        }
+    }
+#endif
+
+    wisdom_clock.initialized = 1;
+}
+
+// Pick and calibrate the clock; cheap after the first call
+static inline void wisdom_clock_init(void) {
+    pthread_once(&wisdom_clock_once, wisdom_clock_calibrate);
+}
+
+static inline uint64_t wisdom_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (wisdom_clock.source == WISDOM_CLOCK_TSC) return wisdom_rdtsc();
+#endif
+    return wisdom_monotonic_ns();
+}
+
+static inline double wisdom_ticks_to_seconds(uint64_t ticks) {
+    return (double)ticks * wisdom_clock.seconds_per_tick;
+}
+
+// Seconds for one sample of `iterations` back-to-back runs
+static inline double wisdom_timing_sample(const WisdomWorkload* workload, void* state, size_t n, size_t iterations) {
+    uint64_t start = wisdom_ticks();
+    for (size_t i = 0; i < iterations; i++) workload->run(state, n, workload->user_data);
+    return wisdom_ticks_to_seconds(wisdom_ticks() - start);
+}
+
+// Median of the first count values (reorders them)
+static inline double wisdom_median(double* values, size_t count) {
+    if (count == 0) return NAN;
+    qsort(values, count, sizeof(double), wisdom_compare_double);
+    return count % 2 ? values[count / 2] : 0.5 * (values[count / 2 - 1] + values[count / 2]);
+}
+
+static inline uint64_t wisdom_timing_rand(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+// Percentile bootstrap interval for the median of samples
+static inline void wisdom_bootstrap_median(const double* samples, size_t count, size_t resamples, double confidence,
+                                           double* low, double* high) {
+    *low = *high = count ? samples[0] : NAN;
+    if (count < 2 || resamples == 0) return;
+
+    double* medians = (double*)malloc(resamples * sizeof(double));
+    double* scratch = (double*)malloc(count * sizeof(double));
+    if (!medians || !scratch) {
+        free(medians);
+        free(scratch);
+        return;
+    }
+
+    uint64_t rng = 0x9e3779b97f4a7c15ULL;
+    for (size_t r = 0; r < resamples; r++) {
+        for (size_t i = 0; i < count; i++) scratch[i] = samples[wisdom_timing_rand(&rng) % count];
+        medians[r] = wisdom_median(scratch, count);
+    }
+
+    qsort(medians, resamples, sizeof(double), wisdom_compare_double);
+    double tail = (1.0 - confidence) / 2.0;
+    *low = medians[(size_t)(tail * (double)(resamples - 1))];
+    *high = medians[(size_t)((1.0 - tail) * (double)(resamples - 1) + 0.5)];
+
+    free(medians);
+    free(scratch);
+}
+
+// Median, MAD, outlier rejection and bootstrap over raw per-iteration samples
+static inline void wisdom_timing_summarize(const WisdomTimingConfig* config, const double* raw, size_t count,
+                                           WisdomTimingResult* result) {
+    double sorted[WISDOM_TIMING_MAX_SAMPLES];
+    double deviations[WISDOM_TIMING_MAX_SAMPLES];
+    if (count > WISDOM_TIMING_MAX_SAMPLES) count = WISDOM_TIMING_MAX_SAMPLES;
+    if (count == 0) return;
+
+    memcpy(sorted, raw, count * sizeof(double));
+    double median = wisdom_median(sorted, count);
+    for (size_t i = 0; i < count; i++) deviations[i] = fabs(raw[i] - median);
+    double mad = 1.4826 * wisdom_median(deviations, count);
+
+    // With a zero MAD keep everything rather than rejecting all but the mode
+    result->sample_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (mad > 0 && fabs(raw[i] - median) > config->outlier_mads * mad) continue;
+        result->samples[result->sample_count++] = raw[i];
+    }
+    result->rejected = count - result->sample_count;
+
+    double sum = 0;
+    result->min = INFINITY;
+    result->max = 0;
+    for (size_t i = 0; i < result->sample_count; i++) {
+        double value = result->samples[i];
+        sum += value;
+        if (value < result->min) result->min = value;
+        if (value > result->max) result->max = value;
+    }
+    result->mean = sum / (double)result->sample_count;
+
+    memcpy(sorted, result->samples, result->sample_count * sizeof(double));
+    result->median = wisdom_median(sorted, result->sample_count);
+    for (size_t i = 0; i < result->sample_count; i++) deviations[i] = fabs(result->samples[i] - result->median);
+    result->mad = 1.4826 * wisdom_median(deviations, result->sample_count);
+
+    wisdom_bootstrap_median(result->samples, result->sample_count, config->bootstrap_resamples,
+                            config->confidence, &result->ci_low, &result->ci_high);
+}
+
+/*
+ * Measure one workload at size n. prepare/release run once around the whole
+ * measurement, so run() must be repeatable on the same state.
+ * config may be NULL for defaults. Returns 0 on success, -1 on invalid input
+ * or when prepare() returns NULL.
+ */
+static inline int wisdom_time_robust(const WisdomTimingConfig* config, const WisdomWorkload* workload, size_t n,
+                                     WisdomTimingResult* result) {
+    WisdomTimingConfig defaults;
+    if (!config) {
+        wisdom_timing_defaults(&defaults);
+        config = &defaults;
+    }
+
+    memset(result, 0, sizeof(*result));
+    if (!workload->run) return -1;
+
+    wisdom_clock_init();
+    result->clock = wisdom_clock.source;
+
+    void* state = workload->prepare ? workload->prepare(n, workload->user_data) : NULL;
+    if (workload->prepare && !state) return -1;
+
+    // Calibration doubles as the start of warm-up
+    size_t iterations = 1;
+    while (wisdom_timing_sample(workload, state, n, iterations) < config->min_sample_seconds &&
+           iterations < ((size_t)1 << 40)) {
+        iterations *= 2;
+    }
+    result->iterations = iterations;
+
+    // Warm-up: compare medians of consecutive windows
+    size_t window = config->warmup_window ? config->warmup_window : 1;
+    if (window > WISDOM_TIMING_MAX_SAMPLES / 2) window = WISDOM_TIMING_MAX_SAMPLES / 2;
+    double history[WISDOM_TIMING_MAX_SAMPLES];
+    size_t history_count = 0;
+    double warmup_start = wisdom_now();
+
+    for (;;) {
+        if (history_count == 2 * window) {
+            memmove(history, history + window, window * sizeof(double));
+            history_count = window;
+        }
+        history[history_count++] = wisdom_timing_sample(workload, state, n, iterations);
+        result->warmup_samples++;
+
+        if (history_count == 2 * window) {
+            double previous[WISDOM_TIMING_MAX_SAMPLES / 2];
+            double latest[WISDOM_TIMING_MAX_SAMPLES / 2];
+            memcpy(previous, history, window * sizeof(double));
+            memcpy(latest, history + window, window * sizeof(double));
+            double a = wisdom_median(previous, window);
+            double b = wisdom_median(latest, window);
+            if (fabs(a - b) <= config->warmup_tolerance * b) {
+                result->warmed_up = 1;
+                break;
+            }
+        }
+        if (wisdom_now() - warmup_start > config->max_warmup_seconds) break;
+    }
+
+    // Sampling
+    size_t max_samples = config->max_samples;
+    if (max_samples == 0 || max_samples > WISDOM_TIMING_MAX_SAMPLES) max_samples = WISDOM_TIMING_MAX_SAMPLES;
+    double raw[WISDOM_TIMING_MAX_SAMPLES];
+    size_t count = 0;
+    double sampling_start = wisdom_now();
+
+    while (count < max_samples) {
+        raw[count++] = wisdom_timing_sample(workload, state, n, iterations) / (double)iterations;
+        if (count >= 3 && wisdom_now() - sampling_start > config->max_seconds) break;
+    }
+
+    if (workload->release) workload->release(state, workload->user_data);
+
+    wisdom_timing_summarize(config, raw, count, result);
+    return 0;
+}
+
+static inline void wisdom_timing_print(const WisdomTimingResult* result, FILE* out) {
+    fprintf(out, "median %.6g s  MAD %.3g s  CI [%.6g, %.6g]  mean %.6g  min %.6g  max %.6g\n",
+            result->median, result->mad, result->ci_low, result->ci_high, result->mean, result->min, result->max);
+    fprintf(out, "  %zu samples x %zu iterations, %zu rejected, %zu warm-up samples%s, clock %s\n",
+            result->sample_count, result->iterations, result->rejected, result->warmup_samples,
+            result->warmed_up ? "" : " (not stabilised)",
+            result->clock == WISDOM_CLOCK_TSC ? "tsc" : "monotonic");
+}
+
+/*
+ * Complexity sweep using robust medians instead of single-shot timings.
+ * Same contract as wisdom_measure_complexity: each size is timed on
+ * `repetitions` separately prepared states and the median is kept. The
+ * repetitions run as passes over the whole sweep, so a slow spell of the
+ * machine lands on one pass of several sizes rather than on every timing of
+ * one size. timing may be NULL for defaults.
+ */
+static inline int wisdom_measure_complexity_robust(const WisdomSweepConfig* config, const WisdomTimingConfig* timing,
+                                                   const WisdomWorkload* workload, WisdomComplexityReport* report) {
+    double n[WISDOM_FIT_MAX_POINTS];
+    double seconds[WISDOM_FIT_MAX_POINTS];
+    size_t count = 0;
+
+    memset(report, 0, sizeof(*report));
+    if (!workload->run || config->min_n == 0 || config->max_n < config->min_n || !(config->growth > 1.0)) {
+        return -1;
+    }
+
+    double size = (double)config->min_n;
+    size_t previous = 0;
+    while (size <= (double)config->max_n && count < WISDOM_FIT_MAX_POINTS) {
+        size_t current = (size_t)(size + 0.5);
+        if (current != previous) {
+            n[count++] = (double)current;
+            previous = current;
+        }
+        size *= config->growth;
+    }
+
+    size_t repetitions = config->repetitions ? config->repetitions : 1;
+    if (repetitions > 64) repetitions = 64;
+
+    WisdomTimingResult* result = (WisdomTimingResult*)malloc(sizeof(WisdomTimingResult));
+    double* medians = (double*)malloc(count * repetitions * sizeof(double));
+    if (!result || !medians) {
+        free(result);
+        free(medians);
+        return -1;
+    }
+
+    for (size_t r = 0; r < repetitions; r++) {
+        for (size_t i = 0; i < count; i++) {
+            if (wisdom_time_robust(timing, workload, (size_t)n[i], result) != 0) {
+                free(result);
+                free(medians);
+                return -1;
+            }
+            medians[i * repetitions + r] = result->median;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        double* row = medians + i * repetitions;
+        qsort(row, repetitions, sizeof(double), wisdom_compare_double);
+        seconds[i] = row[repetitions / 2] > 1e-12 ? row[repetitions / 2] : 1e-12;
+    }
+
+    free(result);
+    free(medians);
+    return wisdom_fit_complexity(n, seconds, count, report);
+}
+
+#endif // O_WISDOM_TIMING_H
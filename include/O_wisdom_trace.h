@@ -0,0 +1,350 @@
+#ifndef O_WISDOM_TRACE_H
+#define O_WISDOM_TRACE_H
+
+/*
+ * O_wisdom - low-overhead event tracing
+ *
+ * Trace points write fixed-size binary events (timestamp, name id, thread,
+ * two integer arguments) into a ring buffer owned by the calling thread. The
+ * owner is the only writer, so recording is a TLS load, a timestamp and a
+ * 32-byte store with no atomics beyond a release store of the head; when the
+ * ring wraps the oldest events are overwritten. Buffers are registered on a
+ * lock-free list the first time a thread records and stay alive after the
+ * thread exits so its events can still be exported.
+ *
+ * Usage:
+ *   wisdom_trace_enable(0);                    // 0: default ring size
+ *   {
+ *       WISDOM_TRACE_SCOPE("lookup_batch");    // B on entry, E on scope exit
+ *       WISDOM_TRACE_INSTANT("flush", bytes, 0);
+ *   }
+ *   wisdom_trace_save_chrome("trace.json");    // chrome://tracing, Perfetto
+ *
+ * Names must be string literals (or otherwise outlive the trace); each trace
+ * site interns its name once. Define WISDOM_TRACE_DISABLE to compile every
+ * trace point away. Export while traced threads are quiescent: a ring being
+ * written during export may yield a few torn events.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "O_wisdom_timing.h"
+
+#define WISDOM_TRACE_DEFAULT_EVENTS (1u << 16)     // Per thread, rounded to a power of two
+#define WISDOM_TRACE_MAX_NAMES      4096
+
+typedef enum {
+    WISDOM_TRACE_BEGIN,
+    WISDOM_TRACE_END,
+    WISDOM_TRACE_INSTANT,
+    WISDOM_TRACE_COUNTER
+} WisdomTracePhase;
+
+typedef struct {
+    uint64_t ticks;
+    uint32_t id;            // Interned name
+    uint16_t thread;        // Index of the recording buffer
+    uint8_t phase;          // WisdomTracePhase
+    uint8_t arg_count;
+    uint64_t args[2];
+} WisdomTraceEvent;
+
+typedef struct WisdomTraceBuffer {
+    struct WisdomTraceBuffer* next;
+    WisdomTraceEvent* events;
+    uint64_t mask;
+    uint64_t head;          // Total events written; owner stores, exporter loads
+    uint32_t thread;
+    long os_tid;
+} WisdomTraceBuffer;
+
+typedef struct {
+    int enabled;
+    int use_tsc;
+    double seconds_per_tick;
+    uint64_t ring_events;
+    WisdomTraceBuffer* buffers;     // Lock-free push-only list
+    uint32_t thread_count;
+    uint32_t name_count;
+    const char* names[WISDOM_TRACE_MAX_NAMES];
+} WisdomTraceState;
+
+// Process-wide: one weak definition shared by every translation unit
+__attribute__((weak)) WisdomTraceState wisdom_trace_state;
+__attribute__((weak)) __thread WisdomTraceBuffer* wisdom_trace_local;
+
+static inline uint64_t wisdom_trace_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (wisdom_trace_state.use_tsc) return __builtin_ia32_rdtsc();
+#endif
+    return wisdom_monotonic_ns();
+}
+
+/*
+ * Start recording. ring_events is the per-thread capacity for buffers created
+ * from now on (0 for the default). Safe to call again to resume after
+ * wisdom_trace_disable.
+ */
+static inline void wisdom_trace_enable(size_t ring_events) {
+    wisdom_clock_init();
+    uint64_t capacity = 1;
+    uint64_t wanted = ring_events ? ring_events : WISDOM_TRACE_DEFAULT_EVENTS;
+    while (capacity < wanted) capacity <<= 1;
+
+    wisdom_trace_state.use_tsc = wisdom_clock.source == WISDOM_CLOCK_TSC;
+    wisdom_trace_state.seconds_per_tick = wisdom_clock.seconds_per_tick;
+    wisdom_trace_state.ring_events = capacity;
+    __atomic_store_n(&wisdom_trace_state.enabled, 1, __ATOMIC_RELEASE);
+}
+
+static inline void wisdom_trace_disable(void) {
+    __atomic_store_n(&wisdom_trace_state.enabled, 0, __ATOMIC_RELEASE);
+}
+
+// Interned id for name (ids start at 1; 0 means the table is full)
+static inline uint32_t wisdom_trace_intern(const char* name) {
+    uint32_t index = __atomic_fetch_add(&wisdom_trace_state.name_count, 1, __ATOMIC_RELAXED);
+    if (index >= WISDOM_TRACE_MAX_NAMES) return 0;
+    __atomic_store_n(&wisdom_trace_state.names[index], name, __ATOMIC_RELEASE);
+    return index + 1;
+}
+
+// Interned once per trace site; a race may intern the same name twice, which is harmless
+static inline uint32_t wisdom_trace_site(uint32_t* site, const char* name) {
+    uint32_t id = __atomic_load_n(site, __ATOMIC_ACQUIRE);
+    if (id == 0) {
+        id = wisdom_trace_intern(name);
+        __atomic_store_n(site, id, __ATOMIC_RELEASE);
+    }
+    return id;
+}
+
+// Slow path: first event on this thread
+static inline WisdomTraceBuffer* wisdom_trace_attach(void) {
+    WisdomTraceBuffer* buffer = (WisdomTraceBuffer*)calloc(1, sizeof(WisdomTraceBuffer));
+    if (!buffer) return NULL;
+
+    uint64_t capacity = wisdom_trace_state.ring_events ? wisdom_trace_state.ring_events : WISDOM_TRACE_DEFAULT_EVENTS;
+    buffer->events = (WisdomTraceEvent*)malloc(capacity * sizeof(WisdomTraceEvent));
+    if (!buffer->events) {
+        free(buffer);
+        return NULL;
+    }
+    buffer->mask = capacity - 1;
+    buffer->thread = __atomic_fetch_add(&wisdom_trace_state.thread_count, 1, __ATOMIC_RELAXED);
+    buffer->os_tid = (long)syscall(SYS_gettid);
+
+    WisdomTraceBuffer* head = __atomic_load_n(&wisdom_trace_state.buffers, __ATOMIC_RELAXED);
+    do {
+        buffer->next = head;
+    } while (!__atomic_compare_exchange_n(&wisdom_trace_state.buffers, &head, buffer, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    wisdom_trace_local = buffer;
+    return buffer;
+}
+
+static inline void wisdom_trace_emit(uint32_t id, WisdomTracePhase phase, unsigned arg_count, uint64_t a0, uint64_t a1) {
+    if (id == 0 || !__atomic_load_n(&wisdom_trace_state.enabled, __ATOMIC_RELAXED)) return;
+
+    WisdomTraceBuffer* buffer = wisdom_trace_local;
+    if (__builtin_expect(buffer == NULL, 0)) {
+        buffer = wisdom_trace_attach();
+        if (!buffer) return;
+    }
+
+    uint64_t head = buffer->head;
+    WisdomTraceEvent* event = &buffer->events[head & buffer->mask];
+    event->ticks = wisdom_trace_now();
+    event->id = id;
+    event->thread = (uint16_t)buffer->thread;
+    event->phase = (uint8_t)phase;
+    event->arg_count = (uint8_t)arg_count;
+    event->args[0] = a0;
+    event->args[1] = a1;
+    __atomic_store_n(&buffer->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/* ---------------------------------------------------------------------------
+ * Trace macros
+ * ------------------------------------------------------------------------- */
+
+typedef struct {
+    uint32_t id;
+} WisdomTraceScope;
+
+static inline WisdomTraceScope wisdom_trace_scope_begin(uint32_t* site, const char* name, unsigned arg_count,
+                                                        uint64_t a0, uint64_t a1) {
+    WisdomTraceScope scope = { 0 };
+    if (!__atomic_load_n(&wisdom_trace_state.enabled, __ATOMIC_RELAXED)) return scope;
+    scope.id = wisdom_trace_site(site, name);
+    wisdom_trace_emit(scope.id, WISDOM_TRACE_BEGIN, arg_count, a0, a1);
+    return scope;
+}
+
+static inline void wisdom_trace_scope_end(WisdomTraceScope* scope) {
+    if (scope->id) wisdom_trace_emit(scope->id, WISDOM_TRACE_END, 0, 0, 0);
+}
+
+#define WISDOM_TRACE_CAT2(a, b) a##b
+#define WISDOM_TRACE_CAT(a, b) WISDOM_TRACE_CAT2(a, b)
+
+#ifndef WISDOM_TRACE_DISABLE
+
+#define WISDOM_TRACE_SCOPE_ARGS(name, a0, a1)                                                        \
+    static uint32_t WISDOM_TRACE_CAT(wisdom_trace_site_, __LINE__);                                  \
+    WisdomTraceScope WISDOM_TRACE_CAT(wisdom_trace_scope_, __LINE__)                                 \
+        __attribute__((cleanup(wisdom_trace_scope_end))) =                                           \
+        wisdom_trace_scope_begin(&WISDOM_TRACE_CAT(wisdom_trace_site_, __LINE__), (name), 2,         \
+                                 (uint64_t)(a0), (uint64_t)(a1))
+
+#define WISDOM_TRACE_SCOPE(name)                                                                     \
+    static uint32_t WISDOM_TRACE_CAT(wisdom_trace_site_, __LINE__);                                  \
+    WisdomTraceScope WISDOM_TRACE_CAT(wisdom_trace_scope_, __LINE__)                                 \
+        __attribute__((cleanup(wisdom_trace_scope_end))) =                                           \
+        wisdom_trace_scope_begin(&WISDOM_TRACE_CAT(wisdom_trace_site_, __LINE__), (name), 0, 0, 0)
+
+#define WISDOM_TRACE_EVENT_(name, phase, count, a0, a1)                                              \
+    do {                                                                                             \
+        static uint32_t wisdom_trace_site_;                                                          \
+        if (__atomic_load_n(&wisdom_trace_state.enabled, __ATOMIC_RELAXED)) {                        \
+            wisdom_trace_emit(wisdom_trace_site(&wisdom_trace_site_, (name)), (phase), (count),      \
+                              (uint64_t)(a0), (uint64_t)(a1));                                       \
+        }                                                                                            \
+    } while (0)
+
+#define WISDOM_TRACE_BEGIN(name)            WISDOM_TRACE_EVENT_(name, WISDOM_TRACE_BEGIN, 0, 0, 0)
+#define WISDOM_TRACE_END(name)              WISDOM_TRACE_EVENT_(name, WISDOM_TRACE_END, 0, 0, 0)
+#define WISDOM_TRACE_INSTANT(name, a0, a1)  WISDOM_TRACE_EVENT_(name, WISDOM_TRACE_INSTANT, 2, a0, a1)
+#define WISDOM_TRACE_COUNTER(name, value)   WISDOM_TRACE_EVENT_(name, WISDOM_TRACE_COUNTER, 1, value, 0)
+
+#else
+
+#define WISDOM_TRACE_SCOPE_ARGS(name, a0, a1)   do { } while (0)
+#define WISDOM_TRACE_SCOPE(name)                do { } while (0)
+#define WISDOM_TRACE_BEGIN(name)                do { } while (0)
+#define WISDOM_TRACE_END(name)                  do { } while (0)
+#define WISDOM_TRACE_INSTANT(name, a0, a1)      do { } while (0)
+#define WISDOM_TRACE_COUNTER(name, value)       do { } while (0)
+
+#endif
+
+/* ---------------------------------------------------------------------------
+ * Export
+ * ------------------------------------------------------------------------- */
+
+// Number of events currently retained across all threads
+static inline size_t wisdom_trace_event_count(void) {
+    size_t total = 0;
+    for (WisdomTraceBuffer* b = __atomic_load_n(&wisdom_trace_state.buffers, __ATOMIC_ACQUIRE); b; b = b->next) {
+        uint64_t head = __atomic_load_n(&b->head, __ATOMIC_ACQUIRE);
+        total += head > b->mask ? b->mask + 1 : head;
+    }
+    return total;
+}
+
+static inline void wisdom_trace_json_string(const char* text, FILE* out) {
+    fputc('"', out);
+    for (const unsigned char* p = (const unsigned char*)(text ? text : "?"); *p; p++) {
+        if (*p == '"' || *p == '\\') fprintf(out, "\\%c", *p);
+        else if (*p < 0x20) fprintf(out, "\\u%04x", *p);
+        else fputc(*p, out);
+    }
+    fputc('"', out);
+}
+
+/*
+ * Write all retained events in Chrome trace-event JSON. Timestamps are in
+ * microseconds relative to the earliest retained event. Returns 0 on
+ * success, -1 on write error.
+ */
+static inline int wisdom_trace_write_chrome(FILE* out) {
+    static const char phases[] = { 'B', 'E', 'i', 'C' };
+    WisdomTraceBuffer* buffers = __atomic_load_n(&wisdom_trace_state.buffers, __ATOMIC_ACQUIRE);
+    double seconds_per_tick = wisdom_trace_state.seconds_per_tick > 0 ? wisdom_trace_state.seconds_per_tick : 1e-9;
+    long pid = (long)getpid();
+
+    uint64_t origin = UINT64_MAX;
+    for (WisdomTraceBuffer* b = buffers; b; b = b->next) {
+        uint64_t head = __atomic_load_n(&b->head, __ATOMIC_ACQUIRE);
+        uint64_t first = head > b->mask ? head - b->mask - 1 : 0;
+        if (head > first && b->events[first & b->mask].ticks < origin) origin = b->events[first & b->mask].ticks;
+    }
+    if (origin == UINT64_MAX) origin = 0;
+
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    int first_record = 1;
+    for (WisdomTraceBuffer* b = buffers; b; b = b->next) {
+        fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%ld,"
+                     "\"args\":{\"name\":\"thread %u\"}}",
+                first_record ? "" : ",\n", pid, b->os_tid, b->thread);
+        first_record = 0;
+
+        uint64_t head = __atomic_load_n(&b->head, __ATOMIC_ACQUIRE);
+        uint64_t first = head > b->mask ? head - b->mask - 1 : 0;
+        for (uint64_t i = first; i < head; i++) {
+            const WisdomTraceEvent* event = &b->events[i & b->mask];
+            uint32_t id = event->id;
+            const char* name = id && id <= WISDOM_TRACE_MAX_NAMES ?
+                __atomic_load_n(&wisdom_trace_state.names[id - 1], __ATOMIC_ACQUIRE) : NULL;
+            double ts = event->ticks >= origin ? (double)(event->ticks - origin) * seconds_per_tick * 1e6 : 0.0;
+
+            fprintf(out, ",\n{\"name\":");
+            wisdom_trace_json_string(name, out);
+            fprintf(out, ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%ld,\"tid\":%ld",
+                    phases[event->phase & 3], ts, pid, b->os_tid);
+            if (event->phase == WISDOM_TRACE_INSTANT) fprintf(out, ",\"s\":\"t\"");
+            if (event->arg_count == 1) {
+                fprintf(out, ",\"args\":{\"value\":%llu}", (unsigned long long)event->args[0]);
+            } else if (event->arg_count == 2) {
+                fprintf(out, ",\"args\":{\"a0\":%llu,\"a1\":%llu}",
+                        (unsigned long long)event->args[0], (unsigned long long)event->args[1]);
+            }
+            fputc('}', out);
+        }
+    }
+    fprintf(out, "\n]}\n");
+    return ferror(out) ? -1 : 0;
+}
+
+static inline int wisdom_trace_save_chrome(const char* path) {
+    FILE* out = fopen(path, "w");
+    if (!out) return -1;
+    int result = wisdom_trace_write_chrome(out);
+    if (fclose(out) != 0) result = -1;
+    return result;
+}
+
+// Discard retained events; only while no thread is recording
+static inline void wisdom_trace_clear(void) {
+    for (WisdomTraceBuffer* b = __atomic_load_n(&wisdom_trace_state.buffers, __ATOMIC_ACQUIRE); b; b = b->next) {
+        __atomic_store_n(&b->head, 0, __ATOMIC_RELEASE);
+    }
+}
+
+/*
+ * Free every buffer. Only once all traced threads have exited or will never
+ * record again; the calling thread may record again after re-enabling.
+ */
+static inline void cleanup_wisdom_trace(void) {
+    wisdom_trace_disable();
+    WisdomTraceBuffer* b = __atomic_exchange_n(&wisdom_trace_state.buffers, NULL, __ATOMIC_ACQ_REL);
+    while (b) {
+        WisdomTraceBuffer* next = b->next;
+        free(b->events);
+        free(b);
+        b = next;
+    }
+    wisdom_trace_local = NULL;
+    wisdom_trace_state.thread_count = 0;
+}
+
+#endif // O_WISDOM_TRACE_H
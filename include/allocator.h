@@ -0,0 +1,104 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+/*
+ * Pluggable allocator interface
+ *
+ * An Allocator is a small vtable plus a context pointer. Constructors that
+ * accept one route every allocation of the object through it for the
+ * object's lifetime; NULL selects the C library. Because the allocator may
+ * be called from the object's worker threads, it must be thread-safe unless
+ * the object is documented as single-threaded.
+ *
+ * To count an object's memory, hand it wisdom_alloc_allocator() from
+ * O_wisdom_alloc.h; its allocations then land in the O_wisdom space
+ * counters:
+ *   wisdom_alloc_tracking(1);
+ *   init_mirror_sharded_whitelist(&wl, 4, NULL, wisdom_alloc_allocator());
+ *   ...
+ *   WisdomAllocStats stats = wisdom_alloc_snapshot();
+ */
+
+// posix_memalign needs POSIX declarations, which -std=c99 alone hides. This
+// only works ahead of the first system header, so every header including
+// this one repeats the guard at its own top.
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    void* (*alloc)(void* ctx, size_t size);
+    void* (*realloc)(void* ctx, void* p, size_t size);
+    void (*free)(void* ctx, void* p);
+    void* (*aligned_alloc)(void* ctx, size_t alignment, size_t size);   // alignment is a power of two
+    void* ctx;
+} Allocator;
+
+static inline void* allocator_system_alloc(void* ctx, size_t size) {
+    (void)ctx;
+    return malloc(size);
+}
+
+static inline void* allocator_system_realloc(void* ctx, void* p, size_t size) {
+    (void)ctx;
+    return realloc(p, size);
+}
+
+static inline void allocator_system_free(void* ctx, void* p) {
+    (void)ctx;
+    free(p);
+}
+
+static inline void* allocator_system_aligned_alloc(void* ctx, size_t alignment, size_t size) {
+    (void)ctx;
+    void* p = NULL;
+    if (alignment < sizeof(void*)) alignment = sizeof(void*);
+    return posix_memalign(&p, alignment, size) == 0 ? p : NULL;
+}
+
+static const Allocator allocator_system_instance = {
+    allocator_system_alloc, allocator_system_realloc, allocator_system_free, allocator_system_aligned_alloc, NULL
+};
+
+static inline const Allocator* allocator_system(void) {
+    return &allocator_system_instance;
+}
+
+/* ---------------------------------------------------------------------------
+ * Call helpers; a NULL allocator is the C library
+ * ------------------------------------------------------------------------- */
+
+static inline void* allocator_alloc(const Allocator* a, size_t size) {
+    if (!a) return malloc(size);
+    return a->alloc(a->ctx, size);
+}
+
+static inline void* allocator_calloc(const Allocator* a, size_t count, size_t size) {
+    if (!a) return calloc(count, size);
+    if (size && count > SIZE_MAX / size) return NULL;
+    void* p = a->alloc(a->ctx, count * size);
+    if (p) memset(p, 0, count * size);
+    return p;
+}
+
+static inline void* allocator_realloc(const Allocator* a, void* p, size_t size) {
+    if (!a) return realloc(p, size);
+    return a->realloc(a->ctx, p, size);
+}
+
+static inline void allocator_free(const Allocator* a, void* p) {
+    if (!p) return;
+    if (!a) free(p);
+    else a->free(a->ctx, p);
+}
+
+static inline void* allocator_aligned_alloc(const Allocator* a, size_t alignment, size_t size) {
+    if (!a) return allocator_system_aligned_alloc(NULL, alignment, size);
+    return a->aligned_alloc(a->ctx, alignment, size);
+}
+
+#endif // ALLOCATOR_H
@@ -0,0 +1,607 @@
+#ifndef CHUNK_FILE_H
+#define CHUNK_FILE_H
+
+/*
+ * Chunked container for framework state
+ *
+ * One file holds any number of typed chunks (memory regions, tick stacks,
+ * Higgs fields, compiled whitelists, or user types), so a process can
+ * snapshot its whole state at once and restore only the parts it needs.
+ *
+ * Layout, all integers little-endian:
+ *   [header, padded to 4 KiB][chunk][pad]...[chunk][pad][table of contents]
+ *
+ *   header (64 bytes)
+ *     0  magic "KINGCHNK"        8  version (u32)          12 flags (u32)
+ *     16 chunk count (u32)       20 reserved (u32)
+ *     24 toc offset (u64)        32 toc size (u64)
+ *     40 toc CRC32C (u32)        44 reserved, zero (16 bytes)
+ *     60 header CRC32C over bytes 0..59 (u32)
+ *
+ *   toc entry (64 bytes)
+ *     0  type (u32)              4  compression (u32)
+ *     8  id (u64)                16 offset (u64, multiple of 4096)
+ *     24 stored size (u64)       32 size (u64, uncompressed)
+ *     40 CRC32C of the stored bytes (u32)
+ *     44 name (20 bytes, NUL-padded)
+ *
+ * Every chunk starts on a 4 KiB boundary, so an uncompressed chunk viewed
+ * through the read-only mapping is page-aligned and can be used in place.
+ * The reader maps the file and validates only the header and table of
+ * contents; chunk pages are faulted in (and their checksum verified) when
+ * a chunk is actually read.
+ *
+ * The writer fills a temporary file next to the target and only renames it
+ * over the target in chunk_file_finish, after an fsync, so a crash or a
+ * failed write leaves the previous file intact.
+ *
+ * Compression is per chunk. Define CHUNK_FILE_LZ4 and/or CHUNK_FILE_ZSTD
+ * (and link liblz4 / libzstd) to enable it. A writer without the codec,
+ * or a chunk that does not shrink, is stored uncompressed; a reader
+ * without the codec fails only on the chunks that need it.
+ *
+ * Usage:
+ *   ChunkFileWriter w;
+ *   chunk_file_create(&w, "state.kc");
+ *   chunk_file_add_whitelist(&w, 0, "edge", &wl, CHUNK_COMPRESSION_ZSTD);
+ *   chunk_file_add(&w, CHUNK_TYPE_USER, 0, "config", data, size, CHUNK_COMPRESSION_NONE);
+ *   chunk_file_finish(&w);
+ *
+ *   ChunkFileReader r;
+ *   chunk_file_open(&r, "state.kc");
+ *   long i = chunk_file_find(&r, CHUNK_TYPE_WHITELIST, 0);
+ *   init_mirror_sharded_whitelist(&restored, 4, NULL, NULL);
+ *   chunk_file_read_whitelist(&r, (size_t)i, &restored);
+ *   mirror_shard_compile(&restored);
+ *   chunk_file_close(&r);
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mirror_shard.h"
+
+#ifdef CHUNK_FILE_LZ4
+#include <lz4.h>
+#endif
+#ifdef CHUNK_FILE_ZSTD
+#include <zstd.h>
+#endif
+
+#define CHUNK_FILE_MAGIC        "KINGCHNK"
+#define CHUNK_FILE_VERSION      1
+#define CHUNK_FILE_ALIGN        4096
+#define CHUNK_FILE_HEADER_SIZE  64
+#define CHUNK_FILE_ENTRY_SIZE   64
+#define CHUNK_FILE_NAME_MAX     20
+#define CHUNK_FILE_ZSTD_LEVEL   3
+#define CHUNK_FILE_TEMP_TRIES   16
+
+// Types below CHUNK_TYPE_USER are reserved for the framework
+typedef enum {
+    CHUNK_TYPE_MEMORY_REGION = 1,
+    CHUNK_TYPE_TICK_STACK = 2,
+    CHUNK_TYPE_HIGGS_FIELD = 3,
+    CHUNK_TYPE_WHITELIST = 4,
+    CHUNK_TYPE_USER = 0x10000
+} ChunkType;
+
+typedef enum {
+    CHUNK_COMPRESSION_NONE = 0,
+    CHUNK_COMPRESSION_LZ4 = 1,
+    CHUNK_COMPRESSION_ZSTD = 2
+} ChunkCompression;
+
+typedef struct {
+    uint32_t type;
+    uint32_t compression;
+    uint64_t id;
+    uint64_t offset;
+    uint64_t stored_size;
+    uint64_t size;
+    uint32_t crc;
+    char name[CHUNK_FILE_NAME_MAX + 1];
+} ChunkFileEntry;
+
+typedef struct {
+    FILE* file;
+    char* path;                     // Target, replaced by finish
+    char* temp_path;                // Written until finish renames it over path
+    uint64_t position;
+    int failed;
+    ChunkFileEntry* entries;
+    size_t entry_count;
+    size_t entry_capacity;
+} ChunkFileWriter;
+
+typedef struct {
+    const unsigned char* map;
+    size_t map_size;
+    uint32_t version;
+    ChunkFileEntry* entries;
+    size_t entry_count;
+} ChunkFileReader;
+
+/* ---------------------------------------------------------------------------
+ * Encoding helpers
+ * ------------------------------------------------------------------------- */
+
+static inline uint32_t chunk_file_crc32c(uint32_t crc, const void* data, size_t size) {
+    // Nibble table for the reflected Castagnoli polynomial 0x82F63B78
+    static const uint32_t table[16] = {
+        0x00000000, 0x105ec76f, 0x20bd8ede, 0x30e349b1, 0x417b1dbc, 0x5125dad3, 0x61c69362, 0x7198540d,
+        0x82f63b78, 0x92a8fc17, 0xa24bb5a6, 0xb21572c9, 0xc38d26c4, 0xd3d3e1ab, 0xe330a81a, 0xf36e6f75
+    };
+    const unsigned char* p = (const unsigned char*)data;
+    crc = ~crc;
+
+#if defined(__SSE4_2__) && defined(__x86_64__)
+    for (; size >= 8; size -= 8, p += 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        crc = (uint32_t)__builtin_ia32_crc32di(crc, word);
+    }
+#endif
+    for (size_t i = 0; i < size; i++) {
+        crc ^= p[i];
+        crc = (crc >> 4) ^ table[crc & 15];
+        crc = (crc >> 4) ^ table[crc & 15];
+    }
+    return ~crc;
+}
+
+static inline void chunk_file_put32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static inline void chunk_file_put64(unsigned char* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static inline uint32_t chunk_file_get32(const unsigned char* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static inline uint64_t chunk_file_get64(const unsigned char* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static inline void chunk_file_encode_entry(const ChunkFileEntry* e, unsigned char* p) {
+    memset(p, 0, CHUNK_FILE_ENTRY_SIZE);
+    chunk_file_put32(p, e->type);
+    chunk_file_put32(p + 4, e->compression);
+    chunk_file_put64(p + 8, e->id);
+    chunk_file_put64(p + 16, e->offset);
+    chunk_file_put64(p + 24, e->stored_size);
+    chunk_file_put64(p + 32, e->size);
+    chunk_file_put32(p + 40, e->crc);
+    memcpy(p + 44, e->name, strnlen(e->name, CHUNK_FILE_NAME_MAX));
+}
+
+static inline void chunk_file_decode_entry(const unsigned char* p, ChunkFileEntry* e) {
+    memset(e, 0, sizeof(*e));
+    e->type = chunk_file_get32(p);
+    e->compression = chunk_file_get32(p + 4);
+    e->id = chunk_file_get64(p + 8);
+    e->offset = chunk_file_get64(p + 16);
+    e->stored_size = chunk_file_get64(p + 24);
+    e->size = chunk_file_get64(p + 32);
+    e->crc = chunk_file_get32(p + 40);
+    memcpy(e->name, p + 44, CHUNK_FILE_NAME_MAX);
+}
+
+/* ---------------------------------------------------------------------------
+ * Writer
+ * ------------------------------------------------------------------------- */
+
+static inline void chunk_file_write(ChunkFileWriter* w, const void* data, size_t size) {
+    if (w->failed || size == 0) return;
+    if (fwrite(data, 1, size, w->file) != size) w->failed = 1;
+    w->position += size;
+}
+
+static inline void chunk_file_pad(ChunkFileWriter* w) {
+    static const unsigned char zeros[CHUNK_FILE_ALIGN];
+    size_t pad = (size_t)((CHUNK_FILE_ALIGN - w->position % CHUNK_FILE_ALIGN) % CHUNK_FILE_ALIGN);
+    chunk_file_write(w, zeros, pad);
+}
+
+__attribute__((weak)) unsigned chunk_file_temp_counter;
+
+// Release everything the writer holds; the temporary file is removed unless it was renamed
+static inline void chunk_file_release(ChunkFileWriter* w) {
+    if (w->file) fclose(w->file);
+    if (w->temp_path) unlink(w->temp_path);
+    free(w->path);
+    free(w->temp_path);
+    free(w->entries);
+    memset(w, 0, sizeof(*w));
+}
+
+/*
+ * Start writing path. The chunks go to a new temporary file in the same
+ * directory; path itself is untouched until chunk_file_finish. Returns 0
+ * on success, -1 if the file cannot be created.
+ */
+static inline int chunk_file_create(ChunkFileWriter* w, const char* path) {
+    memset(w, 0, sizeof(*w));
+    size_t length = strlen(path);
+    w->path = (char*)malloc(length + 1);
+    w->temp_path = (char*)malloc(length + 48);
+    if (!w->path || !w->temp_path) {
+        chunk_file_release(w);
+        return -1;
+    }
+    memcpy(w->path, path, length + 1);
+
+    // O_EXCL so a concurrent writer of the same target never shares the temporary
+    int fd = -1;
+    for (int attempt = 0; fd < 0 && attempt < CHUNK_FILE_TEMP_TRIES; attempt++) {
+        snprintf(w->temp_path, length + 48, "%s.tmp.%ld.%u", path, (long)getpid(),
+                 __atomic_fetch_add(&chunk_file_temp_counter, 1, __ATOMIC_RELAXED));
+        fd = open(w->temp_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (fd < 0 && errno != EEXIST) break;
+    }
+    if (fd < 0) {
+        free(w->temp_path);
+        w->temp_path = NULL;
+        chunk_file_release(w);
+        return -1;
+    }
+    w->file = fdopen(fd, "wb");
+    if (!w->file) {
+        close(fd);
+        chunk_file_release(w);
+        return -1;
+    }
+
+    // Header placeholder; the real one is written by chunk_file_finish
+    chunk_file_pad(w);
+    unsigned char header[CHUNK_FILE_HEADER_SIZE] = { 0 };
+    chunk_file_write(w, header, sizeof(header));
+    chunk_file_pad(w);
+    if (w->failed) {
+        chunk_file_release(w);
+        return -1;
+    }
+    return 0;
+}
+
+// Give up on a write started by chunk_file_create; the target is left as it was
+static inline void chunk_file_abort(ChunkFileWriter* w) {
+    chunk_file_release(w);
+}
+
+/*
+ * Compress src into a new buffer with the requested codec. Returns the
+ * stored size, or 0 when the codec is unavailable, fails, or does not
+ * shrink the data (the chunk is then stored uncompressed).
+ */
+static inline size_t chunk_file_compress(ChunkCompression compression, const void* src, size_t size,
+                                         void** out) {
+    *out = NULL;
+    size_t stored = 0;
+#ifdef CHUNK_FILE_LZ4
+    if (compression == CHUNK_COMPRESSION_LZ4 && size <= (size_t)LZ4_MAX_INPUT_SIZE) {
+        int bound = LZ4_compressBound((int)size);
+        *out = malloc((size_t)bound);
+        if (*out) {
+            int result = LZ4_compress_default((const char*)src, (char*)*out, (int)size, bound);
+            stored = result > 0 ? (size_t)result : 0;
+        }
+    }
+#endif
+#ifdef CHUNK_FILE_ZSTD
+    if (compression == CHUNK_COMPRESSION_ZSTD) {
+        size_t bound = ZSTD_compressBound(size);
+        *out = malloc(bound);
+        if (*out) {
+            size_t result = ZSTD_compress(*out, bound, src, size, CHUNK_FILE_ZSTD_LEVEL);
+            stored = ZSTD_isError(result) ? 0 : result;
+        }
+    }
+#endif
+    (void)compression;
+    (void)src;
+    if (stored == 0 || stored >= size) {
+        free(*out);
+        *out = NULL;
+        return 0;
+    }
+    return stored;
+}
+
+/*
+ * Append one chunk. name may be NULL and is truncated to 20 bytes; (type,
+ * id) should be unique within the file. Returns 0 on success, -1 on I/O or
+ * allocation failure (the writer is then failed and finish returns -1).
+ */
+static inline int chunk_file_add(ChunkFileWriter* w, uint32_t type, uint64_t id, const char* name,
+                                 const void* data, size_t size, ChunkCompression compression) {
+    if (w->failed) return -1;
+    if (w->entry_count == w->entry_capacity) {
+        size_t capacity = w->entry_capacity ? w->entry_capacity * 2 : 16;
+        ChunkFileEntry* entries = (ChunkFileEntry*)realloc(w->entries, capacity * sizeof(ChunkFileEntry));
+        if (!entries) {
+            w->failed = 1;
+            return -1;
+        }
+        w->entries = entries;
+        w->entry_capacity = capacity;
+    }
+
+    void* packed = NULL;
+    size_t stored = compression != CHUNK_COMPRESSION_NONE ? chunk_file_compress(compression, data, size, &packed) : 0;
+    const void* bytes = packed ? packed : data;
+    if (!packed) stored = size;
+
+    ChunkFileEntry* e = &w->entries[w->entry_count];
+    memset(e, 0, sizeof(*e));
+    e->type = type;
+    e->compression = packed ? (uint32_t)compression : CHUNK_COMPRESSION_NONE;
+    e->id = id;
+    e->offset = w->position;
+    e->stored_size = stored;
+    e->size = size;
+    e->crc = chunk_file_crc32c(0, bytes, stored);
+    if (name) strncpy(e->name, name, CHUNK_FILE_NAME_MAX);
+
+    chunk_file_write(w, bytes, stored);
+    chunk_file_pad(w);
+    free(packed);
+    if (w->failed) return -1;
+    w->entry_count++;
+    return 0;
+}
+
+// fsync the directory holding path so a rename into it is durable
+static inline int chunk_file_sync_directory(const char* path) {
+    const char* slash = strrchr(path, '/');
+    char* directory = slash ? strndup(path, slash == path ? 1 : (size_t)(slash - path)) : strdup(".");
+    if (!directory) return -1;
+    int fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    free(directory);
+    if (fd < 0) return -1;
+    // Some filesystems cannot sync a directory; the rename is as durable as they allow
+    int result = fsync(fd) == 0 || errno == EINVAL ? 0 : -1;
+    close(fd);
+    return result;
+}
+
+/*
+ * Write the table of contents and header, fsync, and rename the file over
+ * the target. Always releases the writer; on failure the temporary file is
+ * removed and the target is left as it was. Returns 0 on success, -1 on
+ * failure.
+ */
+static inline int chunk_file_finish(ChunkFileWriter* w) {
+    size_t toc_size = w->entry_count * CHUNK_FILE_ENTRY_SIZE;
+    unsigned char* toc = (unsigned char*)calloc(1, toc_size ? toc_size : 1);
+    if (!toc) w->failed = 1;
+
+    uint64_t toc_offset = w->position;
+    if (toc) {
+        for (size_t i = 0; i < w->entry_count; i++) {
+            chunk_file_encode_entry(&w->entries[i], toc + i * CHUNK_FILE_ENTRY_SIZE);
+        }
+        chunk_file_write(w, toc, toc_size);
+    }
+
+    unsigned char header[CHUNK_FILE_HEADER_SIZE] = { 0 };
+    memcpy(header, CHUNK_FILE_MAGIC, 8);
+    chunk_file_put32(header + 8, CHUNK_FILE_VERSION);
+    chunk_file_put32(header + 16, (uint32_t)w->entry_count);
+    chunk_file_put64(header + 24, toc_offset);
+    chunk_file_put64(header + 32, toc_size);
+    chunk_file_put32(header + 40, toc ? chunk_file_crc32c(0, toc, toc_size) : 0);
+    chunk_file_put32(header + 60, chunk_file_crc32c(0, header, 60));
+    free(toc);
+
+    if (!w->failed && fseek(w->file, 0, SEEK_SET) != 0) w->failed = 1;
+    if (!w->failed && fwrite(header, 1, sizeof(header), w->file) != sizeof(header)) w->failed = 1;
+    if (!w->failed && (fflush(w->file) != 0 || fsync(fileno(w->file)) != 0)) w->failed = 1;
+    int closed = fclose(w->file);
+    w->file = NULL;
+    if (closed != 0) w->failed = 1;
+
+    if (!w->failed && rename(w->temp_path, w->path) == 0) {
+        // Nothing left for release to unlink
+        free(w->temp_path);
+        w->temp_path = NULL;
+        int result = chunk_file_sync_directory(w->path);
+        chunk_file_release(w);
+        return result;
+    }
+    chunk_file_release(w);
+    return -1;
+}
+
+/* ---------------------------------------------------------------------------
+ * Reader
+ * ------------------------------------------------------------------------- */
+
+static inline void chunk_file_close(ChunkFileReader* r) {
+    if (r->map) munmap((void*)r->map, r->map_size);
+    free(r->entries);
+    memset(r, 0, sizeof(*r));
+}
+
+/*
+ * Map path and validate its header and table of contents. Chunk data is not
+ * read. Returns 0 on success, -1 on I/O error, bad checksum, unsupported
+ * version or an entry that points outside the file.
+ */
+static inline int chunk_file_open(ChunkFileReader* r, const char* path) {
+    memset(r, 0, sizeof(*r));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < CHUNK_FILE_HEADER_SIZE) {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    r->map = (const unsigned char*)map;
+    r->map_size = (size_t)st.st_size;
+
+    const unsigned char* header = r->map;
+    uint64_t toc_offset = chunk_file_get64(header + 24);
+    uint64_t toc_size = chunk_file_get64(header + 32);
+    size_t count = chunk_file_get32(header + 16);
+    r->version = chunk_file_get32(header + 8);
+
+    if (memcmp(header, CHUNK_FILE_MAGIC, 8) != 0 || r->version == 0 || r->version > CHUNK_FILE_VERSION ||
+        chunk_file_get32(header + 60) != chunk_file_crc32c(0, header, 60) ||
+        toc_size != (uint64_t)count * CHUNK_FILE_ENTRY_SIZE || toc_offset > r->map_size ||
+        toc_size > r->map_size - toc_offset ||
+        chunk_file_get32(header + 40) != chunk_file_crc32c(0, r->map + toc_offset, (size_t)toc_size)) {
+        chunk_file_close(r);
+        return -1;
+    }
+
+    r->entries = (ChunkFileEntry*)calloc(count ? count : 1, sizeof(ChunkFileEntry));
+    if (!r->entries) {
+        chunk_file_close(r);
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        ChunkFileEntry* e = &r->entries[i];
+        chunk_file_decode_entry(r->map + toc_offset + i * CHUNK_FILE_ENTRY_SIZE, e);
+        if (e->offset % CHUNK_FILE_ALIGN != 0 || e->offset > toc_offset || e->stored_size > toc_offset - e->offset) {
+            chunk_file_close(r);
+            return -1;
+        }
+    }
+    r->entry_count = count;
+
+    // Only the table of contents is needed up front
+    madvise((void*)r->map, r->map_size, MADV_RANDOM);
+    return 0;
+}
+
+// Index of the chunk with this type and id, or -1
+static inline long chunk_file_find(const ChunkFileReader* r, uint32_t type, uint64_t id) {
+    for (size_t i = 0; i < r->entry_count; i++) {
+        if (r->entries[i].type == type && r->entries[i].id == id) return (long)i;
+    }
+    return -1;
+}
+
+static inline const ChunkFileEntry* chunk_file_entry(const ChunkFileReader* r, size_t index) {
+    return index < r->entry_count ? &r->entries[index] : NULL;
+}
+
+// Returns 0 when the stored bytes of chunk index match their checksum
+static inline int chunk_file_verify(const ChunkFileReader* r, size_t index) {
+    const ChunkFileEntry* e = chunk_file_entry(r, index);
+    if (!e) return -1;
+    return chunk_file_crc32c(0, r->map + e->offset, (size_t)e->stored_size) == e->crc ? 0 : -1;
+}
+
+/*
+ * Zero-copy view of an uncompressed chunk: a page-aligned pointer into the
+ * read-only mapping, valid until chunk_file_close. Pages are read on first
+ * touch and the checksum is not verified. Returns NULL for compressed
+ * chunks or a bad index.
+ */
+static inline const void* chunk_file_view(const ChunkFileReader* r, size_t index, size_t* size) {
+    const ChunkFileEntry* e = chunk_file_entry(r, index);
+    if (!e || e->compression != CHUNK_COMPRESSION_NONE) return NULL;
+    if (size) *size = (size_t)e->size;
+    madvise((void*)(r->map + e->offset), (size_t)e->stored_size, MADV_WILLNEED);
+    return r->map + e->offset;
+}
+
+/*
+ * Verify and decompress chunk index into dst, which must hold at least
+ * entry->size bytes. Returns 0 on success, -1 on a bad index, small buffer,
+ * checksum mismatch, corrupt data or a codec this build lacks.
+ */
+static inline int chunk_file_read(const ChunkFileReader* r, size_t index, void* dst, size_t capacity) {
+    const ChunkFileEntry* e = chunk_file_entry(r, index);
+    if (!e || capacity < e->size || chunk_file_verify(r, index) != 0) return -1;
+    const unsigned char* src = r->map + e->offset;
+
+    switch (e->compression) {
+    case CHUNK_COMPRESSION_NONE:
+        if (e->stored_size != e->size) return -1;
+        memcpy(dst, src, (size_t)e->size);
+        return 0;
+#ifdef CHUNK_FILE_LZ4
+    case CHUNK_COMPRESSION_LZ4:
+        if (e->size > (uint64_t)LZ4_MAX_INPUT_SIZE) return -1;
+        return LZ4_decompress_safe((const char*)src, (char*)dst, (int)e->stored_size, (int)e->size) == (int)e->size
+                   ? 0
+                   : -1;
+#endif
+#ifdef CHUNK_FILE_ZSTD
+    case CHUNK_COMPRESSION_ZSTD: {
+        size_t result = ZSTD_decompress(dst, (size_t)e->size, src, (size_t)e->stored_size);
+        return !ZSTD_isError(result) && result == e->size ? 0 : -1;
+    }
+#endif
+    default:
+        return -1;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Framework chunks
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Store the patterns of wl (staged or compiled) as a CHUNK_TYPE_WHITELIST
+ * chunk; see mirror_shard_encode. Returns 0 on success, -1 on failure.
+ */
+static inline int chunk_file_add_whitelist(ChunkFileWriter* w, uint64_t id, const char* name,
+                                           const MirrorShardedWhitelist* wl, ChunkCompression compression) {
+    size_t size = mirror_shard_encode(wl, NULL, 0);
+    unsigned char* data = (unsigned char*)malloc(size);
+    if (!data) {
+        w->failed = 1;
+        return -1;
+    }
+    mirror_shard_encode(wl, data, size);
+    int result = chunk_file_add(w, CHUNK_TYPE_WHITELIST, id, name, data, size, compression);
+    free(data);
+    return result;
+}
+
+/*
+ * Stage the patterns of whitelist chunk index into wl, which must be
+ * initialised (with any shard count and pinning) and not yet compiled;
+ * call mirror_shard_compile afterwards. Returns 0 on success, -1 on a bad
+ * index, a chunk of another type, or a chunk that fails to read or decode.
+ */
+static inline int chunk_file_read_whitelist(const ChunkFileReader* r, size_t index, MirrorShardedWhitelist* wl) {
+    const ChunkFileEntry* e = chunk_file_entry(r, index);
+    if (!e || e->type != CHUNK_TYPE_WHITELIST) return -1;
+
+    void* data = malloc(e->size ? (size_t)e->size : 1);
+    if (!data) return -1;
+    int result = chunk_file_read(r, index, data, (size_t)e->size) == 0 &&
+                         mirror_shard_decode(wl, data, (size_t)e->size) == 0
+                     ? 0
+                     : -1;
+    free(data);
+    return result;
+}
+
+#endif // CHUNK_FILE_H
@@ -0,0 +1,312 @@
+#ifndef MIRROR_HPP
+#define MIRROR_HPP
+
+/*
+ * Mirror King - C++17 owners over the C API
+ *
+ * Each class owns one heap-allocated C object through a unique_ptr whose
+ * deleter runs the matching cleanup_* function, so objects are move-only,
+ * moves are noexcept pointer swaps, and cleanup cannot be forgotten. The C
+ * object never moves, which keeps the internal pointers of the C API valid
+ * (shard workers point at their whitelist, streams at their window set).
+ *
+ * Failures that the C API reports with -1 throw mirror::Error; allocation
+ * failures throw std::bad_alloc. A moved-from object may only be destroyed
+ * or assigned to. get() exposes the C object for calls not wrapped here.
+ *
+ * Usage:
+ *   mirror::ShardedWhitelist wl(4);
+ *   wl.add_all(patterns);                         // any range of strings
+ *   wl.compile();
+ *   std::vector<int> hits = wl.lookup(requests);
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "mirror_fuzzy.h"
+#include "mirror_reflect.h"
+#include "mirror_shard.h"
+#include "mirror_stream.h"
+
+namespace mirror {
+
+class Error : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+namespace detail {
+
+inline const char* c_str(const char* s) noexcept { return s; }
+inline const char* c_str(const std::string& s) noexcept { return s.c_str(); }
+
+// C cleanup for each wrapped type
+inline void destroy(MirrorShardedWhitelist* p) noexcept { cleanup_mirror_sharded_whitelist(p); }
+inline void destroy(MirrorFuzzyWhitelist* p) noexcept { cleanup_mirror_fuzzy_whitelist(p); }
+inline void destroy(MirrorSuffixAutomaton* p) noexcept { cleanup_mirror_suffix_automaton(p); }
+inline void destroy(MirrorWindowSet* p) noexcept { cleanup_mirror_window_set(p); }
+inline void destroy(MirrorWindowStream* p) noexcept { cleanup_mirror_window_stream(p); }
+
+// Owning pointer whose deleter runs the C cleanup before freeing the object
+struct Deleter {
+    template <class T>
+    void operator()(T* p) const noexcept {
+        destroy(p);
+        delete p;
+    }
+};
+
+template <class T>
+using Handle = std::unique_ptr<T, Deleter>;
+
+// Zero-initialized, so cleanup is safe even if init fails part way
+template <class T>
+Handle<T> make_handle() {
+    return Handle<T>(new T());
+}
+
+inline void check(int result, const char* what) {
+    if (result != 0) throw Error(what);
+}
+
+}  // namespace detail
+
+// Whitelist of exact patterns, partitioned across pinned shard threads
+class ShardedWhitelist {
+public:
+    explicit ShardedWhitelist(std::size_t shard_count, const int* cpus = nullptr,
+                              const Allocator* allocator = nullptr)
+        : handle_(detail::make_handle<MirrorShardedWhitelist>()) {
+        detail::check(init_mirror_sharded_whitelist(handle_.get(), shard_count, cpus, allocator),
+                      "mirror: invalid shard count or allocation failure");
+    }
+
+    ShardedWhitelist(ShardedWhitelist&&) noexcept = default;
+    ShardedWhitelist& operator=(ShardedWhitelist&&) noexcept = default;
+
+    void add(const char* pattern) {
+        detail::check(mirror_shard_add(handle_.get(), pattern), "mirror: add after compile or allocation failure");
+    }
+    void add(const std::string& pattern) { add(pattern.c_str()); }
+
+    template <class Range>
+    void add_all(const Range& patterns) {
+        for (const auto& pattern : patterns) add(detail::c_str(pattern));
+    }
+
+    void compile() { detail::check(mirror_shard_compile(handle_.get()), "mirror: shard compile failed"); }
+
+    bool compiled() const noexcept { return handle_->compiled != 0; }
+
+    // results[i] is 1 when inputs[i] is whitelisted
+    void lookup(const char* const* inputs, std::size_t count, int* results) {
+        detail::check(mirror_shard_lookup_batch(handle_.get(), inputs, count, results),
+                      "mirror: lookup before compile or allocation failure");
+    }
+
+    template <class Range>
+    std::vector<int> lookup(const Range& inputs) {
+        std::vector<const char*> pointers;
+        for (const auto& input : inputs) pointers.push_back(detail::c_str(input));
+        std::vector<int> results(pointers.size());
+        lookup(pointers.data(), pointers.size(), results.data());
+        return results;
+    }
+
+    MirrorShardedWhitelist* get() noexcept { return handle_.get(); }
+    const MirrorShardedWhitelist* get() const noexcept { return handle_.get(); }
+
+private:
+    detail::Handle<MirrorShardedWhitelist> handle_;
+};
+
+// Membership within an edit distance
+class FuzzyWhitelist {
+public:
+    struct Match {
+        std::size_t index;
+        std::size_t distance;
+        std::string_view pattern;   // Valid while the whitelist is unchanged
+    };
+
+    explicit FuzzyWhitelist(const Allocator* allocator = nullptr)
+        : handle_(detail::make_handle<MirrorFuzzyWhitelist>()) {
+        init_mirror_fuzzy_whitelist(handle_.get(), allocator);
+    }
+
+    FuzzyWhitelist(FuzzyWhitelist&&) noexcept = default;
+    FuzzyWhitelist& operator=(FuzzyWhitelist&&) noexcept = default;
+
+    void add(const char* pattern) {
+        if (mirror_fuzzy_add(handle_.get(), pattern) != 0) throw std::bad_alloc();
+    }
+    void add(const std::string& pattern) { add(pattern.c_str()); }
+
+    template <class Range>
+    void add_all(const Range& patterns) {
+        for (const auto& pattern : patterns) add(detail::c_str(pattern));
+    }
+
+    std::size_t size() const noexcept { return handle_->node_count; }
+
+    std::optional<Match> best(const char* input, std::size_t k) const {
+        std::size_t index = 0, distance = 0;
+        int found = mirror_fuzzy_best(handle_.get(), input, k, &index, &distance);
+        if (found < 0) throw std::bad_alloc();
+        if (!found) return std::nullopt;
+        return Match{ index, distance, mirror_fuzzy_pattern(handle_.get(), index) };
+    }
+    std::optional<Match> best(const std::string& input, std::size_t k) const { return best(input.c_str(), k); }
+
+    bool contains(const char* input, std::size_t k) const { return best(input, k).has_value(); }
+    bool contains(const std::string& input, std::size_t k) const { return contains(input.c_str(), k); }
+
+    template <class Range>
+    std::vector<int> contains_all(const Range& inputs, std::size_t k) const {
+        std::vector<int> results;
+        for (const auto& input : inputs) results.push_back(contains(detail::c_str(input), k));
+        return results;
+    }
+
+    MirrorFuzzyWhitelist* get() noexcept { return handle_.get(); }
+    const MirrorFuzzyWhitelist* get() const noexcept { return handle_.get(); }
+
+private:
+    detail::Handle<MirrorFuzzyWhitelist> handle_;
+};
+
+// Substring index over one corpus
+class SuffixAutomaton {
+public:
+    explicit SuffixAutomaton(std::string_view corpus, const Allocator* allocator = nullptr)
+        : handle_(detail::make_handle<MirrorSuffixAutomaton>()) {
+        if (init_mirror_suffix_automaton(handle_.get(), corpus.size(), allocator) != 0 ||
+            mirror_sam_build(handle_.get(), corpus.data(), corpus.size()) != 0) {
+            throw std::bad_alloc();
+        }
+    }
+
+    SuffixAutomaton(SuffixAutomaton&&) noexcept = default;
+    SuffixAutomaton& operator=(SuffixAutomaton&&) noexcept = default;
+
+    std::size_t count(std::string_view pattern) const noexcept {
+        return mirror_sam_count(handle_.get(), pattern.data(), pattern.size());
+    }
+
+    template <class Range>
+    std::vector<std::size_t> count_all(const Range& patterns) const {
+        std::vector<std::size_t> counts;
+        for (const auto& pattern : patterns) counts.push_back(count(std::string_view(pattern)));
+        return counts;
+    }
+
+    MirrorReflection longest_repeat() const noexcept {
+        MirrorReflection out;
+        mirror_sam_longest_repeat(handle_.get(), &out);
+        return out;
+    }
+
+    MirrorSuffixAutomaton* get() noexcept { return handle_.get(); }
+    const MirrorSuffixAutomaton* get() const noexcept { return handle_.get(); }
+
+private:
+    detail::Handle<MirrorSuffixAutomaton> handle_;
+};
+
+// Fixed-width patterns for stream matching
+class WindowSet {
+public:
+    explicit WindowSet(std::size_t width, const Allocator* allocator = nullptr)
+        : handle_(detail::make_handle<MirrorWindowSet>()) {
+        detail::check(init_mirror_window_set(handle_.get(), width, allocator), "mirror: window width must be > 0");
+    }
+
+    WindowSet(WindowSet&&) noexcept = default;
+    WindowSet& operator=(WindowSet&&) noexcept = default;
+
+    // Index of the pattern; duplicates return the existing index
+    std::size_t add(std::string_view pattern) {
+        if (pattern.size() != width()) throw Error("mirror: pattern length differs from window width");
+        long index = mirror_window_add(handle_.get(), pattern.data(), pattern.size());
+        if (index < 0) throw std::bad_alloc();
+        return static_cast<std::size_t>(index);
+    }
+
+    template <class Range>
+    void add_all(const Range& patterns) {
+        for (const auto& pattern : patterns) add(std::string_view(pattern));
+    }
+
+    std::size_t width() const noexcept { return handle_->width; }
+    std::size_t size() const noexcept { return handle_->entry_count; }
+
+    std::string_view pattern(std::size_t index) const noexcept {
+        const unsigned char* bytes = mirror_window_pattern(handle_.get(), index);
+        return bytes ? std::string_view(reinterpret_cast<const char*>(bytes), width()) : std::string_view();
+    }
+
+    MirrorWindowSet* get() noexcept { return handle_.get(); }
+    const MirrorWindowSet* get() const noexcept { return handle_.get(); }
+
+private:
+    detail::Handle<MirrorWindowSet> handle_;
+};
+
+/*
+ * Matching state over one byte stream. Refers to the set's C object, which
+ * stays put when the WindowSet is moved; the set must outlive the stream
+ * and must not gain patterns while the stream is in use.
+ */
+class WindowStream {
+public:
+    explicit WindowStream(const WindowSet& set)
+        : handle_(detail::make_handle<MirrorWindowStream>()) {
+        if (init_mirror_window_stream(handle_.get(), set.get()) != 0) throw std::bad_alloc();
+    }
+
+    WindowStream(WindowStream&&) noexcept = default;
+    WindowStream& operator=(WindowStream&&) noexcept = default;
+
+    // Number of matches in this chunk
+    std::size_t feed(std::string_view chunk) noexcept {
+        return mirror_window_feed(handle_.get(), chunk.data(), chunk.size(), nullptr, nullptr);
+    }
+
+    // on_match(stream_offset, pattern_index) for every match in this chunk
+    template <class F>
+    std::size_t feed(std::string_view chunk, F&& on_match) {
+        auto trampoline = [](uint64_t offset, std::size_t index, void* user_data) {
+            (*static_cast<std::remove_reference_t<F>*>(user_data))(offset, index);
+        };
+        return mirror_window_feed(handle_.get(), chunk.data(), chunk.size(), trampoline, &on_match);
+    }
+
+    void reset() noexcept { mirror_window_reset(handle_.get()); }
+    uint64_t offset() const noexcept { return handle_->offset; }
+
+    MirrorWindowStream* get() noexcept { return handle_.get(); }
+    const MirrorWindowStream* get() const noexcept { return handle_.get(); }
+
+private:
+    detail::Handle<MirrorWindowStream> handle_;
+};
+
+inline std::optional<MirrorReflection> longest_palindrome(std::string_view text) {
+    MirrorReflection out;
+    if (mirror_longest_palindrome(text.data(), text.size(), &out) != 0) throw std::bad_alloc();
+    if (out.length == 0) return std::nullopt;
+    return out;
+}
+
+}  // namespace mirror
+
+#endif // MIRROR_HPP
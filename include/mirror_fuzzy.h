@@ -0,0 +1,310 @@
+#ifndef MIRROR_FUZZY_H
+#define MIRROR_FUZZY_H
+
+/*
+ * Mirror King - approximate whitelist membership
+ *
+ * Answers "is this input within edit distance k of some whitelist entry?"
+ * without expanding typo variants into the whitelist itself.
+ *
+ * Candidates are generated by a BK-tree over the Levenshtein metric and each
+ * candidate distance is computed with Myers' bit-parallel algorithm (one
+ * 64-bit word per text byte for queries up to 64 bytes, a two-row dynamic
+ * program beyond that). The BK-tree only prunes subtrees the triangle
+ * inequality proves to be out of range, so results are exact for any k.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "allocator.h"
+
+#define MIRROR_FUZZY_NONE        UINT32_MAX
+#define MIRROR_FUZZY_WORD_BITS   64
+
+// Precomputed match masks for one query string
+typedef struct {
+    uint64_t peq[256];
+    const unsigned char* text;
+    size_t length;
+} MirrorMyersPattern;
+
+typedef struct {
+    uint32_t offset;        // Offset of the pattern in the string arena
+    uint32_t length;
+    uint32_t distance;      // Edge label: distance to parent
+    uint32_t first_child;
+    uint32_t next_sibling;
+} MirrorBKNode;
+
+typedef struct {
+    MirrorBKNode* nodes;
+    size_t node_count;
+    size_t node_capacity;
+
+    char* arena;            // NUL-terminated patterns, back to back
+    size_t arena_size;
+    size_t arena_capacity;
+
+    const Allocator* allocator;
+} MirrorFuzzyWhitelist;
+
+// Prepare a query for repeated bit-parallel distance computations
+static inline void mirror_myers_prepare(MirrorMyersPattern* pattern, const char* text, size_t length) {
+    memset(pattern->peq, 0, sizeof(pattern->peq));
+    pattern->text = (const unsigned char*)text;
+    pattern->length = length;
+
+    if (length > MIRROR_FUZZY_WORD_BITS) return;
+
+    for (size_t i = 0; i < length; i++) {
+        pattern->peq[pattern->text[i]] |= (uint64_t)1 << i;
+    }
+}
+
+// Plain two-row Levenshtein distance, used when the query exceeds one word
+static inline size_t mirror_edit_distance_dp(const unsigned char* a, size_t alen,
+                                             const unsigned char* b, size_t blen) {
+    size_t* row = (size_t*)malloc((alen + 1) * sizeof(size_t));
+    if (!row) return (size_t)-1;
+
+    for (size_t i = 0; i <= alen; i++) row[i] = i;
+
+    for (size_t j = 1; j <= blen; j++) {
+        size_t diag = row[0];
+        row[0] = j;
+        for (size_t i = 1; i <= alen; i++) {
+            size_t up = row[i];
+            size_t best = diag + (a[i - 1] != b[j - 1]);
+            if (up + 1 < best) best = up + 1;
+            if (row[i - 1] + 1 < best) best = row[i - 1] + 1;
+            row[i] = best;
+            diag = up;
+        }
+    }
+
+    size_t result = row[alen];
+    free(row);
+    return result;
+}
+
+// Global edit distance between a prepared query and a candidate
+static inline size_t mirror_myers_distance(const MirrorMyersPattern* pattern, const char* text, size_t length) {
+    size_t m = pattern->length;
+    const unsigned char* t = (const unsigned char*)text;
+
+    if (m == 0) return length;
+    if (m > MIRROR_FUZZY_WORD_BITS) {
+        return mirror_edit_distance_dp(pattern->text, m, t, length);
+    }
+
+    uint64_t mask = (m == MIRROR_FUZZY_WORD_BITS) ? ~(uint64_t)0 : (((uint64_t)1 << m) - 1);
+    uint64_t last = (uint64_t)1 << (m - 1);
+    uint64_t pv = mask;
+    uint64_t mv = 0;
+    size_t score = m;
+
+    for (size_t j = 0; j < length; j++) {
+        uint64_t eq = pattern->peq[t[j]];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        if (ph & last) score++;
+        else if (mh & last) score--;
+
+        // Row 0 grows by one per text byte, hence the carried-in 1
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = (mh | ~(xv | ph)) & mask;
+        mv = ph & xv;
+    }
+
+    return score;
+}
+
+// Convenience wrapper for one-off distance queries
+static inline size_t mirror_edit_distance(const char* a, size_t alen, const char* b, size_t blen) {
+    MirrorMyersPattern pattern;
+    if (alen < blen && blen <= MIRROR_FUZZY_WORD_BITS) {
+        mirror_myers_prepare(&pattern, b, blen);
+        return mirror_myers_distance(&pattern, a, alen);
+    }
+    mirror_myers_prepare(&pattern, a, alen);
+    return mirror_myers_distance(&pattern, b, blen);
+}
+
+// allocator may be NULL for the C library
+static inline void init_mirror_fuzzy_whitelist(MirrorFuzzyWhitelist* wl, const Allocator* allocator) {
+    memset(wl, 0, sizeof(*wl));
+    wl->allocator = allocator;
+}
+
+static inline void cleanup_mirror_fuzzy_whitelist(MirrorFuzzyWhitelist* wl) {
+    allocator_free(wl->allocator, wl->nodes);
+    allocator_free(wl->allocator, wl->arena);
+    memset(wl, 0, sizeof(*wl));
+}
+
+static inline const char* mirror_fuzzy_pattern(const MirrorFuzzyWhitelist* wl, size_t index) {
+    if (index >= wl->node_count) return NULL;
+    return wl->arena + wl->nodes[index].offset;
+}
+
+static inline int mirror_fuzzy_append_node(MirrorFuzzyWhitelist* wl, const char* pattern, size_t length,
+                                           uint32_t distance) {
+    if (wl->node_count == wl->node_capacity) {
+        size_t capacity = wl->node_capacity ? wl->node_capacity * 2 : 64;
+        MirrorBKNode* nodes = (MirrorBKNode*)allocator_realloc(wl->allocator, wl->nodes,
+                                                               capacity * sizeof(MirrorBKNode));
+        if (!nodes) return -1;
+        wl->nodes = nodes;
+        wl->node_capacity = capacity;
+    }
+
+    if (wl->arena_size + length + 1 > wl->arena_capacity) {
+        size_t capacity = wl->arena_capacity ? wl->arena_capacity : 1024;
+        while (capacity < wl->arena_size + length + 1) capacity *= 2;
+        char* arena = (char*)allocator_realloc(wl->allocator, wl->arena, capacity);
+        if (!arena) return -1;
+        wl->arena = arena;
+        wl->arena_capacity = capacity;
+    }
+
+    if (wl->arena_size + length + 1 > UINT32_MAX) return -1;
+
+    MirrorBKNode* node = &wl->nodes[wl->node_count++];
+    node->offset = (uint32_t)wl->arena_size;
+    node->length = (uint32_t)length;
+    node->distance = distance;
+    node->first_child = MIRROR_FUZZY_NONE;
+    node->next_sibling = MIRROR_FUZZY_NONE;
+
+    memcpy(wl->arena + wl->arena_size, pattern, length);
+    wl->arena[wl->arena_size + length] = '\0';
+    wl->arena_size += length + 1;
+    return 0;
+}
+
+// Add a pattern; duplicates are ignored. Returns 0 on success, -1 on allocation failure
+static inline int mirror_fuzzy_add(MirrorFuzzyWhitelist* wl, const char* pattern) {
+    size_t length = strlen(pattern);
+
+    if (wl->node_count == 0) {
+        return mirror_fuzzy_append_node(wl, pattern, length, 0);
+    }
+
+    MirrorMyersPattern query;
+    mirror_myers_prepare(&query, pattern, length);
+
+    uint32_t current = 0;
+    for (;;) {
+        MirrorBKNode* node = &wl->nodes[current];
+        size_t d = mirror_myers_distance(&query, wl->arena + node->offset, node->length);
+        if (d == 0) return 0;
+        if (d == (size_t)-1) return -1;
+
+        uint32_t child = node->first_child;
+        while (child != MIRROR_FUZZY_NONE && wl->nodes[child].distance != d) {
+            child = wl->nodes[child].next_sibling;
+        }
+
+        if (child != MIRROR_FUZZY_NONE) {
+            current = child;
+            continue;
+        }
+
+        uint32_t index = (uint32_t)wl->node_count;
+        if (mirror_fuzzy_append_node(wl, pattern, length, (uint32_t)d) != 0) return -1;
+
+        // Append may have moved the node array
+        node = &wl->nodes[current];
+        wl->nodes[index].next_sibling = node->first_child;
+        node->first_child = index;
+        return 0;
+    }
+}
+
+/*
+ * Find the closest whitelist entry within distance k.
+ * Returns 1 and fills index/distance when found, 0 when nothing is in range,
+ * -1 on allocation failure. Ties resolve to the entry found first.
+ */
+static inline int mirror_fuzzy_best(const MirrorFuzzyWhitelist* wl, const char* input, size_t k,
+                                    size_t* index, size_t* distance) {
+    if (wl->node_count == 0) return 0;
+
+    size_t length = strlen(input);
+    MirrorMyersPattern query;
+    mirror_myers_prepare(&query, input, length);
+
+    size_t stack_capacity = 64;
+    size_t stack_size = 0;
+    uint32_t* stack = (uint32_t*)allocator_alloc(wl->allocator, stack_capacity * sizeof(uint32_t));
+    if (!stack) return -1;
+    stack[stack_size++] = 0;
+
+    int found = 0;
+    size_t best_distance = k + 1;
+    size_t best_index = 0;
+
+    while (stack_size > 0) {
+        const MirrorBKNode* node = &wl->nodes[stack[--stack_size]];
+        size_t node_index = (size_t)(node - wl->nodes);
+
+        size_t d = mirror_myers_distance(&query, wl->arena + node->offset, node->length);
+        if (d == (size_t)-1) {
+            allocator_free(wl->allocator, stack);
+            return -1;
+        }
+
+        if (d < best_distance) {
+            best_distance = d;
+            best_index = node_index;
+            found = 1;
+            if (d == 0) break;
+        }
+
+        // Only children with |edge - d| <= k can hold an entry within k
+        size_t radius = best_distance < k ? best_distance : k;
+        size_t low = d > radius ? d - radius : 0;
+        size_t high = d + radius;
+
+        for (uint32_t child = node->first_child; child != MIRROR_FUZZY_NONE;
+             child = wl->nodes[child].next_sibling) {
+            uint32_t edge = wl->nodes[child].distance;
+            if (edge < low || edge > high) continue;
+
+            if (stack_size == stack_capacity) {
+                stack_capacity *= 2;
+                uint32_t* grown = (uint32_t*)allocator_realloc(wl->allocator, stack, stack_capacity * sizeof(uint32_t));
+                if (!grown) {
+                    allocator_free(wl->allocator, stack);
+                    return -1;
+                }
+                stack = grown;
+            }
+            stack[stack_size++] = child;
+        }
+    }
+
+    allocator_free(wl->allocator, stack);
+
+    if (found) {
+        if (index) *index = best_index;
+        if (distance) *distance = best_distance;
+    }
+    return found;
+}
+
+// Membership within edit distance k: 1 if present, 0 if not, -1 on error
+static inline int mirror_fuzzy_contains(const MirrorFuzzyWhitelist* wl, const char* input, size_t k) {
+    return mirror_fuzzy_best(wl, input, k, NULL, NULL);
+}
+
+#endif // MIRROR_FUZZY_H
@@ -0,0 +1,420 @@
+#ifndef MIRROR_REFLECT_H
+#define MIRROR_REFLECT_H
+
+/*
+ * Mirror King - linear-time pattern reflection
+ *
+ * Two complementary detectors:
+ *   - Mirrored structure: Manacher's algorithm yields the maximal palindrome
+ *     around every centre of an input in O(n).
+ *   - Repeated structure: a suffix automaton built over the corpus in O(n)
+ *     answers occurrence counts, the longest repeat, and matching statistics
+ *     of an input against the corpus (forwards, or backwards to find
+ *     reflected copies) in time linear in the input.
+ *
+ * No input needs to be truncated; memory is O(n) for both.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "allocator.h"
+
+#define MIRROR_SAM_NONE (-1)
+
+typedef struct {
+    int32_t len;            // Longest string in this endpos class
+    int32_t link;           // Suffix link
+    int32_t first_edge;
+    int32_t first_end;      // End position of the first occurrence
+    int32_t occurrences;    // |endpos|, valid after mirror_sam_finalize
+    int32_t is_clone;
+} MirrorSAMState;
+
+typedef struct {
+    int32_t target;
+    int32_t next;
+    unsigned char byte;
+} MirrorSAMEdge;
+
+typedef struct {
+    MirrorSAMState* states;
+    size_t state_count;
+    size_t state_capacity;
+
+    MirrorSAMEdge* edges;
+    size_t edge_count;
+    size_t edge_capacity;
+
+    int32_t last;
+    size_t length;
+    int finalized;
+
+    const Allocator* allocator;
+} MirrorSuffixAutomaton;
+
+// A mirrored or repeated span of an input
+typedef struct {
+    size_t start;
+    size_t length;
+} MirrorReflection;
+
+typedef void (*MirrorReflectionCallback)(const MirrorReflection* reflection, void* user_data);
+
+/* ---------------------------------------------------------------------------
+ * Manacher palindrome detection
+ * ------------------------------------------------------------------------- */
+
+/*
+ * odd[i]:  radius of the longest odd palindrome centred on i (length 2*odd[i]-1)
+ * even[i]: radius of the longest even palindrome whose right half starts at i
+ *          (length 2*even[i])
+ * Both outputs are caller storage of n entries.
+ */
+static inline void mirror_manacher(const char* text, size_t n, size_t* odd, size_t* even) {
+    const unsigned char* s = (const unsigned char*)text;
+
+    // Odd-length palindromes
+    size_t l = 0, r = 0;    // Rightmost palindrome is [l, r)
+    for (size_t i = 0; i < n; i++) {
+        size_t k = 1;
+        if (i < r) {
+            size_t mirror = odd[l + r - 1 - i];
+            k = mirror < r - i ? mirror : r - i;
+        }
+        while (i + k < n && i >= k && s[i - k] == s[i + k]) k++;
+        odd[i] = k;
+        if (i + k > r) {
+            l = i + 1 - k;
+            r = i + k;
+        }
+    }
+
+    // Even-length palindromes
+    l = 0;
+    r = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t k = 0;
+        if (i < r) {
+            size_t mirror = even[l + r - i];
+            k = mirror < r - i ? mirror : r - i;
+        }
+        while (i + k < n && i >= k + 1 && s[i - k - 1] == s[i + k]) k++;
+        even[i] = k;
+        if (i + k > r) {
+            l = i - k;
+            r = i + k;
+        }
+    }
+}
+
+/*
+ * Report the maximal palindrome at every centre whose length is at least
+ * min_length. Returns the number reported, or (size_t)-1 on allocation failure.
+ */
+static inline size_t mirror_for_each_palindrome(const char* text, size_t n, size_t min_length,
+                                                MirrorReflectionCallback callback, void* user_data) {
+    if (n == 0) return 0;
+
+    size_t* odd = (size_t*)malloc(2 * n * sizeof(size_t));
+    if (!odd) return (size_t)-1;
+    size_t* even = odd + n;
+    mirror_manacher(text, n, odd, even);
+
+    size_t reported = 0;
+    for (size_t i = 0; i < n; i++) {
+        MirrorReflection reflection;
+
+        reflection.length = 2 * odd[i] - 1;
+        if (reflection.length >= min_length) {
+            reflection.start = i + 1 - odd[i];
+            if (callback) callback(&reflection, user_data);
+            reported++;
+        }
+
+        reflection.length = 2 * even[i];
+        if (reflection.length > 0 && reflection.length >= min_length) {
+            reflection.start = i - even[i];
+            if (callback) callback(&reflection, user_data);
+            reported++;
+        }
+    }
+
+    free(odd);
+    return reported;
+}
+
+// Longest palindromic substring. Returns 0 on success, -1 on allocation failure
+static inline int mirror_longest_palindrome(const char* text, size_t n, MirrorReflection* out) {
+    out->start = 0;
+    out->length = 0;
+    if (n == 0) return 0;
+
+    size_t* odd = (size_t*)malloc(2 * n * sizeof(size_t));
+    if (!odd) return -1;
+    size_t* even = odd + n;
+    mirror_manacher(text, n, odd, even);
+
+    for (size_t i = 0; i < n; i++) {
+        if (2 * odd[i] - 1 > out->length) {
+            out->length = 2 * odd[i] - 1;
+            out->start = i + 1 - odd[i];
+        }
+        if (2 * even[i] > out->length) {
+            out->length = 2 * even[i];
+            out->start = i - even[i];
+        }
+    }
+
+    free(odd);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Suffix automaton over the corpus
+ * ------------------------------------------------------------------------- */
+
+static inline int32_t mirror_sam_new_state(MirrorSuffixAutomaton* sam, int32_t len) {
+    if (sam->state_count >= (size_t)INT32_MAX) return MIRROR_SAM_NONE;
+    if (sam->state_count == sam->state_capacity) {
+        size_t capacity = sam->state_capacity ? sam->state_capacity * 2 : 64;
+        MirrorSAMState* states = (MirrorSAMState*)allocator_realloc(sam->allocator, sam->states,
+                                                                    capacity * sizeof(MirrorSAMState));
+        if (!states) return MIRROR_SAM_NONE;
+        sam->states = states;
+        sam->state_capacity = capacity;
+    }
+
+    MirrorSAMState* state = &sam->states[sam->state_count];
+    state->len = len;
+    state->link = MIRROR_SAM_NONE;
+    state->first_edge = MIRROR_SAM_NONE;
+    state->first_end = MIRROR_SAM_NONE;
+    state->occurrences = 0;
+    state->is_clone = 0;
+    return (int32_t)sam->state_count++;
+}
+
+static inline int32_t mirror_sam_find_edge(const MirrorSuffixAutomaton* sam, int32_t state, unsigned char byte) {
+    for (int32_t e = sam->states[state].first_edge; e != MIRROR_SAM_NONE; e = sam->edges[e].next) {
+        if (sam->edges[e].byte == byte) return e;
+    }
+    return MIRROR_SAM_NONE;
+}
+
+static inline int mirror_sam_add_edge(MirrorSuffixAutomaton* sam, int32_t from, unsigned char byte, int32_t to) {
+    // Up to 3n edges against 2n states, so the edge index runs out first
+    if (sam->edge_count >= (size_t)INT32_MAX) return -1;
+    if (sam->edge_count == sam->edge_capacity) {
+        size_t capacity = sam->edge_capacity ? sam->edge_capacity * 2 : 128;
+        MirrorSAMEdge* edges = (MirrorSAMEdge*)allocator_realloc(sam->allocator, sam->edges,
+                                                                 capacity * sizeof(MirrorSAMEdge));
+        if (!edges) return -1;
+        sam->edges = edges;
+        sam->edge_capacity = capacity;
+    }
+
+    MirrorSAMEdge* edge = &sam->edges[sam->edge_count];
+    edge->byte = byte;
+    edge->target = to;
+    edge->next = sam->states[from].first_edge;
+    sam->states[from].first_edge = (int32_t)sam->edge_count++;
+    return 0;
+}
+
+// allocator may be NULL for the C library. Returns 0 on success, -1 on allocation failure
+static inline int init_mirror_suffix_automaton(MirrorSuffixAutomaton* sam, size_t expected_length,
+                                               const Allocator* allocator) {
+    memset(sam, 0, sizeof(*sam));
+    sam->allocator = allocator;
+
+    // A suffix automaton has at most 2n states and 3n transitions
+    if (expected_length > 0) {
+        sam->states = (MirrorSAMState*)allocator_alloc(allocator, 2 * expected_length * sizeof(MirrorSAMState));
+        sam->edges = (MirrorSAMEdge*)allocator_alloc(allocator, 3 * expected_length * sizeof(MirrorSAMEdge));
+        if (!sam->states || !sam->edges) {
+            allocator_free(allocator, sam->states);
+            allocator_free(allocator, sam->edges);
+            memset(sam, 0, sizeof(*sam));
+            return -1;
+        }
+        sam->state_capacity = 2 * expected_length;
+        sam->edge_capacity = 3 * expected_length;
+    }
+
+    sam->last = mirror_sam_new_state(sam, 0);
+    return sam->last == MIRROR_SAM_NONE ? -1 : 0;
+}
+
+static inline void cleanup_mirror_suffix_automaton(MirrorSuffixAutomaton* sam) {
+    allocator_free(sam->allocator, sam->states);
+    allocator_free(sam->allocator, sam->edges);
+    memset(sam, 0, sizeof(*sam));
+}
+
+// Append one byte to the corpus (amortised O(1)). Returns 0 on success, -1 on failure
+static inline int mirror_sam_extend(MirrorSuffixAutomaton* sam, unsigned char byte) {
+    if (sam->length >= INT32_MAX / 3) return -1;
+
+    int32_t cur = mirror_sam_new_state(sam, sam->states[sam->last].len + 1);
+    if (cur == MIRROR_SAM_NONE) return -1;
+    sam->states[cur].first_end = (int32_t)sam->length;
+    sam->states[cur].occurrences = 1;
+
+    int32_t p = sam->last;
+    while (p != MIRROR_SAM_NONE && mirror_sam_find_edge(sam, p, byte) == MIRROR_SAM_NONE) {
+        if (mirror_sam_add_edge(sam, p, byte, cur) != 0) return -1;
+        p = sam->states[p].link;
+    }
+
+    if (p == MIRROR_SAM_NONE) {
+        sam->states[cur].link = 0;
+    } else {
+        int32_t q = sam->edges[mirror_sam_find_edge(sam, p, byte)].target;
+        if (sam->states[p].len + 1 == sam->states[q].len) {
+            sam->states[cur].link = q;
+        } else {
+            int32_t clone = mirror_sam_new_state(sam, sam->states[p].len + 1);
+            if (clone == MIRROR_SAM_NONE) return -1;
+            sam->states[clone].link = sam->states[q].link;
+            sam->states[clone].first_end = sam->states[q].first_end;
+            sam->states[clone].is_clone = 1;
+
+            for (int32_t e = sam->states[q].first_edge; e != MIRROR_SAM_NONE; e = sam->edges[e].next) {
+                if (mirror_sam_add_edge(sam, clone, sam->edges[e].byte, sam->edges[e].target) != 0) return -1;
+            }
+
+            int32_t e;
+            while (p != MIRROR_SAM_NONE && (e = mirror_sam_find_edge(sam, p, byte)) != MIRROR_SAM_NONE &&
+                   sam->edges[e].target == q) {
+                sam->edges[e].target = clone;
+                p = sam->states[p].link;
+            }
+            sam->states[q].link = clone;
+            sam->states[cur].link = clone;
+        }
+    }
+
+    sam->last = cur;
+    sam->length++;
+    sam->finalized = 0;
+    return 0;
+}
+
+// Propagate occurrence counts along suffix links (counting sort by len, O(n))
+static inline int mirror_sam_finalize(MirrorSuffixAutomaton* sam) {
+    size_t n = sam->state_count;
+    size_t* bucket = (size_t*)allocator_calloc(sam->allocator, sam->length + 1, sizeof(size_t));
+    int32_t* order = (int32_t*)allocator_alloc(sam->allocator, n * sizeof(int32_t));
+    if (!bucket || !order) {
+        allocator_free(sam->allocator, bucket);
+        allocator_free(sam->allocator, order);
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        MirrorSAMState* state = &sam->states[i];
+        state->occurrences = (i > 0 && !state->is_clone) ? 1 : 0;
+        bucket[state->len]++;
+    }
+    for (size_t i = 1; i <= sam->length; i++) bucket[i] += bucket[i - 1];
+    for (size_t i = n; i-- > 0;) order[--bucket[sam->states[i].len]] = (int32_t)i;
+
+    for (size_t i = n; i-- > 1;) {
+        MirrorSAMState* state = &sam->states[order[i]];
+        if (state->link != MIRROR_SAM_NONE) {
+            sam->states[state->link].occurrences += state->occurrences;
+        }
+    }
+
+    allocator_free(sam->allocator, bucket);
+    allocator_free(sam->allocator, order);
+    sam->finalized = 1;
+    return 0;
+}
+
+// Build over a whole corpus. Returns 0 on success, -1 on allocation failure
+static inline int mirror_sam_build(MirrorSuffixAutomaton* sam, const char* corpus, size_t n) {
+    const unsigned char* s = (const unsigned char*)corpus;
+    for (size_t i = 0; i < n; i++) {
+        if (mirror_sam_extend(sam, s[i]) != 0) return -1;
+    }
+    return mirror_sam_finalize(sam);
+}
+
+// Number of occurrences of pattern in the corpus, O(|pattern|)
+static inline size_t mirror_sam_count(const MirrorSuffixAutomaton* sam, const char* pattern, size_t n) {
+    const unsigned char* s = (const unsigned char*)pattern;
+    int32_t state = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        int32_t e = mirror_sam_find_edge(sam, state, s[i]);
+        if (e == MIRROR_SAM_NONE) return 0;
+        state = sam->edges[e].target;
+    }
+
+    if (n == 0) return 0;
+    return sam->finalized ? (size_t)sam->states[state].occurrences : 1;
+}
+
+// Longest substring occurring at least twice in the corpus (requires finalize)
+static inline void mirror_sam_longest_repeat(const MirrorSuffixAutomaton* sam, MirrorReflection* out) {
+    out->start = 0;
+    out->length = 0;
+
+    for (size_t i = 1; i < sam->state_count; i++) {
+        const MirrorSAMState* state = &sam->states[i];
+        if (state->occurrences >= 2 && (size_t)state->len > out->length) {
+            out->length = (size_t)state->len;
+            out->start = (size_t)state->first_end + 1 - out->length;
+        }
+    }
+}
+
+/*
+ * Matching statistics of text against the corpus in O(|text|).
+ *
+ * Forward: lengths[i] is the longest substring of text ending at i that occurs
+ * in the corpus. Reversed: text is read right to left, so lengths[i] is the
+ * longest substring starting at i whose mirror image occurs in the corpus.
+ * lengths may be NULL. The longest match in text is returned through out.
+ */
+static inline void mirror_sam_match(const MirrorSuffixAutomaton* sam, const char* text, size_t n,
+                                    int reversed, size_t* lengths, MirrorReflection* out) {
+    const unsigned char* s = (const unsigned char*)text;
+    int32_t state = 0;
+    size_t length = 0;
+
+    out->start = 0;
+    out->length = 0;
+
+    for (size_t step = 0; step < n; step++) {
+        size_t i = reversed ? n - 1 - step : step;
+        int32_t e;
+
+        while (state != 0 && (e = mirror_sam_find_edge(sam, state, s[i])) == MIRROR_SAM_NONE) {
+            state = sam->states[state].link;
+            length = (size_t)sam->states[state].len;
+        }
+
+        e = mirror_sam_find_edge(sam, state, s[i]);
+        if (e != MIRROR_SAM_NONE) {
+            state = sam->edges[e].target;
+            length++;
+        } else {
+            length = 0;
+        }
+
+        if (lengths) lengths[i] = length;
+        if (length > out->length) {
+            out->length = length;
+            out->start = reversed ? i : i + 1 - length;
+        }
+    }
+}
+
+#endif // MIRROR_REFLECT_H
@@ -0,0 +1,555 @@
+#ifndef MIRROR_SHARD_H
+#define MIRROR_SHARD_H
+
+/*
+ * Mirror King - shared-nothing, hash-sharded whitelist lookups
+ *
+ * A compiled whitelist is partitioned into N shards by input hash. Each shard
+ * is owned by one worker thread pinned to its own core; the worker builds its
+ * shard's hash table itself after pinning, so first-touch page placement puts
+ * the table on that core's NUMA node. Lookups are routed in batches to the
+ * owning shard through a per-shard queue, so no read-mostly structure is
+ * shared across sockets.
+ *
+ * Usage:
+ *   init_mirror_sharded_whitelist(&wl, 4, NULL, NULL);
+ *   mirror_shard_add(&wl, "pattern"); ...
+ *   mirror_shard_compile(&wl);
+ *   mirror_shard_lookup_batch(&wl, inputs, count, results);
+ *   cleanup_mirror_sharded_whitelist(&wl);
+ *
+ * mirror_shard_encode / mirror_shard_decode carry the pattern set to another
+ * whitelist or process (chunk_file.h stores it as a CHUNK_TYPE_WHITELIST
+ * chunk); the tables themselves are rebuilt by compile on the loading side.
+ *
+ * The queue and batch locks are WisdomMutex, so building with
+ * -DWISDOM_LOCK_PROFILE reports their contention in wisdom_lock_report.
+ *
+ * Hashing a large batch, the part the caller would otherwise do alone before
+ * routing, runs on the shared task pool (task_pool.h).
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "allocator.h"
+#include "O_wisdom_lock.h"
+#include "task_pool.h"
+
+#define MIRROR_SHARD_MAX 256
+
+typedef struct {
+    uint64_t hash;
+    uint32_t offset;
+    uint32_t length;
+} MirrorShardEntry;
+
+// Completion tracking for one routed batch
+typedef struct {
+    WisdomMutex* lock;          // The whitelist's batch_lock
+    pthread_cond_t done;
+    size_t pending;
+} MirrorShardBatch;
+
+typedef struct MirrorShardRequest {
+    const char* const* inputs;
+    const uint64_t* hashes;
+    const uint32_t* indices;    // Positions in inputs owned by this shard
+    size_t count;
+    int* results;
+    MirrorShardBatch* batch;
+    struct MirrorShardRequest* next;
+} MirrorShardRequest;
+
+typedef struct MirrorShardedWhitelist MirrorShardedWhitelist;
+
+typedef struct {
+    MirrorShardedWhitelist* owner;
+    size_t index;
+    int cpu;                    // -1 when unpinned or when pinning failed
+
+    // Owned and touched only by the worker after compile
+    MirrorShardEntry* entries;
+    size_t entry_count;
+    uint32_t* slots;            // Entry index + 1, 0 when empty
+    size_t slot_mask;
+    char* arena;
+
+    // Per-shard request queue
+    pthread_t thread;
+    WisdomMutex lock;
+    pthread_cond_t ready;
+    MirrorShardRequest* head;
+    MirrorShardRequest* tail;
+    int built;
+    int failed;
+    int stop;
+} MirrorShard;
+
+struct MirrorShardedWhitelist {
+    MirrorShard* shards;
+    size_t shard_count;
+    int compiled;
+
+    // Staging area, released once every shard has built its table
+    MirrorShardEntry* staged;
+    size_t staged_count;
+    size_t staged_capacity;
+    char* staged_arena;
+    size_t staged_arena_size;
+    size_t staged_arena_capacity;
+
+    // Shared by every batch's completion count, so it profiles as one lock
+    WisdomMutex batch_lock;
+
+    const Allocator* allocator;     // Called from the shard workers too
+};
+
+// FNV-1a, with a final mix so the shard (high bits) and slot (low bits) are independent
+static inline uint64_t mirror_shard_hash(const char* input, size_t length) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < length; i++) {
+        h ^= (unsigned char)input[i];
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline size_t mirror_shard_of(const MirrorShardedWhitelist* wl, uint64_t hash) {
+    return (size_t)((hash >> 32) % wl->shard_count);
+}
+
+// CPUs the calling thread may run on (its affinity mask, so cpusets are respected); returns the count
+static inline size_t mirror_shard_allowed_cpus(int* cpus, size_t max) {
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return 0;
+
+    size_t count = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && count < max; cpu++) {
+        if (CPU_ISSET(cpu, &set)) cpus[count++] = cpu;
+    }
+    return count;
+}
+
+/*
+ * cpus: optional list of shard_count CPU ids to pin shards to. When NULL,
+ * shard i is pinned to the i-th CPU of the caller's affinity mask, modulo
+ * its size. A shard whose pinning fails at compile runs unpinned with cpu
+ * set to -1.
+ * Returns 0 on success, -1 on invalid arguments or allocation failure.
+ */
+static inline int init_mirror_sharded_whitelist(MirrorShardedWhitelist* wl, size_t shard_count, const int* cpus,
+                                                const Allocator* allocator) {
+    memset(wl, 0, sizeof(*wl));
+    if (shard_count == 0 || shard_count > MIRROR_SHARD_MAX) return -1;
+
+    wl->allocator = allocator;
+    wl->shards = (MirrorShard*)allocator_calloc(allocator, shard_count, sizeof(MirrorShard));
+    if (!wl->shards) return -1;
+
+    int allowed[CPU_SETSIZE];
+    size_t allowed_count = cpus ? 0 : mirror_shard_allowed_cpus(allowed, CPU_SETSIZE);
+
+    wl->shard_count = shard_count;
+    for (size_t i = 0; i < shard_count; i++) {
+        MirrorShard* shard = &wl->shards[i];
+        shard->owner = wl;
+        shard->index = i;
+        if (cpus) shard->cpu = cpus[i];
+        else shard->cpu = allowed_count ? allowed[i % allowed_count] : -1;
+        init_wisdom_mutex(&shard->lock, "shard queue");
+        pthread_cond_init(&shard->ready, NULL);
+    }
+    init_wisdom_mutex(&wl->batch_lock, "shard batch");
+    return 0;
+}
+
+// Stage length bytes of pattern (need not be NUL-terminated) before compile. Returns 0 on success, -1 on failure
+static inline int mirror_shard_add_bytes(MirrorShardedWhitelist* wl, const char* pattern, size_t length) {
+    if (wl->compiled) return -1;
+    if (wl->staged_arena_size + length + 1 > UINT32_MAX) return -1;
+
+    if (wl->staged_count == wl->staged_capacity) {
+        size_t capacity = wl->staged_capacity ? wl->staged_capacity * 2 : 256;
+        MirrorShardEntry* staged = (MirrorShardEntry*)allocator_realloc(wl->allocator, wl->staged,
+                                                                         capacity * sizeof(MirrorShardEntry));
+        if (!staged) return -1;
+        wl->staged = staged;
+        wl->staged_capacity = capacity;
+    }
+
+    if (wl->staged_arena_size + length + 1 > wl->staged_arena_capacity) {
+        size_t capacity = wl->staged_arena_capacity ? wl->staged_arena_capacity : 4096;
+        while (capacity < wl->staged_arena_size + length + 1) capacity *= 2;
+        char* arena = (char*)allocator_realloc(wl->allocator, wl->staged_arena, capacity);
+        if (!arena) return -1;
+        wl->staged_arena = arena;
+        wl->staged_arena_capacity = capacity;
+    }
+
+    MirrorShardEntry* entry = &wl->staged[wl->staged_count++];
+    entry->hash = mirror_shard_hash(pattern, length);
+    entry->offset = (uint32_t)wl->staged_arena_size;
+    entry->length = (uint32_t)length;
+
+    memcpy(wl->staged_arena + wl->staged_arena_size, pattern, length);
+    wl->staged_arena[wl->staged_arena_size + length] = '\0';
+    wl->staged_arena_size += length + 1;
+    return 0;
+}
+
+// Stage a pattern before compile. Returns 0 on success, -1 on failure
+static inline int mirror_shard_add(MirrorShardedWhitelist* wl, const char* pattern) {
+    return mirror_shard_add_bytes(wl, pattern, strlen(pattern));
+}
+
+static inline int mirror_shard_probe(const MirrorShard* shard, const char* input, size_t length, uint64_t hash) {
+    if (!shard->slots) return 0;
+
+    for (size_t slot = (size_t)hash & shard->slot_mask;; slot = (slot + 1) & shard->slot_mask) {
+        uint32_t index = shard->slots[slot];
+        if (index == 0) return 0;
+
+        const MirrorShardEntry* entry = &shard->entries[index - 1];
+        if (entry->hash == hash && entry->length == length &&
+            memcmp(shard->arena + entry->offset, input, length) == 0) {
+            return 1;
+        }
+    }
+}
+
+// Build this shard's table from the staging area; runs on the pinned worker
+static inline int mirror_shard_build(MirrorShard* shard) {
+    const MirrorShardedWhitelist* wl = shard->owner;
+    size_t count = 0;
+    size_t bytes = 0;
+
+    for (size_t i = 0; i < wl->staged_count; i++) {
+        if (mirror_shard_of(wl, wl->staged[i].hash) == shard->index) {
+            count++;
+            bytes += wl->staged[i].length + 1;
+        }
+    }
+    if (count == 0) return 0;
+
+    size_t slots = 16;
+    while (slots < count * 2) slots *= 2;
+
+    shard->entries = (MirrorShardEntry*)allocator_alloc(wl->allocator, count * sizeof(MirrorShardEntry));
+    shard->slots = (uint32_t*)allocator_calloc(wl->allocator, slots, sizeof(uint32_t));
+    shard->arena = (char*)allocator_alloc(wl->allocator, bytes);
+    if (!shard->entries || !shard->slots || !shard->arena) return -1;
+    shard->slot_mask = slots - 1;
+
+    size_t offset = 0;
+    for (size_t i = 0; i < wl->staged_count; i++) {
+        const MirrorShardEntry* staged = &wl->staged[i];
+        if (mirror_shard_of(wl, staged->hash) != shard->index) continue;
+
+        const char* text = wl->staged_arena + staged->offset;
+        if (mirror_shard_probe(shard, text, staged->length, staged->hash)) continue;
+
+        MirrorShardEntry* entry = &shard->entries[shard->entry_count];
+        entry->hash = staged->hash;
+        entry->offset = (uint32_t)offset;
+        entry->length = staged->length;
+        memcpy(shard->arena + offset, text, staged->length + 1);
+        offset += staged->length + 1;
+
+        size_t slot = (size_t)staged->hash & shard->slot_mask;
+        while (shard->slots[slot] != 0) slot = (slot + 1) & shard->slot_mask;
+        shard->slots[slot] = (uint32_t)++shard->entry_count;
+    }
+    return 0;
+}
+
+static inline void mirror_shard_process(MirrorShard* shard, MirrorShardRequest* request) {
+    for (size_t i = 0; i < request->count; i++) {
+        uint32_t position = request->indices[i];
+        const char* input = request->inputs[position];
+        request->results[position] = mirror_shard_probe(shard, input, strlen(input), request->hashes[position]);
+    }
+
+    MirrorShardBatch* batch = request->batch;
+    wisdom_mutex_lock(batch->lock);
+    if (--batch->pending == 0) pthread_cond_signal(&batch->done);
+    wisdom_mutex_unlock(batch->lock);
+}
+
+static inline void* mirror_shard_worker(void* arg) {
+    MirrorShard* shard = (MirrorShard*)arg;
+
+    if (shard->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(shard->cpu, &set);
+        // Published with built below; a shard that could not be pinned is reported unpinned
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) shard->cpu = -1;
+    }
+
+    int status = mirror_shard_build(shard);
+
+    wisdom_mutex_lock(&shard->lock);
+    shard->built = 1;
+    shard->failed = status != 0;
+    pthread_cond_broadcast(&shard->ready);
+
+    for (;;) {
+        while (!shard->head && !shard->stop) wisdom_cond_wait(&shard->ready, &shard->lock);
+        if (!shard->head) break;
+
+        MirrorShardRequest* request = shard->head;
+        shard->head = request->next;
+        if (!shard->head) shard->tail = NULL;
+
+        wisdom_mutex_unlock(&shard->lock);
+        mirror_shard_process(shard, request);
+        wisdom_mutex_lock(&shard->lock);
+    }
+
+    wisdom_mutex_unlock(&shard->lock);
+    return NULL;
+}
+
+// Start the shard workers and build every shard. Returns 0 on success, -1 on failure
+static inline int mirror_shard_compile(MirrorShardedWhitelist* wl) {
+    if (wl->compiled) return -1;
+
+    size_t started = 0;
+    for (; started < wl->shard_count; started++) {
+        MirrorShard* shard = &wl->shards[started];
+        if (pthread_create(&shard->thread, NULL, mirror_shard_worker, shard) != 0) break;
+    }
+
+    int failed = started != wl->shard_count;
+    for (size_t i = 0; i < started; i++) {
+        MirrorShard* shard = &wl->shards[i];
+        wisdom_mutex_lock(&shard->lock);
+        while (!shard->built) wisdom_cond_wait(&shard->ready, &shard->lock);
+        failed |= shard->failed;
+        wisdom_mutex_unlock(&shard->lock);
+    }
+
+    wl->compiled = 1;
+
+    allocator_free(wl->allocator, wl->staged);
+    allocator_free(wl->allocator, wl->staged_arena);
+    wl->staged = NULL;
+    wl->staged_arena = NULL;
+    wl->staged_count = wl->staged_capacity = 0;
+    wl->staged_arena_size = wl->staged_arena_capacity = 0;
+
+    // Mark never-started shards so cleanup does not join them
+    for (size_t i = started; i < wl->shard_count; i++) wl->shards[i].built = -1;
+    return failed ? -1 : 0;
+}
+
+#define MIRROR_SHARD_HASH_GRAIN     1024    // Inputs hashed per pool task; smaller batches hash on the caller
+
+typedef struct {
+    const char* const* inputs;
+    uint64_t* hashes;
+} MirrorShardHashJob;
+
+static inline void mirror_shard_hash_range(size_t begin, size_t end, void* user_data) {
+    MirrorShardHashJob* job = (MirrorShardHashJob*)user_data;
+    for (size_t i = begin; i < end; i++) job->hashes[i] = mirror_shard_hash(job->inputs[i], strlen(job->inputs[i]));
+}
+
+/*
+ * Route a batch of lookups to the owning shards and wait for the answers.
+ * results[i] is 1 when inputs[i] is whitelisted, 0 otherwise.
+ * Returns 0 on success, -1 on failure.
+ */
+static inline int mirror_shard_lookup_batch(MirrorShardedWhitelist* wl, const char* const* inputs,
+                                            size_t count, int* results) {
+    if (!wl->compiled || count > UINT32_MAX) return -1;
+    if (count == 0) return 0;
+
+    const Allocator* allocator = wl->allocator;
+    uint64_t* hashes = (uint64_t*)allocator_alloc(allocator, count * sizeof(uint64_t));
+    uint32_t* indices = (uint32_t*)allocator_alloc(allocator, count * sizeof(uint32_t));
+    size_t* starts = (size_t*)allocator_calloc(allocator, wl->shard_count + 1, sizeof(size_t));
+    MirrorShardRequest* requests = (MirrorShardRequest*)allocator_calloc(allocator, wl->shard_count,
+                                                                         sizeof(MirrorShardRequest));
+    if (!hashes || !indices || !starts || !requests) {
+        allocator_free(allocator, hashes);
+        allocator_free(allocator, indices);
+        allocator_free(allocator, starts);
+        allocator_free(allocator, requests);
+        return -1;
+    }
+
+    MirrorShardHashJob job = { inputs, hashes };
+    TaskPool* pool = count >= 2 * MIRROR_SHARD_HASH_GRAIN ? task_pool_shared() : NULL;
+    task_pool_parallel_for(pool, 0, count, MIRROR_SHARD_HASH_GRAIN, mirror_shard_hash_range, &job);
+
+    // Counting sort of input positions by owning shard
+    for (size_t i = 0; i < count; i++) starts[mirror_shard_of(wl, hashes[i]) + 1]++;
+    for (size_t s = 0; s < wl->shard_count; s++) starts[s + 1] += starts[s];
+    for (size_t i = 0; i < count; i++) {
+        size_t s = mirror_shard_of(wl, hashes[i]);
+        indices[starts[s] + requests[s].count++] = (uint32_t)i;
+    }
+
+    MirrorShardBatch batch;
+    batch.lock = &wl->batch_lock;
+    pthread_cond_init(&batch.done, NULL);
+    batch.pending = 0;
+    for (size_t s = 0; s < wl->shard_count; s++) {
+        if (requests[s].count > 0) batch.pending++;
+    }
+
+    int status = 0;
+    for (size_t s = 0; s < wl->shard_count; s++) {
+        MirrorShardRequest* request = &requests[s];
+        if (request->count == 0) continue;
+
+        MirrorShard* shard = &wl->shards[s];
+        if (shard->built != 1 || shard->failed) {
+            status = -1;
+            for (size_t i = 0; i < request->count; i++) results[indices[starts[s] + i]] = 0;
+            wisdom_mutex_lock(batch.lock);
+            batch.pending--;
+            wisdom_mutex_unlock(batch.lock);
+            continue;
+        }
+
+        request->inputs = inputs;
+        request->hashes = hashes;
+        request->indices = indices + starts[s];
+        request->results = results;
+        request->batch = &batch;
+        request->next = NULL;
+
+        wisdom_mutex_lock(&shard->lock);
+        if (shard->tail) shard->tail->next = request;
+        else shard->head = request;
+        shard->tail = request;
+        pthread_cond_signal(&shard->ready);
+        wisdom_mutex_unlock(&shard->lock);
+    }
+
+    wisdom_mutex_lock(batch.lock);
+    while (batch.pending > 0) wisdom_cond_wait(&batch.done, batch.lock);
+    wisdom_mutex_unlock(batch.lock);
+
+    pthread_cond_destroy(&batch.done);
+    allocator_free(allocator, hashes);
+    allocator_free(allocator, indices);
+    allocator_free(allocator, starts);
+    allocator_free(allocator, requests);
+    return status;
+}
+
+#define MIRROR_SHARD_ENCODING_VERSION   1
+
+static inline void mirror_shard_put32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static inline uint32_t mirror_shard_get32(const unsigned char* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+/*
+ * Encode the patterns of wl, staged or compiled, into buffer: a u32 version
+ * and a u32 pattern count, then a u32 length and the bytes of each pattern,
+ * all little-endian. Tables are not stored; they are rebuilt by compile on
+ * the loading side, where the shard count and pinning may differ.
+ * Returns the encoded size; if it exceeds capacity nothing useful was
+ * written and the call should be repeated with a larger buffer (buffer may
+ * be NULL to query the size). Must not race with cleanup.
+ */
+static inline size_t mirror_shard_encode(const MirrorShardedWhitelist* wl, unsigned char* buffer, size_t capacity) {
+    size_t at = 8;
+    uint32_t count = 0;
+
+    for (size_t s = 0; s <= wl->shard_count; s++) {
+        // The staging area is listed as one extra shard; it is empty once compiled
+        const MirrorShardEntry* entries = s < wl->shard_count ? wl->shards[s].entries : wl->staged;
+        size_t entry_count = s < wl->shard_count ? wl->shards[s].entry_count : wl->staged_count;
+        const char* arena = s < wl->shard_count ? wl->shards[s].arena : wl->staged_arena;
+
+        for (size_t i = 0; i < entry_count; i++) {
+            const MirrorShardEntry* entry = &entries[i];
+            if (buffer && at + 4 + entry->length <= capacity) {
+                mirror_shard_put32(buffer + at, entry->length);
+                memcpy(buffer + at + 4, arena + entry->offset, entry->length);
+            }
+            at += 4 + entry->length;
+            count++;
+        }
+    }
+
+    if (buffer && capacity >= 8) {
+        mirror_shard_put32(buffer, MIRROR_SHARD_ENCODING_VERSION);
+        mirror_shard_put32(buffer + 4, count);
+    }
+    return at;
+}
+
+/*
+ * Stage every pattern of an encoding made by mirror_shard_encode into wl,
+ * which must be initialised and not yet compiled; call mirror_shard_compile
+ * afterwards. Returns 0 on success, -1 on malformed input or allocation
+ * failure (wl may then hold some of the patterns).
+ */
+static inline int mirror_shard_decode(MirrorShardedWhitelist* wl, const void* data, size_t size) {
+    const unsigned char* p = (const unsigned char*)data;
+    if (wl->compiled || size < 8 || mirror_shard_get32(p) != MIRROR_SHARD_ENCODING_VERSION) return -1;
+
+    uint32_t count = mirror_shard_get32(p + 4);
+    size_t at = 8;
+    for (uint32_t i = 0; i < count; i++) {
+        if (size - at < 4) return -1;
+        uint32_t length = mirror_shard_get32(p + at);
+        at += 4;
+        // Lookups hash up to the first NUL, so a pattern containing one could never match
+        if (size - at < length || memchr(p + at, '\0', length)) return -1;
+        if (mirror_shard_add_bytes(wl, (const char*)p + at, length) != 0) return -1;
+        at += length;
+    }
+    return at == size ? 0 : -1;
+}
+
+// Stop the shard workers and release every shard
+static inline void cleanup_mirror_sharded_whitelist(MirrorShardedWhitelist* wl) {
+    for (size_t i = 0; i < wl->shard_count; i++) {
+        MirrorShard* shard = &wl->shards[i];
+
+        if (wl->compiled && shard->built == 1) {
+            wisdom_mutex_lock(&shard->lock);
+            shard->stop = 1;
+            pthread_cond_broadcast(&shard->ready);
+            wisdom_mutex_unlock(&shard->lock);
+            pthread_join(shard->thread, NULL);
+        }
+
+        cleanup_wisdom_mutex(&shard->lock);
+        pthread_cond_destroy(&shard->ready);
+        allocator_free(wl->allocator, shard->entries);
+        allocator_free(wl->allocator, shard->slots);
+        allocator_free(wl->allocator, shard->arena);
+    }
+
+    if (wl->shards) cleanup_wisdom_mutex(&wl->batch_lock);
+    allocator_free(wl->allocator, wl->shards);
+    allocator_free(wl->allocator, wl->staged);
+    allocator_free(wl->allocator, wl->staged_arena);
+    memset(wl, 0, sizeof(*wl));
+}
+
+#endif // MIRROR_SHARD_H
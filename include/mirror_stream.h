@@ -0,0 +1,239 @@
+#ifndef MIRROR_STREAM_H
+#define MIRROR_STREAM_H
+
+/*
+ * Mirror King - rolling-hash windowed matching over byte streams
+ *
+ * Fixed-width patterns are indexed by their Rabin-Karp hash. A stream keeps
+ * the hash of the last `width` bytes, updated in O(1) per byte, and only
+ * verifies bytes when the hash hits the pattern table. The window lives in a
+ * ring buffer owned by the stream, so matches that straddle chunk boundaries
+ * are found without the caller re-feeding any data.
+ *
+ * Usage:
+ *   init_mirror_window_set(&set, 8, NULL);          // NULL: C library allocator
+ *   mirror_window_add(&set, "GET /adm", 8);
+ *   init_mirror_window_stream(&stream, &set);
+ *   mirror_window_feed(&stream, chunk, chunk_len, on_match, ctx);  // per chunk
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "allocator.h"
+
+#define MIRROR_WINDOW_BASE 0x100000001b3ULL
+
+typedef struct {
+    uint64_t hash;
+    uint32_t offset;
+} MirrorWindowEntry;
+
+typedef struct {
+    size_t width;
+    uint64_t base_pow;          // BASE^(width-1), removes the outgoing byte
+
+    MirrorWindowEntry* entries;
+    size_t entry_count;
+    size_t entry_capacity;
+    unsigned char* arena;       // entry_count patterns of width bytes
+
+    uint32_t* slots;            // Entry index + 1, 0 when empty
+    size_t slot_mask;
+
+    const Allocator* allocator;
+} MirrorWindowSet;
+
+typedef struct {
+    const MirrorWindowSet* set;
+    const Allocator* allocator;     // The set's, kept so cleanup order does not matter
+    unsigned char* ring;
+    size_t head;                // Next write position in ring
+    size_t filled;
+    uint64_t hash;
+    uint64_t offset;            // Bytes consumed since init/reset
+    uint64_t hash_hits;         // Verifications performed
+} MirrorWindowStream;
+
+// stream_offset is the position of the window's first byte in the stream
+typedef void (*MirrorWindowCallback)(uint64_t stream_offset, size_t pattern_index, void* user_data);
+
+static inline uint64_t mirror_window_hash(const unsigned char* data, size_t length) {
+    uint64_t h = 0;
+    for (size_t i = 0; i < length; i++) h = h * MIRROR_WINDOW_BASE + data[i];
+    return h;
+}
+
+// allocator may be NULL for the C library. Returns 0 on success, -1 on invalid width
+static inline int init_mirror_window_set(MirrorWindowSet* set, size_t width, const Allocator* allocator) {
+    memset(set, 0, sizeof(*set));
+    if (width == 0) return -1;
+
+    set->allocator = allocator;
+    set->width = width;
+    set->base_pow = 1;
+    for (size_t i = 1; i < width; i++) set->base_pow *= MIRROR_WINDOW_BASE;
+    return 0;
+}
+
+static inline void cleanup_mirror_window_set(MirrorWindowSet* set) {
+    allocator_free(set->allocator, set->entries);
+    allocator_free(set->allocator, set->arena);
+    allocator_free(set->allocator, set->slots);
+    memset(set, 0, sizeof(*set));
+}
+
+static inline const unsigned char* mirror_window_pattern(const MirrorWindowSet* set, size_t index) {
+    return index < set->entry_count ? set->arena + set->entries[index].offset : NULL;
+}
+
+static inline int mirror_window_rehash(MirrorWindowSet* set, size_t slot_count) {
+    uint32_t* slots = (uint32_t*)allocator_calloc(set->allocator, slot_count, sizeof(uint32_t));
+    if (!slots) return -1;
+
+    for (size_t i = 0; i < set->entry_count; i++) {
+        size_t slot = (size_t)set->entries[i].hash & (slot_count - 1);
+        while (slots[slot] != 0) slot = (slot + 1) & (slot_count - 1);
+        slots[slot] = (uint32_t)(i + 1);
+    }
+
+    allocator_free(set->allocator, set->slots);
+    set->slots = slots;
+    set->slot_mask = slot_count - 1;
+    return 0;
+}
+
+/*
+ * Add a pattern of exactly set->width bytes; duplicates are ignored.
+ * Returns the pattern index, or -1 on invalid length or allocation failure.
+ */
+static inline long mirror_window_add(MirrorWindowSet* set, const void* pattern, size_t length) {
+    if (length != set->width) return -1;
+
+    const unsigned char* bytes = (const unsigned char*)pattern;
+    uint64_t hash = mirror_window_hash(bytes, length);
+
+    if (set->slots) {
+        for (size_t slot = (size_t)hash & set->slot_mask; set->slots[slot] != 0;
+             slot = (slot + 1) & set->slot_mask) {
+            const MirrorWindowEntry* entry = &set->entries[set->slots[slot] - 1];
+            if (entry->hash == hash && memcmp(set->arena + entry->offset, bytes, length) == 0) {
+                return (long)(set->slots[slot] - 1);
+            }
+        }
+    }
+
+    if (set->entry_count == set->entry_capacity) {
+        size_t capacity = set->entry_capacity ? set->entry_capacity * 2 : 64;
+        if (capacity * set->width > UINT32_MAX) return -1;
+
+        MirrorWindowEntry* entries = (MirrorWindowEntry*)allocator_realloc(set->allocator, set->entries,
+                                                                         capacity * sizeof(MirrorWindowEntry));
+        if (!entries) return -1;
+        set->entries = entries;
+
+        unsigned char* arena = (unsigned char*)allocator_realloc(set->allocator, set->arena, capacity * set->width);
+        if (!arena) return -1;
+        set->arena = arena;
+        set->entry_capacity = capacity;
+    }
+
+    size_t index = set->entry_count++;
+    set->entries[index].hash = hash;
+    set->entries[index].offset = (uint32_t)(index * set->width);
+    memcpy(set->arena + index * set->width, bytes, length);
+
+    // Keep the table at most half full
+    size_t slot_count = set->slots ? set->slot_mask + 1 : 0;
+    if (set->entry_count * 2 > slot_count) {
+        if (mirror_window_rehash(set, slot_count ? slot_count * 2 : 128) != 0) {
+            set->entry_count--;
+            return -1;
+        }
+    } else {
+        size_t slot = (size_t)hash & set->slot_mask;
+        while (set->slots[slot] != 0) slot = (slot + 1) & set->slot_mask;
+        set->slots[slot] = (uint32_t)(index + 1);
+    }
+    return (long)index;
+}
+
+// Returns 0 on success, -1 on allocation failure
+static inline int init_mirror_window_stream(MirrorWindowStream* stream, const MirrorWindowSet* set) {
+    memset(stream, 0, sizeof(*stream));
+    stream->set = set;
+    stream->allocator = set->allocator;
+    stream->ring = (unsigned char*)allocator_alloc(set->allocator, set->width);
+    return stream->ring ? 0 : -1;
+}
+
+// Forget buffered bytes, e.g. when a connection restarts
+static inline void mirror_window_reset(MirrorWindowStream* stream) {
+    stream->head = 0;
+    stream->filled = 0;
+    stream->hash = 0;
+    stream->offset = 0;
+}
+
+static inline void cleanup_mirror_window_stream(MirrorWindowStream* stream) {
+    allocator_free(stream->allocator, stream->ring);
+    memset(stream, 0, sizeof(*stream));
+}
+
+// Compare the ring (oldest byte at head) with a pattern
+static inline int mirror_window_verify(const MirrorWindowStream* stream, const unsigned char* pattern) {
+    size_t width = stream->set->width;
+    size_t tail = width - stream->head;
+    return memcmp(stream->ring + stream->head, pattern, tail) == 0 &&
+           memcmp(stream->ring, pattern + tail, stream->head) == 0;
+}
+
+/*
+ * Consume one chunk of the stream, invoking callback for every full window
+ * equal to a pattern. Returns the number of matches in this chunk.
+ */
+static inline size_t mirror_window_feed(MirrorWindowStream* stream, const void* data, size_t length,
+                                        MirrorWindowCallback callback, void* user_data) {
+    const MirrorWindowSet* set = stream->set;
+    const unsigned char* bytes = (const unsigned char*)data;
+    size_t width = set->width;
+    size_t matches = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        unsigned char in = bytes[i];
+
+        if (stream->filled == width) {
+            stream->hash -= stream->ring[stream->head] * set->base_pow;
+        } else {
+            stream->filled++;
+        }
+        stream->hash = stream->hash * MIRROR_WINDOW_BASE + in;
+        stream->ring[stream->head] = in;
+        stream->head = stream->head + 1 == width ? 0 : stream->head + 1;
+        stream->offset++;
+
+        if (stream->filled < width || !set->slots) continue;
+
+        for (size_t slot = (size_t)stream->hash & set->slot_mask; set->slots[slot] != 0;
+             slot = (slot + 1) & set->slot_mask) {
+            size_t index = set->slots[slot] - 1;
+            const MirrorWindowEntry* entry = &set->entries[index];
+            if (entry->hash != stream->hash) continue;
+
+            stream->hash_hits++;
+            if (mirror_window_verify(stream, set->arena + entry->offset)) {
+                matches++;
+                if (callback) callback(stream->offset - width, index, user_data);
+                break;  // Patterns are unique, so at most one can match
+            }
+        }
+    }
+
+    return matches;
+}
+
+#endif // MIRROR_STREAM_H
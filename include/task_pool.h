@@ -0,0 +1,606 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+/*
+ * Shared work-stealing task pool
+ *
+ * One set of worker threads for the whole library, so subsystems running
+ * batch work at the same time do not each start a thread per core and
+ * oversubscribe the machine.
+ *
+ * Each worker owns a Chase-Lev deque: it pushes and pops tasks it spawns at
+ * the bottom (LIFO, cache-warm), and idle workers steal from the top. Tasks
+ * from threads outside the pool go to a worker's inbox, either the one named
+ * by an affinity hint or round-robin. A hint is a preference, not a promise;
+ * an idle worker will still steal the task. Workers with nothing to do spin
+ * briefly, then sleep until work is submitted.
+ *
+ * Waiting on a group runs queued tasks instead of blocking, so tasks can
+ * submit and wait on nested groups without deadlocking the pool.
+ *
+ * The library-wide instance is configured once at startup and started on
+ * first use:
+ *   TaskPoolConfig config;
+ *   task_pool_defaults(&config);
+ *   config.pin = 1;
+ *   task_pool_configure(&config);     // Before any subsystem uses the pool
+ *   ...
+ *   task_pool_parallel_for(task_pool_shared(), 0, n, 0, body, &ctx);
+ *   cleanup_task_pool_shared();
+ *
+ * Inbox and sleep locks are WisdomMutex; build with -DWISDOM_LOCK_PROFILE to
+ * see their contention in wisdom_lock_report.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "O_wisdom_lock.h"
+
+#define TASK_POOL_MAX_WORKERS   256
+#define TASK_POOL_SPIN_ROUNDS   64      // Empty scans before a worker sleeps
+#define TASK_POOL_NO_HINT       (-1)
+
+typedef struct {
+    size_t pending;                 // Submitted and not yet finished
+} TaskPoolGroup;
+
+typedef struct TaskPoolTask {
+    void (*fn)(void* arg);
+    void* arg;
+    TaskPoolGroup* group;           // Optional
+    struct TaskPoolTask* next;      // Inbox link
+} TaskPoolTask;
+
+typedef struct {
+    size_t workers;                 // 0 means the number of online CPUs
+    int pin;                        // Pin worker i to cpus[i], or to the i-th CPU of the caller's affinity mask
+    const int* cpus;
+    size_t cpu_count;
+    size_t deque_capacity;          // Per worker, rounded up to a power of two
+} TaskPoolConfig;
+
+typedef struct TaskPool TaskPool;
+
+typedef struct {
+    // Chase-Lev deque; top and bottom on separate lines
+    int64_t top __attribute__((aligned(64)));
+    int64_t bottom __attribute__((aligned(64)));
+    TaskPoolTask** slots;
+    size_t mask;
+
+    WisdomMutex inbox_lock;
+    TaskPoolTask* inbox_head;
+    TaskPoolTask* inbox_tail;
+    size_t inbox_count;             // Read without the lock as an emptiness hint
+
+    TaskPool* pool;
+    size_t index;
+    int cpu;                        // -1 when unpinned or when pinning failed
+    pthread_t thread;
+    uint64_t rng;
+    uint64_t executed;
+    uint64_t stolen;
+} __attribute__((aligned(64))) TaskPoolWorker;
+
+struct TaskPool {
+    TaskPoolConfig config;
+    TaskPoolWorker* workers;
+    size_t worker_count;
+    size_t started;
+    int stop;
+
+    WisdomMutex sleep_lock;
+    pthread_cond_t wake;
+    uint64_t epoch;                 // Bumped on every submission
+    size_t sleepers;
+    size_t next_inbox;
+    size_t pin_failures;            // Workers that asked to be pinned and could not be
+};
+
+__attribute__((weak)) __thread TaskPoolWorker* task_pool_current;
+
+static inline void task_pool_defaults(TaskPoolConfig* config) {
+    memset(config, 0, sizeof(*config));
+    config->deque_capacity = 4096;
+}
+
+/* ---------------------------------------------------------------------------
+ * Deque (owner: push/take at the bottom; thieves: steal at the top)
+ * ------------------------------------------------------------------------- */
+
+// Returns 0 on success, -1 when full
+static inline int task_pool_deque_push(TaskPoolWorker* w, TaskPoolTask* task) {
+    int64_t b = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED);
+    int64_t t = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+    if ((size_t)(b - t) > w->mask) return -1;
+    __atomic_store_n(&w->slots[(size_t)b & w->mask], task, __ATOMIC_RELAXED);
+    __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static inline TaskPoolTask* task_pool_deque_take(TaskPoolWorker* w) {
+    int64_t b = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&w->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t t = __atomic_load_n(&w->top, __ATOMIC_RELAXED);
+
+    if (t > b) {
+        __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    TaskPoolTask* task = __atomic_load_n(&w->slots[(size_t)b & w->mask], __ATOMIC_RELAXED);
+    if (t == b) {
+        // Last task: race the thieves for it
+        if (!__atomic_compare_exchange_n(&w->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) task = NULL;
+        __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return task;
+}
+
+// NULL when empty or when another thief won the race
+static inline TaskPoolTask* task_pool_deque_steal(TaskPoolWorker* w) {
+    int64_t t = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t b = __atomic_load_n(&w->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b) return NULL;
+
+    TaskPoolTask* task = __atomic_load_n(&w->slots[(size_t)t & w->mask], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&w->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) return NULL;
+    return task;
+}
+
+/* ---------------------------------------------------------------------------
+ * Inboxes (any thread may push)
+ * ------------------------------------------------------------------------- */
+
+static inline void task_pool_inbox_push(TaskPoolWorker* w, TaskPoolTask* task) {
+    task->next = NULL;
+    wisdom_mutex_lock(&w->inbox_lock);
+    if (w->inbox_tail) w->inbox_tail->next = task;
+    else w->inbox_head = task;
+    w->inbox_tail = task;
+    __atomic_store_n(&w->inbox_count, w->inbox_count + 1, __ATOMIC_RELAXED);
+    wisdom_mutex_unlock(&w->inbox_lock);
+}
+
+static inline TaskPoolTask* task_pool_inbox_pop(TaskPoolWorker* w) {
+    if (__atomic_load_n(&w->inbox_count, __ATOMIC_RELAXED) == 0) return NULL;
+
+    wisdom_mutex_lock(&w->inbox_lock);
+    TaskPoolTask* task = w->inbox_head;
+    if (task) {
+        w->inbox_head = task->next;
+        if (!w->inbox_head) w->inbox_tail = NULL;
+        __atomic_store_n(&w->inbox_count, w->inbox_count - 1, __ATOMIC_RELAXED);
+    }
+    wisdom_mutex_unlock(&w->inbox_lock);
+    return task;
+}
+
+/* ---------------------------------------------------------------------------
+ * Scheduling
+ * ------------------------------------------------------------------------- */
+
+static inline uint64_t task_pool_rand(uint64_t* state) {
+    // xorshift64*
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+// The calling thread's worker if it belongs to pool, else NULL
+static inline TaskPoolWorker* task_pool_self(const TaskPool* pool) {
+    TaskPoolWorker* self = task_pool_current;
+    return self && self->pool == pool ? self : NULL;
+}
+
+// Own deque, own inbox, then steal from a random victim onwards
+static inline TaskPoolTask* task_pool_find(TaskPool* pool, TaskPoolWorker* self, uint64_t* rng) {
+    TaskPoolTask* task;
+    if (self) {
+        if ((task = task_pool_deque_take(self)) != NULL) return task;
+        if ((task = task_pool_inbox_pop(self)) != NULL) return task;
+    }
+
+    size_t start = (size_t)(task_pool_rand(rng) % pool->worker_count);
+    for (size_t i = 0; i < pool->worker_count; i++) {
+        TaskPoolWorker* victim = &pool->workers[(start + i) % pool->worker_count];
+        if (victim == self) continue;
+        task = task_pool_deque_steal(victim);
+        if (!task) task = task_pool_inbox_pop(victim);
+        if (task) {
+            if (self) self->stolen++;
+            return task;
+        }
+    }
+    return NULL;
+}
+
+static inline void task_pool_execute(TaskPoolWorker* self, TaskPoolTask* task) {
+    TaskPoolGroup* group = task->group;
+    task->fn(task->arg);
+    if (self) self->executed++;
+    // The task may live in the waiter's storage; do not touch it after this
+    if (group) __atomic_sub_fetch(&group->pending, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * The epoch bump and the sleeper count are both sequentially consistent, so
+ * either the submitter sees the sleeper or the sleeper sees the new epoch.
+ */
+static inline void task_pool_wake(TaskPool* pool) {
+    __atomic_add_fetch(&pool->epoch, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST) > 0) {
+        wisdom_mutex_lock(&pool->sleep_lock);
+        pthread_cond_broadcast(&pool->wake);
+        wisdom_mutex_unlock(&pool->sleep_lock);
+    }
+}
+
+static inline void* task_pool_worker_main(void* arg) {
+    TaskPoolWorker* self = (TaskPoolWorker*)arg;
+    TaskPool* pool = self->pool;
+    task_pool_current = self;
+
+    size_t idle = 0;
+    while (!__atomic_load_n(&pool->stop, __ATOMIC_ACQUIRE)) {
+        uint64_t epoch = __atomic_load_n(&pool->epoch, __ATOMIC_SEQ_CST);
+        TaskPoolTask* task = task_pool_find(pool, self, &self->rng);
+        if (task) {
+            task_pool_execute(self, task);
+            idle = 0;
+            continue;
+        }
+        if (++idle < TASK_POOL_SPIN_ROUNDS) {
+            sched_yield();
+            continue;
+        }
+
+        wisdom_mutex_lock(&pool->sleep_lock);
+        __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&pool->epoch, __ATOMIC_SEQ_CST) == epoch &&
+               !__atomic_load_n(&pool->stop, __ATOMIC_ACQUIRE)) {
+            wisdom_cond_wait(&pool->wake, &pool->sleep_lock);
+        }
+        __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        wisdom_mutex_unlock(&pool->sleep_lock);
+        idle = 0;
+    }
+
+    task_pool_current = NULL;
+    return NULL;
+}
+
+static inline void cleanup_task_pool(TaskPool* pool) {
+    wisdom_mutex_lock(&pool->sleep_lock);
+    __atomic_store_n(&pool->stop, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&pool->wake);
+    wisdom_mutex_unlock(&pool->sleep_lock);
+
+    for (size_t i = 0; i < pool->started; i++) pthread_join(pool->workers[i].thread, NULL);
+    for (size_t i = 0; i < pool->worker_count; i++) {
+        free(pool->workers[i].slots);
+        cleanup_wisdom_mutex(&pool->workers[i].inbox_lock);
+    }
+    free(pool->workers);
+    cleanup_wisdom_mutex(&pool->sleep_lock);
+    pthread_cond_destroy(&pool->wake);
+    memset(pool, 0, sizeof(*pool));
+}
+
+// CPUs the calling thread may run on (its affinity mask, so cpusets are respected); returns the count
+static inline size_t task_pool_allowed_cpus(int* cpus, size_t max) {
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return 0;
+
+    size_t count = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && count < max; cpu++) {
+        if (CPU_ISSET(cpu, &set)) cpus[count++] = cpu;
+    }
+    return count;
+}
+
+/*
+ * Start the workers. Returns 0 on success, -1 on failure. A worker that
+ * cannot be pinned runs unpinned; task_pool_pin_failures counts them.
+ */
+static inline int init_task_pool(TaskPool* pool, const TaskPoolConfig* config) {
+    memset(pool, 0, sizeof(*pool));
+    if (config) pool->config = *config;
+    else task_pool_defaults(&pool->config);
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    if (online < 1) online = 1;
+    size_t count = pool->config.workers ? pool->config.workers : (size_t)online;
+    if (count > TASK_POOL_MAX_WORKERS) count = TASK_POOL_MAX_WORKERS;
+
+    size_t capacity = 64;
+    while (capacity < pool->config.deque_capacity) capacity <<= 1;
+
+    int allowed[CPU_SETSIZE];
+    size_t allowed_count = 0;
+    if (pool->config.pin && !(pool->config.cpus && pool->config.cpu_count)) {
+        allowed_count = task_pool_allowed_cpus(allowed, CPU_SETSIZE);
+    }
+
+    init_wisdom_mutex(&pool->sleep_lock, "task pool sleep");
+    pthread_cond_init(&pool->wake, NULL);
+    pool->workers = (TaskPoolWorker*)aligned_alloc(64, count * sizeof(TaskPoolWorker));
+    if (!pool->workers) {
+        cleanup_task_pool(pool);
+        return -1;
+    }
+    memset(pool->workers, 0, count * sizeof(TaskPoolWorker));
+    pool->worker_count = count;
+
+    for (size_t i = 0; i < count; i++) {
+        TaskPoolWorker* w = &pool->workers[i];
+        init_wisdom_mutex(&w->inbox_lock, "task pool inbox");
+        w->pool = pool;
+        w->index = i;
+        w->rng = 0x9e3779b97f4a7c15ULL * (i + 1);
+        w->cpu = -1;
+        if (pool->config.pin) {
+            if (pool->config.cpus && pool->config.cpu_count) w->cpu = pool->config.cpus[i % pool->config.cpu_count];
+            else if (allowed_count) w->cpu = allowed[i % allowed_count];
+            else pool->pin_failures++;
+        }
+        w->mask = capacity - 1;
+        w->slots = (TaskPoolTask**)calloc(capacity, sizeof(TaskPoolTask*));
+        if (!w->slots) {
+            cleanup_task_pool(pool);
+            return -1;
+        }
+    }
+
+    for (; pool->started < count; pool->started++) {
+        TaskPoolWorker* w = &pool->workers[pool->started];
+
+        // Pinned at creation, so a CPU outside the cpuset is known before init returns
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (w->cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(w->cpu, &set);
+            pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+        }
+        int status = pthread_create(&w->thread, &attr, task_pool_worker_main, w);
+        pthread_attr_destroy(&attr);
+        if (status != 0 && w->cpu >= 0) {
+            w->cpu = -1;
+            pool->pin_failures++;
+            status = pthread_create(&w->thread, NULL, task_pool_worker_main, w);
+        }
+        if (status != 0) {
+            cleanup_task_pool(pool);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Queue a task. hint names the preferred worker (taken modulo the worker
+ * count) or is TASK_POOL_NO_HINT; without a hint a task submitted from a
+ * worker goes to that worker's own deque. task must stay valid until it
+ * has run, which task_pool_wait on its group guarantees.
+ */
+static inline void task_pool_submit(TaskPool* pool, TaskPoolTask* task, int hint) {
+    if (task->group) __atomic_add_fetch(&task->group->pending, 1, __ATOMIC_RELAXED);
+
+    TaskPoolWorker* self = task_pool_self(pool);
+    if (hint < 0 && self && task_pool_deque_push(self, task) == 0) {
+        task_pool_wake(pool);
+        return;
+    }
+
+    size_t target = hint >= 0 ? (size_t)hint
+                              : self ? self->index
+                                     : __atomic_fetch_add(&pool->next_inbox, 1, __ATOMIC_RELAXED);
+    task_pool_inbox_push(&pool->workers[target % pool->worker_count], task);
+    task_pool_wake(pool);
+}
+
+// Run queued tasks until every task of group has finished
+static inline void task_pool_wait(TaskPool* pool, TaskPoolGroup* group) {
+    TaskPoolWorker* self = task_pool_self(pool);
+    uint64_t rng = (uint64_t)(uintptr_t)group | 1;
+
+    while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) > 0) {
+        TaskPoolTask* task = task_pool_find(pool, self, self ? &self->rng : &rng);
+        if (task) task_pool_execute(self, task);
+        else sched_yield();
+    }
+}
+
+static inline size_t task_pool_worker_count(const TaskPool* pool) {
+    return pool ? pool->worker_count : 1;
+}
+
+// Workers that were asked to pin but run unpinned because their CPU is not allowed
+static inline size_t task_pool_pin_failures(const TaskPool* pool) {
+    return pool ? pool->pin_failures : 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Parallel loops
+ * ------------------------------------------------------------------------- */
+
+typedef void (*TaskPoolRangeFn)(size_t begin, size_t end, void* user_data);
+
+// Accumulate [begin, end) into partial, which starts as a copy of the identity
+typedef void (*TaskPoolMapFn)(size_t begin, size_t end, void* partial, void* user_data);
+
+// Fold partial into result
+typedef void (*TaskPoolCombineFn)(void* result, const void* partial, void* user_data);
+
+typedef struct {
+    TaskPoolTask task;
+    size_t begin;
+    size_t end;
+    TaskPoolRangeFn body;
+    TaskPoolMapFn map;
+    void* partial;
+    void* user_data;
+} TaskPoolChunk;
+
+static inline void task_pool_run_chunk(void* arg) {
+    TaskPoolChunk* chunk = (TaskPoolChunk*)arg;
+    if (chunk->map) chunk->map(chunk->begin, chunk->end, chunk->partial, chunk->user_data);
+    else chunk->body(chunk->begin, chunk->end, chunk->user_data);
+}
+
+// Chunk count for [begin, end); grain 0 picks about four chunks per worker
+static inline size_t task_pool_chunk_count(const TaskPool* pool, size_t n, size_t* grain) {
+    if (*grain == 0) {
+        size_t target = task_pool_worker_count(pool) * 4;
+        *grain = (n + target - 1) / target;
+        if (*grain == 0) *grain = 1;
+    }
+    return (n + *grain - 1) / *grain;
+}
+
+/*
+ * Split [begin, end) into chunks of grain indices and run them across the
+ * pool, chunk i hinted to worker i * workers / chunks. Consecutive calls over
+ * the same range therefore give each worker the same slice of the data.
+ * The caller helps until all chunks are done. A NULL pool, a single chunk or
+ * an allocation failure runs the loop on the caller.
+ */
+static inline void task_pool_parallel_for(TaskPool* pool, size_t begin, size_t end, size_t grain,
+                                          TaskPoolRangeFn body, void* user_data) {
+    if (end <= begin) return;
+    size_t chunks = task_pool_chunk_count(pool, end - begin, &grain);
+    TaskPoolChunk* items = chunks > 1 && pool ? (TaskPoolChunk*)calloc(chunks, sizeof(TaskPoolChunk)) : NULL;
+    if (!items) {
+        body(begin, end, user_data);
+        return;
+    }
+
+    TaskPoolGroup group = { 0 };
+    for (size_t i = 0; i < chunks; i++) {
+        TaskPoolChunk* chunk = &items[i];
+        chunk->begin = begin + i * grain;
+        chunk->end = end - chunk->begin > grain ? chunk->begin + grain : end;
+        chunk->body = body;
+        chunk->user_data = user_data;
+        chunk->task.fn = task_pool_run_chunk;
+        chunk->task.arg = chunk;
+        chunk->task.group = &group;
+        task_pool_submit(pool, &chunk->task, (int)(i * pool->worker_count / chunks));
+    }
+    task_pool_wait(pool, &group);
+    free(items);
+}
+
+/*
+ * Parallel reduction over [begin, end). result must hold the identity on
+ * entry; every chunk maps into its own copy of it, and the partials are
+ * combined into result in index order, so the answer does not depend on
+ * scheduling. Returns 0 on success, -1 on allocation failure (result is
+ * untouched).
+ */
+static inline int task_pool_parallel_reduce(TaskPool* pool, size_t begin, size_t end, size_t grain,
+                                            void* result, size_t result_size, TaskPoolMapFn map,
+                                            TaskPoolCombineFn combine, void* user_data) {
+    if (end <= begin) return 0;
+    size_t chunks = task_pool_chunk_count(pool, end - begin, &grain);
+    if (chunks == 1 || !pool) {
+        map(begin, end, result, user_data);
+        return 0;
+    }
+
+    TaskPoolChunk* items = (TaskPoolChunk*)calloc(chunks, sizeof(TaskPoolChunk));
+    unsigned char* partials = (unsigned char*)malloc(chunks * result_size);
+    if (!items || !partials) {
+        free(items);
+        free(partials);
+        return -1;
+    }
+
+    TaskPoolGroup group = { 0 };
+    for (size_t i = 0; i < chunks; i++) {
+        TaskPoolChunk* chunk = &items[i];
+        chunk->begin = begin + i * grain;
+        chunk->end = end - chunk->begin > grain ? chunk->begin + grain : end;
+        chunk->map = map;
+        chunk->partial = partials + i * result_size;
+        chunk->user_data = user_data;
+        memcpy(chunk->partial, result, result_size);
+        chunk->task.fn = task_pool_run_chunk;
+        chunk->task.arg = chunk;
+        chunk->task.group = &group;
+        task_pool_submit(pool, &chunk->task, (int)(i * pool->worker_count / chunks));
+    }
+    task_pool_wait(pool, &group);
+
+    for (size_t i = 0; i < chunks; i++) combine(result, items[i].partial, user_data);
+    free(items);
+    free(partials);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Library-wide instance
+ * ------------------------------------------------------------------------- */
+
+__attribute__((weak)) pthread_mutex_t task_pool_shared_lock = PTHREAD_MUTEX_INITIALIZER;
+__attribute__((weak)) TaskPool* task_pool_shared_instance;
+__attribute__((weak)) TaskPoolConfig task_pool_shared_config;
+__attribute__((weak)) int task_pool_shared_configured;
+
+// Set the shared pool's configuration. Returns -1 once the pool has started
+static inline int task_pool_configure(const TaskPoolConfig* config) {
+    pthread_mutex_lock(&task_pool_shared_lock);
+    int result = -1;
+    if (!__atomic_load_n(&task_pool_shared_instance, __ATOMIC_ACQUIRE)) {
+        task_pool_shared_config = *config;
+        task_pool_shared_configured = 1;
+        result = 0;
+    }
+    pthread_mutex_unlock(&task_pool_shared_lock);
+    return result;
+}
+
+// The shared pool, started on first use. NULL if it could not be started
+static inline TaskPool* task_pool_shared(void) {
+    TaskPool* pool = __atomic_load_n(&task_pool_shared_instance, __ATOMIC_ACQUIRE);
+    if (pool) return pool;
+
+    pthread_mutex_lock(&task_pool_shared_lock);
+    pool = task_pool_shared_instance;
+    if (!pool) {
+        pool = (TaskPool*)malloc(sizeof(TaskPool));
+        if (pool && init_task_pool(pool, task_pool_shared_configured ? &task_pool_shared_config : NULL) != 0) {
+            free(pool);
+            pool = NULL;
+        }
+        __atomic_store_n(&task_pool_shared_instance, pool, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&task_pool_shared_lock);
+    return pool;
+}
+
+// Stop the shared pool; no subsystem may be using it
+static inline void cleanup_task_pool_shared(void) {
+    pthread_mutex_lock(&task_pool_shared_lock);
+    TaskPool* pool = task_pool_shared_instance;
+    __atomic_store_n(&task_pool_shared_instance, NULL, __ATOMIC_RELEASE);
+    if (pool) {
+        cleanup_task_pool(pool);
+        free(pool);
+    }
+    pthread_mutex_unlock(&task_pool_shared_lock);
+}
+
+#endif // TASK_POOL_H
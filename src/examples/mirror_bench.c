@@ -0,0 +1,331 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mirror_shard.h"
+#include "mirror_fuzzy.h"
+
+/*
+ * Whitelist lookup benchmark
+ *
+ * Generates a synthetic corpus and whitelist, then measures classification
+ * throughput (GB/s, records/s) and latency percentiles for whitelist sizes
+ * 10^2 .. --max-whitelist in powers of ten. Throughput routes --batch sized
+ * batches; latency is one lookup per sample for both engines (for sharded,
+ * a batch of one record, so it includes the handoff to the shard worker).
+ * Records are reused in order when there are fewer than --latency-samples.
+ *
+ *   mirror_bench [--records N] [--alphabet K] [--match-ratio R]
+ *                [--min-len A] [--max-len B] [--lengths uniform|geometric]
+ *                [--max-whitelist N] [--shards S] [--batch B]
+ *                [--fuzzy-k K] [--fuzzy-max N] [--latency-samples N] [--seed S]
+ */
+
+#define BENCH_MIN_LATENCY_SAMPLES   10000
+
+typedef struct {
+    size_t records;
+    size_t alphabet;
+    double match_ratio;
+    size_t min_len;
+    size_t max_len;
+    int geometric;
+    size_t max_whitelist;
+    size_t shards;
+    size_t batch;
+    size_t fuzzy_k;
+    size_t fuzzy_max;
+    size_t latency_samples;
+    uint64_t seed;
+} BenchConfig;
+
+// Strings packed back to back, NUL-terminated
+typedef struct {
+    char* data;
+    const char** items;
+    size_t count;
+    size_t bytes;       // Payload bytes, excluding terminators
+} BenchCorpus;
+
+static uint64_t bench_rng_state;
+
+static uint64_t bench_rand(void) {
+    // xorshift64*
+    bench_rng_state ^= bench_rng_state >> 12;
+    bench_rng_state ^= bench_rng_state << 25;
+    bench_rng_state ^= bench_rng_state >> 27;
+    return bench_rng_state * 2685821657736338717ULL;
+}
+
+static double bench_uniform(void) {
+    return (double)(bench_rand() >> 11) / 9007199254740992.0;
+}
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static size_t bench_length(const BenchConfig* config) {
+    size_t span = config->max_len - config->min_len;
+    if (!config->geometric) {
+        return config->min_len + (size_t)(bench_rand() % (span + 1));
+    }
+
+    // Geometric tail with mean about a quarter of the span above min_len
+    double p = 1.0 / (1.0 + (double)span / 4.0);
+    size_t extra = 0;
+    while (extra < span && bench_uniform() > p) extra++;
+    return config->min_len + extra;
+}
+
+static int bench_generate(BenchCorpus* corpus, size_t count, const BenchConfig* config,
+                          const BenchCorpus* whitelist, double match_ratio) {
+    corpus->count = count;
+    corpus->bytes = 0;
+    corpus->items = (const char**)malloc(count * sizeof(const char*));
+    corpus->data = (char*)malloc(count * (config->max_len + 1));
+    if (!corpus->items || !corpus->data) return -1;
+
+    char* out = corpus->data;
+    for (size_t i = 0; i < count; i++) {
+        corpus->items[i] = out;
+
+        if (whitelist && bench_uniform() < match_ratio) {
+            const char* source = whitelist->items[bench_rand() % whitelist->count];
+            size_t length = strlen(source);
+            memcpy(out, source, length + 1);
+            out += length + 1;
+            corpus->bytes += length;
+            continue;
+        }
+
+        size_t length = bench_length(config);
+        for (size_t j = 0; j < length; j++) {
+            out[j] = (char)('a' + bench_rand() % config->alphabet);
+        }
+        out[length] = '\0';
+        out += length + 1;
+        corpus->bytes += length;
+    }
+    return 0;
+}
+
+static void bench_free(BenchCorpus* corpus) {
+    free(corpus->items);
+    free(corpus->data);
+    memset(corpus, 0, sizeof(*corpus));
+}
+
+static int bench_compare_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double bench_percentile(const double* sorted, size_t count, double p) {
+    size_t index = (size_t)(p * (double)(count - 1) + 0.5);
+    return sorted[index];
+}
+
+static void bench_report(const char* engine, size_t whitelist_size, double seconds, size_t records, size_t bytes,
+                         double* latencies, size_t samples) {
+    qsort(latencies, samples, sizeof(double), bench_compare_double);
+    printf("%-8s %10zu %10.3f %14.0f %10.0f %10.0f %10.0f %10.0f\n",
+           engine, whitelist_size,
+           (double)bytes / seconds / 1e9,
+           (double)records / seconds,
+           bench_percentile(latencies, samples, 0.50) * 1e9,
+           bench_percentile(latencies, samples, 0.99) * 1e9,
+           bench_percentile(latencies, samples, 0.999) * 1e9,
+           latencies[samples - 1] * 1e9);
+}
+
+static int bench_sharded(const BenchConfig* config, const BenchCorpus* whitelist, const BenchCorpus* records,
+                         double* latencies) {
+    MirrorShardedWhitelist wl;
+    if (init_mirror_sharded_whitelist(&wl, config->shards, NULL, NULL) != 0) return -1;
+
+    for (size_t i = 0; i < whitelist->count; i++) {
+        if (mirror_shard_add(&wl, whitelist->items[i]) != 0) {
+            cleanup_mirror_sharded_whitelist(&wl);
+            return -1;
+        }
+    }
+    if (mirror_shard_compile(&wl) != 0) {
+        cleanup_mirror_sharded_whitelist(&wl);
+        return -1;
+    }
+
+    int* results = (int*)malloc(config->batch * sizeof(int));
+    if (!results) {
+        cleanup_mirror_sharded_whitelist(&wl);
+        return -1;
+    }
+
+    int status = 0;
+    double start = bench_now();
+    for (size_t i = 0; i < records->count && status == 0; i += config->batch) {
+        size_t count = records->count - i < config->batch ? records->count - i : config->batch;
+        status = mirror_shard_lookup_batch(&wl, records->items + i, count, results);
+    }
+    double seconds = bench_now() - start;
+
+    // One record per sample: what a caller routing a single lookup waits for
+    size_t samples = config->latency_samples;
+    for (size_t i = 0; i < samples && status == 0; i++) {
+        double t0 = bench_now();
+        status = mirror_shard_lookup_batch(&wl, records->items + i % records->count, 1, results);
+        latencies[i] = bench_now() - t0;
+    }
+
+    if (status == 0) {
+        bench_report("sharded", whitelist->count, seconds, records->count, records->bytes, latencies, samples);
+    }
+
+    free(results);
+    cleanup_mirror_sharded_whitelist(&wl);
+    return status;
+}
+
+static int bench_fuzzy(const BenchConfig* config, const BenchCorpus* whitelist, const BenchCorpus* records,
+                       double* latencies) {
+    MirrorFuzzyWhitelist wl;
+    init_mirror_fuzzy_whitelist(&wl, NULL);
+
+    for (size_t i = 0; i < whitelist->count; i++) {
+        if (mirror_fuzzy_add(&wl, whitelist->items[i]) != 0) {
+            cleanup_mirror_fuzzy_whitelist(&wl);
+            return -1;
+        }
+    }
+
+    // Every lookup is timed individually, so the sample budget bounds the run
+    size_t count = config->latency_samples;
+    size_t bytes = 0;
+    double start = bench_now();
+    for (size_t i = 0; i < count; i++) {
+        const char* record = records->items[i % records->count];
+        double t0 = bench_now();
+        mirror_fuzzy_contains(&wl, record, config->fuzzy_k);
+        latencies[i] = bench_now() - t0;
+        bytes += strlen(record);
+    }
+    double seconds = bench_now() - start;
+
+    char engine[16];
+    snprintf(engine, sizeof(engine), "fuzzy/%zu", config->fuzzy_k);
+    bench_report(engine, whitelist->count, seconds, count, bytes, latencies, count);
+
+    cleanup_mirror_fuzzy_whitelist(&wl);
+    return 0;
+}
+
+static int bench_parse(BenchConfig* config, int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* flag = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value) return -1;
+        i++;
+
+        if (strcmp(flag, "--records") == 0) config->records = strtoull(value, NULL, 10);
+        else if (strcmp(flag, "--alphabet") == 0) config->alphabet = strtoull(value, NULL, 10);
+        else if (strcmp(flag, "--match-ratio") == 0) config->match_ratio = strtod(value, NULL);
+        else if (strcmp(flag, "--min-len") == 0) config->min_len = strtoull(value, NULL, 10);
+        else if (strcmp(flag, "--max-len") == 0) config->max_len = strtoull(value, NULL, 10);
+        else if (strcmp(flag, "--lengths") == 0) {
+            if (strcmp(value, "geometric") == 0) config->geometric = 1;
+            else if (strcmp(value, "uniform") == 0) config->geometric = 0;
+            else return -1;
+        }
+        else if (strcmp(flag, "--max-whitelist") == 0) config->max_whitelist = strtoull(value, NULL, 10);
+        else if (strcmp(flag, "--shards") == 0) config->shards = strtoull(value, NULL, 10);
+        else if (strcmp(flag, "--batch") == 0) config->batch = strtoull(value, NULL, 10);
+        else if (strcmp(flag, "--fuzzy-k") == 0) config->fuzzy_k = strtoull(value, NULL, 10);
+        else if (strcmp(flag, "--fuzzy-max") == 0) config->fuzzy_max = strtoull(value, NULL, 10);
+        else if (strcmp(flag, "--latency-samples") == 0) config->latency_samples = strtoull(value, NULL, 10);
+        else if (strcmp(flag, "--seed") == 0) config->seed = strtoull(value, NULL, 10);
+        else return -1;
+    }
+
+    if (config->alphabet < 1 || config->alphabet > 26) return -1;
+    if (config->min_len > config->max_len || config->max_len == 0) return -1;
+    if (config->records == 0 || config->batch == 0 || config->shards == 0) return -1;
+    // Fewer samples leave p99.9 resting on a handful of points
+    if (config->latency_samples < BENCH_MIN_LATENCY_SAMPLES) return -1;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = {
+        1000000,    // records
+        26,         // alphabet
+        0.5,        // match_ratio
+        4,          // min_len
+        32,         // max_len
+        0,          // geometric
+        10000000,   // max_whitelist
+        4,          // shards
+        4096,       // batch
+        1,          // fuzzy_k
+        100000,     // fuzzy_max
+        10000,      // latency_samples
+        42          // seed
+    };
+
+    if (bench_parse(&config, argc, argv) != 0) {
+        fprintf(stderr, "usage: %s [--records N] [--alphabet K] [--match-ratio R] [--min-len A] [--max-len B]\n"
+                        "       [--lengths uniform|geometric] [--max-whitelist N] [--shards S] [--batch B]\n"
+                        "       [--fuzzy-k K] [--fuzzy-max N] [--latency-samples N] [--seed S]\n", argv[0]);
+        return 2;
+    }
+
+    printf("=== Mirror King Whitelist Benchmark ===\n\n");
+    printf("records=%zu alphabet=%zu match_ratio=%.2f lengths=%s[%zu,%zu] shards=%zu batch=%zu\n\n",
+           config.records, config.alphabet, config.match_ratio, config.geometric ? "geometric" : "uniform",
+           config.min_len, config.max_len, config.shards, config.batch);
+    printf("latency: one lookup per sample, %zu samples (sharded: a batch of one record)\n\n",
+           config.latency_samples);
+    printf("%-8s %10s %10s %14s %10s %10s %10s %10s\n",
+           "engine", "whitelist", "GB/s", "records/s", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+
+    double* latencies = (double*)malloc(config.latency_samples * sizeof(double));
+    if (!latencies) return 1;
+
+    for (size_t size = 100; size <= config.max_whitelist; size *= 10) {
+        BenchCorpus whitelist;
+        BenchCorpus records;
+        memset(&whitelist, 0, sizeof(whitelist));
+        memset(&records, 0, sizeof(records));
+
+        // Same seed per size so only the whitelist size varies between rows
+        bench_rng_state = config.seed ? config.seed : 1;
+        if (bench_generate(&whitelist, size, &config, NULL, 0.0) != 0 ||
+            bench_generate(&records, config.records, &config, &whitelist, config.match_ratio) != 0) {
+            fprintf(stderr, "corpus generation failed at whitelist size %zu\n", size);
+            bench_free(&whitelist);
+            bench_free(&records);
+            free(latencies);
+            return 1;
+        }
+
+        if (bench_sharded(&config, &whitelist, &records, latencies) != 0) {
+            fprintf(stderr, "sharded benchmark failed at whitelist size %zu\n", size);
+        }
+        if (size <= config.fuzzy_max && bench_fuzzy(&config, &whitelist, &records, latencies) != 0) {
+            fprintf(stderr, "fuzzy benchmark failed at whitelist size %zu\n", size);
+        }
+
+        bench_free(&whitelist);
+        bench_free(&records);
+    }
+
+    free(latencies);
+    return 0;
+}
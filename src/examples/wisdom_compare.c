@@ -0,0 +1,63 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "O_wisdom_baseline.h"
+
+/*
+ * Compare an O_wisdom results file against a stored baseline.
+ *
+ *   wisdom_compare BASELINE.json CURRENT.json [--method mw|ci] [--alpha A] [--min-slowdown R]
+ *
+ * Exit status: 0 no regression, 1 regression detected, 2 usage or load error.
+ */
+
+static int usage(const char* program) {
+    fprintf(stderr, "usage: %s BASELINE.json CURRENT.json [--method mw|ci] [--alpha A] [--min-slowdown R]\n",
+            program);
+    return WISDOM_COMPARE_ERROR;
+}
+
+int main(int argc, char** argv) {
+    WisdomCompareConfig config;
+    wisdom_compare_defaults(&config);
+
+    if (argc < 3) return usage(argv[0]);
+
+    for (int i = 3; i < argc; i++) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "missing value for %s\n", argv[i]);
+            return WISDOM_COMPARE_ERROR;
+        }
+
+        if (strcmp(argv[i], "--method") == 0) {
+            if (strcmp(argv[i + 1], "mw") == 0) {
+                config.method = WISDOM_COMPARE_MANN_WHITNEY;
+            } else if (strcmp(argv[i + 1], "ci") == 0) {
+                config.method = WISDOM_COMPARE_CI_OVERLAP;
+            } else {
+                fprintf(stderr, "unknown method %s\n", argv[i + 1]);
+                return usage(argv[0]);
+            }
+        } else if (strcmp(argv[i], "--alpha") == 0) {
+            char* end;
+            config.alpha = strtod(argv[i + 1], &end);
+            // Negated comparison so NaN is rejected too
+            if (end == argv[i + 1] || *end || !(config.alpha > 0.0 && config.alpha < 1.0)) {
+                fprintf(stderr, "--alpha must be in (0, 1), got %s\n", argv[i + 1]);
+                return usage(argv[0]);
+            }
+        } else if (strcmp(argv[i], "--min-slowdown") == 0) {
+            config.min_slowdown = strtod(argv[i + 1], NULL);
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return WISDOM_COMPARE_ERROR;
+        }
+        i++;
+    }
+
+    return wisdom_baseline_compare_files(argv[1], argv[2], &config, stdout);
+}
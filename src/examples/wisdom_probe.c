@@ -0,0 +1,539 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mirror_shard.h"
+#include "mirror_fuzzy.h"
+#include "mirror_reflect.h"
+#include "mirror_stream.h"
+#include "O_wisdom_alloc.h"
+#include "O_wisdom_cache.h"
+#include "O_wisdom_timing.h"
+
+/*
+ * Complexity probe suite
+ *
+ * Runs every public Mirror King entry point over a size sweep and reports
+ * the fitted time and space complexity of each: n is the number of patterns
+ * for whitelist calls and the number of text bytes for corpus and stream
+ * calls. Lookups run a fixed query batch against a structure of size n, so
+ * their fit is the per-call cost as the data grows; sam_match instead reads
+ * n bytes against a fixed corpus. Only the measured call is timed and
+ * allocation-tracked; inputs and prebuilt structures are made in prepare().
+ * Objects are handed wisdom_alloc_allocator(), so space is what they
+ * allocate through that Allocator; calls that take none show "-".
+ *
+ * Each size is timed with wisdom_time_robust (warm, repeated runs on one
+ * prepared state, outliers rejected, median kept) on three states in
+ * interleaved passes, and the median of those is fitted. Successive runs
+ * read different input blocks, so no run replays an input short enough for
+ * the branch predictor to have learned it. A call whose timings the fitter
+ * cannot separate from a flat line is reported as "no significant growth".
+ *
+ * Time is fitted only over the sizes whose working set (tracked bytes plus
+ * any plain-malloc scratch) stays in one cache level, where a load costs the
+ * same at every size: L1 when that spans 16x in n, otherwise past L1 and
+ * within a quarter of L2. Sizes start at 16, except that calls whose small-n
+ * cost is a different regime (thread start-up in compile, alphabet fill-up,
+ * the bit-parallel path for short edit distances, lookups that visit most of
+ * a small structure) start at 256. The slowdown past the window is reported
+ * apart as "cache rise": measured time at max-n over what the fit predicts
+ * there.
+ * --verbose 1 prints the fitted range and s / n per size.
+ *
+ *   wisdom_probe [--min-n N] [--max-n N] [--samples S] [--filter SUBSTRING] [--verbose 0|1]
+ */
+
+#define PROBE_PATTERN_LENGTH    12
+#define PROBE_ALPHABET          16
+#define PROBE_TEXT_ALPHABET     4           // Suffix automaton fan-out is full from the smallest n
+#define PROBE_POOL              (1u << 17)  // Input elements runs cycle through
+#define PROBE_QUERIES           256
+#define PROBE_QUERY_POOL        4096
+#define PROBE_FUZZY_QUERIES     16
+#define PROBE_FUZZY_DISTANCE    2
+#define PROBE_STREAM_PATTERNS   64
+#define PROBE_COUNT_LENGTH      2
+#define PROBE_PALINDROME_MIN    4
+#define PROBE_MATCH_CORPUS      4096
+#define PROBE_MIN_N             256         // First size past a call's small-n regime
+
+typedef struct {
+    size_t n;
+    size_t blocks;                  // Inputs of n elements; block 0 feeds build, runs cycle through the rest
+    size_t round;
+    char* arena;                    // blocks * n NUL-terminated patterns
+    const char** patterns;
+    char* text;                     // blocks * n bytes
+    const char* queries[PROBE_QUERY_POOL];
+    const char* text_queries[PROBE_QUERY_POOL];     // Substrings of block 0, so every count walks the whole query
+    int results[PROBE_QUERIES];
+
+    MirrorShardedWhitelist shard;
+    MirrorFuzzyWhitelist fuzzy;
+    MirrorSuffixAutomaton sam;
+    MirrorWindowSet windows;
+} ProbeState;
+
+typedef struct {
+    const char* name;
+    const char* n_is;
+    int (*build)(ProbeState* state);    // Outside the measured region
+    void (*run)(ProbeState* state);
+    void (*teardown)(ProbeState* state);    // Undoes build, also after a partial one
+    int tracked;                            // The call allocates through an Allocator, so space is counted
+    size_t scratch_per_n;                   // Bytes per element the call mallocs outside any Allocator
+    size_t min_n;                           // Smallest size past any small-n regime, 0 for the sweep's
+    size_t max_n;                           // Largest size worth timing, 0 for no limit
+} Probe;
+
+static uint64_t probe_rng_state = 0x9e3779b97f4a7c15ULL;
+static volatile size_t probe_sink;
+
+static uint64_t probe_rand(void) {
+    // xorshift64*
+    probe_rng_state ^= probe_rng_state >> 12;
+    probe_rng_state ^= probe_rng_state << 25;
+    probe_rng_state ^= probe_rng_state >> 27;
+    return probe_rng_state * 2685821657736338717ULL;
+}
+
+// Index of the block the next run reads, never block 0
+static size_t probe_next_block(ProbeState* state) {
+    return 1 + state->round++ % (state->blocks - 1);
+}
+
+// Start of the next query batch of the given size
+static size_t probe_next_queries(ProbeState* state, size_t batch) {
+    return (state->round++ % (PROBE_QUERY_POOL / batch)) * batch;
+}
+
+/* ---------------------------------------------------------------------------
+ * Builders
+ * ------------------------------------------------------------------------- */
+
+static int probe_build_shard(ProbeState* state) {
+    if (init_mirror_sharded_whitelist(&state->shard, 1, NULL, wisdom_alloc_allocator()) != 0) return -1;
+    for (size_t i = 0; i < state->n; i++) {
+        if (mirror_shard_add(&state->shard, state->patterns[i]) != 0) return -1;
+    }
+    return mirror_shard_compile(&state->shard);
+}
+
+static int probe_build_fuzzy(ProbeState* state) {
+    init_mirror_fuzzy_whitelist(&state->fuzzy, wisdom_alloc_allocator());
+    for (size_t i = 0; i < state->n; i++) {
+        if (mirror_fuzzy_add(&state->fuzzy, state->patterns[i]) != 0) return -1;
+    }
+    return 0;
+}
+
+static int probe_build_sam(ProbeState* state) {
+    if (init_mirror_suffix_automaton(&state->sam, state->n, wisdom_alloc_allocator()) != 0) return -1;
+    return mirror_sam_build(&state->sam, state->text, state->n);
+}
+
+// A fixed corpus, so matching cost depends on the text alone
+static int probe_build_sam_corpus(ProbeState* state) {
+    char* corpus = (char*)malloc(PROBE_MATCH_CORPUS);
+    if (!corpus) return -1;
+    for (size_t i = 0; i < PROBE_MATCH_CORPUS; i++) corpus[i] = (char)('a' + probe_rand() % PROBE_TEXT_ALPHABET);
+
+    int result = init_mirror_suffix_automaton(&state->sam, PROBE_MATCH_CORPUS, wisdom_alloc_allocator());
+    if (result == 0) result = mirror_sam_build(&state->sam, corpus, PROBE_MATCH_CORPUS);
+    free(corpus);
+    return result;
+}
+
+static int probe_build_windows(ProbeState* state) {
+    if (init_mirror_window_set(&state->windows, PROBE_PATTERN_LENGTH, wisdom_alloc_allocator()) != 0) return -1;
+    size_t count = state->n < PROBE_STREAM_PATTERNS ? state->n : PROBE_STREAM_PATTERNS;
+    for (size_t i = 0; i < count; i++) {
+        if (mirror_window_add(&state->windows, state->patterns[i], PROBE_PATTERN_LENGTH) < 0) return -1;
+    }
+    return 0;
+}
+
+static void probe_teardown_shard(ProbeState* state) {
+    cleanup_mirror_sharded_whitelist(&state->shard);
+}
+
+static void probe_teardown_fuzzy(ProbeState* state) {
+    cleanup_mirror_fuzzy_whitelist(&state->fuzzy);
+}
+
+static void probe_teardown_sam(ProbeState* state) {
+    cleanup_mirror_suffix_automaton(&state->sam);
+}
+
+static void probe_teardown_windows(ProbeState* state) {
+    cleanup_mirror_window_set(&state->windows);
+}
+
+/* ---------------------------------------------------------------------------
+ * Measured calls
+ * ------------------------------------------------------------------------- */
+
+static void probe_shard_compile(ProbeState* state) {
+    const char** patterns = state->patterns + probe_next_block(state) * state->n;
+    MirrorShardedWhitelist wl;
+    if (init_mirror_sharded_whitelist(&wl, 1, NULL, wisdom_alloc_allocator()) != 0) return;
+    for (size_t i = 0; i < state->n; i++) mirror_shard_add(&wl, patterns[i]);
+    mirror_shard_compile(&wl);
+    cleanup_mirror_sharded_whitelist(&wl);
+}
+
+static void probe_shard_lookup(ProbeState* state) {
+    size_t first = probe_next_queries(state, PROBE_QUERIES);
+    mirror_shard_lookup_batch(&state->shard, state->queries + first, PROBE_QUERIES, state->results);
+}
+
+static void probe_fuzzy_add(ProbeState* state) {
+    const char** patterns = state->patterns + probe_next_block(state) * state->n;
+    MirrorFuzzyWhitelist wl;
+    init_mirror_fuzzy_whitelist(&wl, wisdom_alloc_allocator());
+    for (size_t i = 0; i < state->n; i++) mirror_fuzzy_add(&wl, patterns[i]);
+    probe_sink += wl.node_count;
+    cleanup_mirror_fuzzy_whitelist(&wl);
+}
+
+static void probe_fuzzy_contains(ProbeState* state) {
+    size_t first = probe_next_queries(state, PROBE_FUZZY_QUERIES);
+    size_t found = 0;
+    for (size_t i = 0; i < PROBE_FUZZY_QUERIES; i++) {
+        found += mirror_fuzzy_contains(&state->fuzzy, state->queries[first + i], 1) == 1;
+    }
+    probe_sink += found;
+}
+
+static void probe_fuzzy_best(ProbeState* state) {
+    size_t first = probe_next_queries(state, PROBE_FUZZY_QUERIES);
+    size_t total = 0;
+    for (size_t i = 0; i < PROBE_FUZZY_QUERIES; i++) {
+        size_t index = 0;
+        size_t distance = 0;
+        if (mirror_fuzzy_best(&state->fuzzy, state->queries[first + i], PROBE_FUZZY_DISTANCE, &index, &distance) == 1) {
+            total += index + distance;
+        }
+    }
+    probe_sink += total;
+}
+
+static void probe_edit_distance(ProbeState* state) {
+    const char* text = state->text + probe_next_block(state) * state->n;
+    probe_sink += mirror_edit_distance(state->text, state->n, text, state->n);
+}
+
+static void probe_longest_palindrome(ProbeState* state) {
+    const char* text = state->text + probe_next_block(state) * state->n;
+    MirrorReflection reflection;
+    if (mirror_longest_palindrome(text, state->n, &reflection) == 0) probe_sink += reflection.length;
+}
+
+static void probe_for_each_palindrome(ProbeState* state) {
+    const char* text = state->text + probe_next_block(state) * state->n;
+    probe_sink += mirror_for_each_palindrome(text, state->n, PROBE_PALINDROME_MIN, NULL, NULL);
+}
+
+static void probe_sam_build(ProbeState* state) {
+    const char* text = state->text + probe_next_block(state) * state->n;
+    MirrorSuffixAutomaton sam;
+    if (init_mirror_suffix_automaton(&sam, state->n, wisdom_alloc_allocator()) != 0) return;
+    mirror_sam_build(&sam, text, state->n);
+    probe_sink += sam.state_count;
+    cleanup_mirror_suffix_automaton(&sam);
+}
+
+// Two-byte queries touch the root and its children only, the same few states at every n
+static void probe_sam_count(ProbeState* state) {
+    size_t first = probe_next_queries(state, PROBE_QUERIES);
+    size_t total = 0;
+    for (size_t i = 0; i < PROBE_QUERIES; i++) {
+        total += mirror_sam_count(&state->sam, state->text_queries[first + i], PROBE_COUNT_LENGTH);
+    }
+    probe_sink += total;
+}
+
+static void probe_sam_match(ProbeState* state) {
+    const char* text = state->text + probe_next_block(state) * state->n;
+    MirrorReflection reflection;
+    mirror_sam_match(&state->sam, text, state->n, 0, NULL, &reflection);
+    probe_sink += reflection.length;
+}
+
+static void probe_window_add(ProbeState* state) {
+    const char** patterns = state->patterns + probe_next_block(state) * state->n;
+    MirrorWindowSet set;
+    if (init_mirror_window_set(&set, PROBE_PATTERN_LENGTH, wisdom_alloc_allocator()) != 0) return;
+    for (size_t i = 0; i < state->n; i++) mirror_window_add(&set, patterns[i], PROBE_PATTERN_LENGTH);
+    probe_sink += set.entry_count;
+    cleanup_mirror_window_set(&set);
+}
+
+static void probe_window_feed(ProbeState* state) {
+    const char* text = state->text + probe_next_block(state) * state->n;
+    MirrorWindowStream stream;
+    if (init_mirror_window_stream(&stream, &state->windows) != 0) return;
+    probe_sink += mirror_window_feed(&stream, text, state->n, NULL, NULL);
+    cleanup_mirror_window_stream(&stream);
+}
+
+static const Probe probes[] = {
+    { "mirror_shard_add+compile",   "patterns",     NULL,                   probe_shard_compile,        NULL,                   1, 0,                       PROBE_MIN_N, 0 },
+    { "mirror_shard_lookup_batch",  "patterns",     probe_build_shard,      probe_shard_lookup,         probe_teardown_shard,   1, 0,                       PROBE_MIN_N, 0 },
+    { "mirror_fuzzy_add",           "patterns",     NULL,                   probe_fuzzy_add,            NULL,                   1, 0,                       0,           0 },
+    { "mirror_fuzzy_contains",      "patterns",     probe_build_fuzzy,      probe_fuzzy_contains,       probe_teardown_fuzzy,   1, 0,                       PROBE_MIN_N, 0 },
+    { "mirror_fuzzy_best",          "patterns",     probe_build_fuzzy,      probe_fuzzy_best,           probe_teardown_fuzzy,   1, 0,                       PROBE_MIN_N, 0 },
+    { "mirror_edit_distance",       "bytes each",   NULL,                   probe_edit_distance,        NULL,                   0, sizeof(size_t),          PROBE_MIN_N, 4096 },
+    { "mirror_longest_palindrome",  "text bytes",   NULL,                   probe_longest_palindrome,   NULL,                   0, 2 * sizeof(size_t),      0,           0 },
+    { "mirror_for_each_palindrome", "text bytes",   NULL,                   probe_for_each_palindrome,  NULL,                   0, 2 * sizeof(size_t),      0,           0 },
+    { "mirror_sam_build",           "text bytes",   NULL,                   probe_sam_build,            NULL,                   1, 0,                       0,           0 },
+    { "mirror_sam_count",           "text bytes",   probe_build_sam,        probe_sam_count,            probe_teardown_sam,     1, 0,                       PROBE_MIN_N, 0 },
+    { "mirror_sam_match",           "text bytes",   probe_build_sam_corpus, probe_sam_match,            probe_teardown_sam,     1, 0,                       PROBE_MIN_N, 0 },
+    { "mirror_window_add",          "patterns",     NULL,                   probe_window_add,           NULL,                   1, 0,                       PROBE_MIN_N, 0 },
+    { "mirror_window_feed",         "text bytes",   probe_build_windows,    probe_window_feed,          probe_teardown_windows, 1, 0,                       PROBE_MIN_N, 0 },
+};
+
+/* ---------------------------------------------------------------------------
+ * Workload adapter
+ * ------------------------------------------------------------------------- */
+
+static void probe_release(void* opaque, void* user_data) {
+    ProbeState* state = (ProbeState*)opaque;
+    const Probe* probe = (const Probe*)user_data;
+    if (!state) return;
+
+    if (probe->teardown) probe->teardown(state);
+
+    free(state->arena);
+    free(state->patterns);
+    free(state->text);
+    free(state);
+}
+
+static void* probe_prepare(size_t n, void* user_data) {
+    const Probe* probe = (const Probe*)user_data;
+    ProbeState* state = (ProbeState*)calloc(1, sizeof(ProbeState));
+    if (!state) return NULL;
+
+    // Enough blocks that runs never revisit an input the branch predictor could have learned
+    state->n = n;
+    state->blocks = 1 + (n < PROBE_POOL ? (PROBE_POOL + n - 1) / n : 1);
+    size_t total = state->blocks * n;
+    state->arena = (char*)malloc(total * (PROBE_PATTERN_LENGTH + 1));
+    state->patterns = (const char**)malloc(total * sizeof(const char*));
+    state->text = (char*)malloc(total + 1);
+    if (!state->arena || !state->patterns || !state->text) {
+        probe_release(state, user_data);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < total; i++) {
+        char* pattern = state->arena + i * (PROBE_PATTERN_LENGTH + 1);
+        for (size_t j = 0; j < PROBE_PATTERN_LENGTH; j++) pattern[j] = (char)('a' + probe_rand() % PROBE_ALPHABET);
+        pattern[PROBE_PATTERN_LENGTH] = '\0';
+        state->patterns[i] = pattern;
+        state->text[i] = (char)('a' + probe_rand() % PROBE_TEXT_ALPHABET);
+    }
+    state->text[total] = '\0';
+
+    // Half the queries hit block 0, half are suffixes of its patterns and miss
+    for (size_t i = 0; i < PROBE_QUERY_POOL; i++) {
+        state->queries[i] = i % 2 == 0 ? state->patterns[probe_rand() % n]
+                                       : state->patterns[probe_rand() % n] + 1;
+        state->text_queries[i] = n > PROBE_COUNT_LENGTH ? state->text + probe_rand() % (n - PROBE_COUNT_LENGTH)
+                                                        : state->patterns[i % n];
+    }
+
+    if (probe->build && probe->build(state) != 0) {
+        fprintf(stderr, "%s: build failed at n=%zu\n", probe->name, n);
+        probe_release(state, user_data);
+        return NULL;
+    }
+    return state;
+}
+
+static void probe_run(void* opaque, size_t n, void* user_data) {
+    (void)n;
+    if (opaque) ((const Probe*)user_data)->run((ProbeState*)opaque);
+}
+
+/*
+ * Bytes a probe keeps live at size n: its prebuilt structure and the peak of
+ * one run, as tracked through the Allocator, plus its plain-malloc scratch.
+ * Returns -1 if prepare fails.
+ */
+static int64_t probe_working_set(const Probe* probe, size_t n) {
+    wisdom_alloc_tracking(1);
+    ProbeState* state = (ProbeState*)probe_prepare(n, (void*)probe);
+    if (state) probe->run(state);
+    wisdom_alloc_tracking(0);
+    if (!state) return -1;
+
+    int64_t bytes = wisdom_alloc_snapshot().peak_bytes + (int64_t)(probe->scratch_per_n * n);
+    probe_release(state, (void*)probe);
+    return bytes;
+}
+
+/*
+ * Narrow sweep to the sizes whose working set stays in one cache level: all
+ * of them up to L1 if that spans 16x in n, else those past L1 and within a
+ * quarter of L2, since TLB misses raise the cost of a load well before L2
+ * itself is full. An L2 window spanning less than 16x is widened, downward
+ * first. Returns 1 if the window stops short of the sweep's largest size.
+ */
+static int probe_cache_window(const Probe* probe, const WisdomCacheInfo* caches, WisdomSweepConfig* sweep) {
+    size_t l1_upper = 0;
+    size_t lower = 0;
+    size_t upper = 0;
+    size_t previous = 0;
+
+    for (double size = (double)sweep->min_n; size <= (double)sweep->max_n; size *= sweep->growth) {
+        size_t current = (size_t)(size + 0.5);
+        if (current == previous) continue;
+        previous = current;
+
+        int64_t bytes = probe_working_set(probe, current);
+        if (bytes < 0 || (size_t)bytes > caches->size[1] / 4) break;
+        if ((size_t)bytes <= caches->size[0]) l1_upper = current;
+        else if (!lower) lower = current;
+        upper = current;
+    }
+
+    if (l1_upper >= 16 * sweep->min_n) {
+        lower = sweep->min_n;
+        upper = l1_upper;
+    } else {
+        if (!lower) lower = sweep->min_n;
+        if (upper < 16 * lower) lower = upper / 16 > sweep->min_n ? upper / 16 : sweep->min_n;
+        if (upper < 16 * lower) upper = 16 * lower < sweep->max_n ? 16 * lower : sweep->max_n;
+    }
+    int spills = upper < sweep->max_n;
+    sweep->min_n = lower;
+    sweep->max_n = upper;
+    return spills;
+}
+
+static int probe_parse(WisdomSweepConfig* sweep, WisdomTimingConfig* timing, const char** filter, int* verbose,
+                       int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* flag = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value) return -1;
+        i++;
+
+        if (strcmp(flag, "--min-n") == 0) sweep->min_n = strtoull(value, NULL, 10);
+        else if (strcmp(flag, "--max-n") == 0) sweep->max_n = strtoull(value, NULL, 10);
+        else if (strcmp(flag, "--samples") == 0) timing->max_samples = strtoull(value, NULL, 10);
+        else if (strcmp(flag, "--filter") == 0) *filter = value;
+        else if (strcmp(flag, "--verbose") == 0) *verbose = atoi(value);
+        else return -1;
+    }
+    return sweep->min_n >= 1 && sweep->max_n >= sweep->min_n && timing->max_samples >= 3 ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+    WisdomSweepConfig sweep = { 16, 65536, 1.18920711, 3 };
+    WisdomTimingConfig timing;
+    const char* filter = NULL;
+    int verbose = 0;
+
+    // Three prepared states per size, a few hundredths of a second each
+    wisdom_timing_defaults(&timing);
+    timing.max_samples = 31;
+    timing.max_seconds = 0.04;
+    timing.min_sample_seconds = 2e-3;
+    timing.max_warmup_seconds = 0.04;
+    timing.bootstrap_resamples = 0;
+
+    // Freed memory stays in the heap, so every run reuses pages already faulted
+    // in instead of paying a fault per page from the mmap threshold upward
+#ifdef M_TRIM_THRESHOLD
+    mallopt(M_MMAP_THRESHOLD, 32 << 20);
+    mallopt(M_TRIM_THRESHOLD, 64 << 20);
+#endif
+
+    if (probe_parse(&sweep, &timing, &filter, &verbose, argc, argv) != 0) {
+        fprintf(stderr, "usage: %s [--min-n N] [--max-n N] [--samples S] [--filter SUBSTRING] [--verbose 0|1]\n",
+                argv[0]);
+        return 2;
+    }
+
+    // Containers grow by doubling, so space is sampled at doublings: between them it is a staircase
+    WisdomSweepConfig space_sweep = sweep;
+    space_sweep.growth = 2.0;
+
+    WisdomCacheInfo caches;
+    wisdom_detect_caches(&caches);
+
+    printf("%-28s %-11s %-21s %8s %10s   %-12s %-12s\n", "function", "n", "time", "R^2", "cache rise",
+           "peak space", "allocated");
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(probes) / sizeof(probes[0]); i++) {
+        const Probe* probe = &probes[i];
+        if (filter && !strstr(probe->name, filter)) continue;
+
+        WisdomSweepConfig probe_sweep = sweep;
+        WisdomSweepConfig probe_space_sweep = space_sweep;
+        if (probe->min_n > probe_sweep.min_n) {
+            probe_sweep.min_n = probe->min_n;
+            probe_space_sweep.min_n = probe->min_n;
+        }
+        if (probe->max_n && probe->max_n < probe_sweep.max_n) {
+            probe_sweep.max_n = probe->max_n;
+            probe_space_sweep.max_n = probe->max_n;
+        }
+
+        // Time is fitted only where the working set stays in cache
+        WisdomSweepConfig fit_sweep = probe_sweep;
+        int spills = caches.size[0] && caches.size[1] && probe_cache_window(probe, &caches, &fit_sweep);
+
+        WisdomWorkload workload = { probe_prepare, probe_run, probe_release, (void*)probe };
+        WisdomComplexityReport time;
+        WisdomSpaceReport space;
+        WisdomTimingResult beyond;
+        if (wisdom_measure_complexity_robust(&fit_sweep, &timing, &workload, &time) != 0 ||
+            wisdom_measure_space(&probe_space_sweep, &workload, &space) != 0 ||
+            (spills && wisdom_time_robust(&timing, &workload, probe_sweep.max_n, &beyond) != 0)) {
+            printf("%-28s %-11s failed\n", probe->name, probe->n_is);
+            failures++;
+            continue;
+        }
+
+        // Measured over predicted at the largest size: the slowdown the fit leaves out
+        char rise[16] = "-";
+        double predicted = 0.0;
+        if (spills) {
+            predicted = wisdom_model_predict(&time.fits[time.best], (double)probe_sweep.max_n);
+            if (predicted > 0) snprintf(rise, sizeof(rise), "x%.2f", beyond.median / predicted);
+        }
+
+        int grows = time.best != WISDOM_MODEL_CONSTANT;
+        const char* peak = space.peak_fitted ? wisdom_model_name(space.peak_fit.best) : "O(1)";
+        const char* allocated = space.allocated_fitted ? wisdom_model_name(space.allocated_fit.best) : "O(1)";
+        printf("%-28s %-11s %-21s %8.4f %10s   %-12s %-12s\n", probe->name, probe->n_is,
+               grows ? wisdom_model_name(time.best) : "no significant growth", time.fits[time.best].r_squared,
+               rise, probe->tracked ? peak : "-", probe->tracked ? allocated : "-");
+        if (verbose) {
+            printf("time fitted over n = %zu..%zu\n", fit_sweep.min_n, fit_sweep.max_n);
+            wisdom_print_complexity(&time, stdout);
+            printf("%12s %14s %14s\n", "n", "median s", "s / n");
+            for (size_t k = 0; k < time.point_count; k++) {
+                printf("%12.0f %14.6g %14.6g\n", time.n[k], time.value[k], time.value[k] / time.n[k]);
+            }
+            if (spills) {
+                printf("%12zu %14.6g %14.6g  past the window, fit predicts %.6g\n", probe_sweep.max_n, beyond.median,
+                       beyond.median / (double)probe_sweep.max_n, predicted);
+            }
+            printf("growth p-value: %.3g\n", time.p_value);
+            if (probe->tracked) wisdom_print_space(&space, stdout);
+            printf("\n");
+        }
+    }
+    return failures ? 1 : 0;
+}